@@ -0,0 +1,82 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "affectedfilesjob.h"
+#include "msvcdependencies.h"
+#include "msvcfileregistry.h"
+#include "msvcmodelitems.h"
+
+#include <QTimer>
+
+#include <KLocalizedString>
+
+#include <interfaces/iproject.h>
+#include <outputview/ioutputview.h>
+#include <outputview/outputmodel.h>
+#include <project/projectmodel.h>
+
+AffectedFilesJob::AffectedFilesJob( QObject* parent, KDevelop::IProject* project, KDevelop::Path const & header ) :
+    KDevelop::OutputJob(parent),
+    m_project(project),
+    m_header(header)
+{
+    setToolTitle( i18n("MSVC") );
+    setStandardToolView( KDevelop::IOutputView::BuildView );
+    setBehaviours( KDevelop::IOutputView::AllowUserClose | KDevelop::IOutputView::AutoScroll );
+
+    setObjectName( i18n("Affected by %1", header.lastPathSegment()) );
+}
+
+void AffectedFilesJob::start()
+{
+    KDevelop::OutputModel * model = new KDevelop::OutputModel( m_project->path().toUrl() );
+    setModel( model );
+    startOutput();
+
+    const KDevelop::Path::List sources = MsvcDependencyDatabase::self().affectedBy( m_project, m_header );
+
+    model->appendLine( i18np("%2 is included by 1 translation unit",
+                             "%2 is included by %1 translation units",
+                             sources.size(), m_header.pathOrUrl()) );
+
+    MsvcSolutionItem * solItem = dynamic_cast<MsvcSolutionItem*>( m_project->projectItem() );
+
+    for ( const KDevelop::Path & source : sources )
+    {
+        // Tell which projects compile it, a file can be shared
+        QStringList projects;
+        if ( solItem )
+        {
+            for ( MsvcProjectItem * proj : solItem->fileRegistry()->projectsContaining( source ) )
+                projects << proj->text();
+        }
+
+        if ( projects.isEmpty() )
+            model->appendLine( source.pathOrUrl() );
+        else
+            model->appendLine( QStringLiteral("%1 (%2)").arg( source.pathOrUrl(), projects.join(", ") ) );
+    }
+
+    if ( sources.isEmpty() )
+        model->appendLine( i18n("Only files built with the clang-cl backend are tracked.") );
+
+    // Do not emit the result from within start()
+    QTimer::singleShot( 0, this, [this]() { emitResult(); } );
+}
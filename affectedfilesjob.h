@@ -0,0 +1,53 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef AFFECTEDFILESJOB_H
+#define AFFECTEDFILESJOB_H
+
+#include <outputview/outputjob.h>
+
+#include <kdevplatform/util/path.h>
+
+namespace KDevelop
+{
+class IProject;
+}
+
+/**
+ * @brief Lists the translation units of the solution that include a header.
+ *
+ * The answer comes from the dependency database, so it only knows about
+ * files that were compiled by the plugin (clang-cl backend) at least once.
+ */
+class AffectedFilesJob : public KDevelop::OutputJob
+{
+    Q_OBJECT
+
+public:
+    AffectedFilesJob( QObject* parent, KDevelop::IProject* project, KDevelop::Path const & header );
+
+    void start() override;
+
+private:
+    KDevelop::IProject * m_project;
+    KDevelop::Path m_header;
+};
+
+#endif //AFFECTEDFILESJOB_H
@@ -0,0 +1,620 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "clangclbuildjob.h"
+#include "msvcdependencies.h"
+#include "msvchash.h"
+#include "msvcmodelitems.h"
+#include "msvcobjectcache.h"
+#include "msvcprojectgraph.h"
+#include "msvctrace.h"
+#include "debug.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSharedPointer>
+#include <QStandardPaths>
+#include <QThread>
+
+#include <KLocalizedString>
+
+#include <interfaces/iproject.h>
+#include <outputview/ioutputview.h>
+#include <outputview/outputmodel.h>
+
+namespace
+{
+
+// The file a compiler or linker process writes, removed when it is killed
+const char * const OUTPUT_PROPERTY = "kdevmsvc_output";
+
+QDateTime lastModified( KDevelop::Path const & path )
+{
+    QFileInfo info( path.toLocalFile() );
+    return info.exists() ? info.lastModified() : QDateTime();
+}
+
+// Recorded with the dependencies, a different command line means a different object
+QByteArray commandHash( MsvcBuildPlan::CompileUnit const & unit )
+{
+    return QCryptographicHash::hash( unit.arguments.join('\n').toUtf8(), QCryptographicHash::Md5 );
+}
+
+const char * const WORKSPACE_ROOT = "<workspace>/";
+
+QByteArray relativeToWorkspace( QByteArray text, QList<QByteArray> const & roots )
+{
+    for ( const QByteArray & root : roots )
+        text.replace( root, WORKSPACE_ROOT );
+    return text;
+}
+
+/**
+ * @brief Hashes the preprocessed source as it is read, with the workspace root
+ * taken out of the #line directives and the expanded __FILE__.
+ */
+struct PreprocessedHash
+{
+    MsvcHash hash;
+    QList<QByteArray> roots;
+    QByteArray partialLine;    // a root may be split between two reads
+
+    void addData( QByteArray const & data )
+    {
+        partialLine += data;
+        const int end = partialLine.lastIndexOf( '\n' ) + 1;
+        if ( end == 0 )
+            return;
+
+        hash.addData( relativeToWorkspace( partialLine.left( end ), roots ) );
+        partialLine.remove( 0, end );
+    }
+
+    QByteArray result()
+    {
+        hash.addData( relativeToWorkspace( partialLine, roots ) );
+        partialLine.clear();
+        return hash.result().toHex();
+    }
+};
+
+}
+
+ClangClBuildJob::ClangClBuildJob( QObject* parent, KDevelop::ProjectBuildFolderItem* item ) :
+    KDevelop::OutputJob(parent),
+    m_item(item),
+    m_toolchain(MsvcToolchain::self().profile( item->project() )),
+    m_maxJobs(qMax( 1, QThread::idealThreadCount() ))
+{
+    setCapabilities( Killable );
+    setToolTitle( i18n("clang-cl") );
+    setStandardToolView( KDevelop::IOutputView::BuildView );
+    setBehaviours( KDevelop::IOutputView::AllowUserClose | KDevelop::IOutputView::AutoScroll );
+
+    setObjectName( i18n("Build (%1)", item->text()) );
+}
+
+void ClangClBuildJob::start()
+{
+    // Everything we need from the model is collected here, on the GUI thread.
+    QList<MsvcProjectItem*> projects;
+
+    if ( MsvcProjectItem * projItem = dynamic_cast<MsvcProjectItem*>(m_item) )
+    {
+        projects << projItem;
+
+        // Like devenv, build what the project depends on first
+        if ( MsvcSolutionItem * solItem = dynamic_cast<MsvcSolutionItem*>(projItem->parent()) )
+            projects = solItem->dependencyGraph()->upstream( projItem ) << projItem;
+    }
+    else if ( MsvcSolutionItem * solItem = dynamic_cast<MsvcSolutionItem*>(m_item) )
+    {
+        projects = solItem->dependencyGraph()->buildOrder();
+    }
+
+    for ( MsvcProjectItem * proj : projects )
+        m_plans << MsvcBuildPlan::forProject( proj, m_toolchain.unityBatchSize );
+
+    m_model = new KDevelop::OutputModel( m_item->path().parent().toUrl() );
+    m_model->setFilteringStrategy( KDevelop::OutputModel::CompilerFilter );
+    setModel( m_model );
+    startOutput();
+
+    if ( m_toolchain.objectCache )
+    {
+        // Path, size and time stamp are enough to tell compiler versions apart
+        const QString compiler = QStandardPaths::findExecutable( m_toolchain.clangCl );
+        const QFileInfo info( compiler.isEmpty() ? m_toolchain.clangCl : compiler );
+
+        m_compilerIdentity = info.absoluteFilePath().toUtf8() + '\n' +
+                             QByteArray::number( info.size() ) + '\n' +
+                             QByteArray::number( info.lastModified().toMSecsSinceEpoch() );
+
+        // clang-cl writes the paths of #line directives with escaped backslashes
+        QString root = m_item->project()->path().toLocalFile();
+        if ( !root.endsWith( '/' ) )
+            root += '/';
+        const QString native = QDir::toNativeSeparators( root );
+        if ( native != root )
+            m_workspaceRoots << QString( native ).replace( '\\', QLatin1String("\\\\") ).toUtf8() << native.toUtf8();
+        m_workspaceRoots << root.toUtf8();
+
+        MsvcObjectCache::self().setMaximumSize( m_toolchain.objectCacheSize );
+    }
+
+    nextProject();
+}
+
+bool ClangClBuildJob::doKill()
+{
+    m_plans.clear();
+    m_pendingUnits.clear();
+
+    // Do not wait for the compilers to go away, the GUI would freeze until they do.
+    // Detached from the job, they delete themselves (and what they were writing) once dead.
+    for ( QProcess * process : m_running )
+    {
+        process->disconnect( this );
+        process->setParent( nullptr );
+
+        const QString output = process->property( OUTPUT_PROPERTY ).toString();
+        connect( process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>( &QProcess::finished ),
+                 process, [process, output]()
+                 {
+                     if ( !output.isEmpty() )
+                         QFile::remove( output );
+                     process->deleteLater();
+                 } );
+
+        if ( process->state() == QProcess::NotRunning )
+            process->deleteLater();
+        else
+            process->kill();
+    }
+    m_running.clear();
+
+    return true;
+}
+
+void ClangClBuildJob::nextProject()
+{
+    if ( m_failed )
+    {
+        finish( false );
+        return;
+    }
+
+    while ( !m_plans.isEmpty() )
+    {
+        m_current = m_plans.takeFirst();
+
+        if ( !m_current.isValid() )
+        {
+            m_model->appendLine( i18n("Skipping %1: its output could not be determined", m_current.name) );
+            continue;
+        }
+
+        QDir().mkpath( m_current.output.parent().toLocalFile() );
+
+        if ( !m_current.writeSources() )
+        {
+            m_model->appendLine( i18n("Cannot write the generated sources of %1", m_current.name) );
+            finish( false );
+            return;
+        }
+
+        m_model->appendLine( i18n("Building %1", m_current.name) );
+
+        // Everything else depends on the PCH, build it on its own first
+        if ( m_current.hasPch() &&
+             ( !lastModified( m_current.pchFile ).isValid() || needsCompile( m_current.pch ) ) )
+        {
+            m_model->appendLine( i18n("Precompiling %1", m_current.pchHeader.lastPathSegment()) );
+            m_buildingPch = true;
+            startCompile( m_current.pch, QByteArray() );
+            return;
+        }
+
+        queueUnits();
+        return;
+    }
+
+    finish( true );
+}
+
+void ClangClBuildJob::queueUnits()
+{
+    m_pendingUnits.clear();
+    for ( const MsvcBuildPlan::CompileUnit & unit : m_current.units )
+    {
+        if ( needsCompile( unit ) )
+            m_pendingUnits << unit;
+    }
+
+    // Relink if anything is newer than the output, the libraries of the
+    // dependencies were just built if they needed to
+    const QDateTime outputTime = lastModified( m_current.output );
+    m_linkNeeded = !outputTime.isValid() || !m_pendingUnits.isEmpty();
+
+    KDevelop::Path::List inputs = m_current.objects();
+    if ( m_current.type != MsvcProjectConfig::StaticLibrary )
+        inputs << m_current.libraries;
+    for ( const KDevelop::Path & input : inputs )
+    {
+        if ( m_linkNeeded )
+            break;
+        m_linkNeeded = lastModified( input ) > outputTime;
+    }
+
+    scheduleCompiles();
+}
+
+void ClangClBuildJob::scheduleCompiles()
+{
+    while ( m_running.size() < m_maxJobs && !m_pendingUnits.isEmpty() )
+    {
+        const MsvcBuildPlan::CompileUnit unit = m_pendingUnits.takeFirst();
+
+        m_model->appendLine( unit.source.lastPathSegment() );
+
+        if ( m_compilerIdentity.isEmpty() )
+            startCompile( unit, QByteArray() );
+        else
+            startPreprocess( unit );
+    }
+
+    if ( !m_failed && m_running.isEmpty() && m_pendingUnits.isEmpty() )
+    {
+        startLink();
+    }
+}
+
+void ClangClBuildJob::startPreprocess( MsvcBuildPlan::CompileUnit const & unit )
+{
+    // With the PCH the preprocessor would skip what it contains, the key has to see it
+    QStringList args;
+    for ( const QString & arg : unit.arguments )
+    {
+        if ( !arg.startsWith( "/Yu" ) && !arg.startsWith( "/Fp" ) )
+            args << arg;
+    }
+    args << "/E" << unit.source.toLocalFile();
+
+    // The key covers the compiler, the command line and the preprocessed source,
+    // the last two without the workspace root (include directories, PCH, #line)
+    QSharedPointer<PreprocessedHash> hash( new PreprocessedHash );
+    hash->roots = m_workspaceRoots;
+    hash->hash.addData( m_compilerIdentity );
+    hash->hash.addData( relativeToWorkspace( unit.arguments.join('\n').toUtf8(), m_workspaceRoots ) + '\n' );
+
+    QProcess * process = startProcess( "preprocess", unit.source.lastPathSegment(),
+                                       m_toolchain.clangCl, args, QProcess::SeparateChannels );
+
+    // Hash while reading, preprocessed sources can be huge
+    connect( process, &QProcess::readyReadStandardOutput, this, [process, hash]()
+             {
+                 hash->addData( process->readAllStandardOutput() );
+             } );
+
+    connect( process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>( &QProcess::finished ),
+             this, [this, process, unit, hash](int exitCode, QProcess::ExitStatus status)
+             {
+                 m_running.removeOne( process );
+                 hash->addData( process->readAllStandardOutput() );
+                 process->deleteLater();
+
+                 if ( status != QProcess::NormalExit || exitCode != 0 )
+                 {
+                     // Let the compiler report what is wrong
+                     startCompile( unit, QByteArray() );
+                     return;
+                 }
+
+                 const QByteArray key = hash->result();
+
+                 QString diagnostics;
+                 if ( MsvcObjectCache::self().lookup( key, unit.object, diagnostics ) )
+                 {
+                     compilerOutput( unit, diagnostics, true );
+                     unitFinished( unit, true );
+                     return;
+                 }
+
+                 startCompile( unit, key );
+             } );
+}
+
+void ClangClBuildJob::startCompile( MsvcBuildPlan::CompileUnit const & unit, QByteArray const & cacheKey )
+{
+    QStringList args = unit.arguments;
+    args << "/showIncludes" << "/c" << unit.source.toLocalFile()
+         << "/Fo" + unit.object.toLocalFile();
+
+    QProcess * process = startProcess( "compile", unit.source.lastPathSegment(), m_toolchain.clangCl, args );
+    process->setProperty( OUTPUT_PROPERTY, unit.object.toLocalFile() );
+    connect( process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>( &QProcess::finished ),
+             this, [this, process, unit, cacheKey](int exitCode, QProcess::ExitStatus status)
+             {
+                 m_running.removeOne( process );
+                 const QString output = QString::fromLocal8Bit( process->readAll() );
+                 process->deleteLater();
+
+                 const bool success = status == QProcess::NormalExit && exitCode == 0;
+                 compilerOutput( unit, output, success );
+
+                 // The includes are part of the cached output, hits restore them too
+                 if ( success && !cacheKey.isEmpty() )
+                     MsvcObjectCache::self().store( cacheKey, unit.object, output );
+
+                 unitFinished( unit, success );
+             } );
+}
+
+void ClangClBuildJob::compilerOutput( MsvcBuildPlan::CompileUnit const & unit, QString const & output, bool success )
+{
+    KDevelop::Path::List headers;
+    appendLines( MsvcDependencyDatabase::takeIncludes( output, headers ) );
+
+    // A failed compile may have stopped before seeing all the includes
+    if ( success )
+        MsvcDependencyDatabase::self().setDependencies( m_item->project(), unit.source, headers, commandHash( unit ), unit.batch );
+}
+
+void ClangClBuildJob::unitFinished( MsvcBuildPlan::CompileUnit const & unit, bool success )
+{
+    if ( m_buildingPch )
+    {
+        m_buildingPch = false;
+        if ( success && !m_failed )
+        {
+            queueUnits();
+            return;
+        }
+    }
+
+    if ( !success && !unit.batch.isEmpty() && !m_failed )
+    {
+        // Unity builds break on clashing statics and macros, retry the files on their own,
+        // and keep them out of the batches of the next builds
+        m_model->appendLine( i18n("Unity batch %1 failed, compiling its files separately", unit.source.lastPathSegment()) );
+        m_current.rememberFailedBatch( unit );
+
+        for ( int i = 0; i < m_current.units.size(); ++i )
+        {
+            if ( m_current.units.at( i ).object == unit.object )
+            {
+                m_current.units.remove( i );
+                break;
+            }
+        }
+
+        for ( const KDevelop::Path & source : unit.batch )
+        {
+            const MsvcBuildPlan::CompileUnit single = m_current.unitFor( source, unit.arguments );
+            m_current.units << single;
+            m_pendingUnits << single;
+        }
+
+        scheduleCompiles();
+        return;
+    }
+
+    if ( !success )
+    {
+        qCDebug(KDEV_MSVC) << "Failed to compile" << unit.source;
+
+        // Let the running compilations finish, do not start new ones
+        m_failed = true;
+        m_pendingUnits.clear();
+    }
+
+    if ( m_failed )
+    {
+        if ( m_running.isEmpty() )
+            finish( false );
+        return;
+    }
+
+    scheduleCompiles();
+}
+
+void ClangClBuildJob::startLink()
+{
+    QString program;
+    QStringList args;
+    args << "/nologo";
+
+    switch ( m_current.type )
+    {
+    case MsvcProjectConfig::Application:
+    case MsvcProjectConfig::DynamicLibrary:
+        program = m_toolchain.lldLink;
+        if ( m_current.type == MsvcProjectConfig::DynamicLibrary )
+            args << "/dll" << "/implib:" + m_current.importLibrary.toLocalFile();
+        if ( m_current.subSystem == MsvcProjectConfig::SubSystemConsole )
+            args << "/subsystem:console";
+        else if ( m_current.subSystem == MsvcProjectConfig::SubSystemWindows )
+            args << "/subsystem:windows";
+        break;
+    case MsvcProjectConfig::StaticLibrary:
+        program = m_toolchain.llvmLib;
+        break;
+    default:
+        break;
+    }
+
+    if ( program.isEmpty() || !m_linkNeeded )
+    {
+        nextProject();
+        return;
+    }
+
+    // Object lists easily exceed the command line limits on windows
+    const KDevelop::Path rspPath( m_current.intermediateDirectory, m_current.output.lastPathSegment() + ".rsp" );
+    QFile rsp( rspPath.toLocalFile() );
+    if ( !rsp.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        m_model->appendLine( i18n("Cannot write %1", rsp.fileName()) );
+        finish( false );
+        return;
+    }
+
+    // A static library does not take the libraries it depends on, what links it does
+    KDevelop::Path::List inputs = m_current.objects();
+    if ( m_current.type != MsvcProjectConfig::StaticLibrary )
+        inputs << m_current.libraries;
+
+    for ( const KDevelop::Path & input : inputs )
+        rsp.write( '"' + input.toLocalFile().toUtf8() + "\"\n" );
+    rsp.close();
+
+    args << "/out:" + m_current.output.toLocalFile() << "@" + rsp.fileName();
+
+    m_model->appendLine( i18n("Linking %1", m_current.output.lastPathSegment()) );
+
+    QProcess * process = startProcess( "link", m_current.output.lastPathSegment(), program, args );
+    process->setProperty( OUTPUT_PROPERTY, m_current.output.toLocalFile() );
+    connect( process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>( &QProcess::finished ),
+             this, [this, process](int exitCode, QProcess::ExitStatus status)
+             {
+                 m_running.removeOne( process );
+                 appendOutput( process );
+                 process->deleteLater();
+
+                 if ( status != QProcess::NormalExit || exitCode != 0 )
+                     finish( false );
+                 else
+                     nextProject();
+             } );
+}
+
+void ClangClBuildJob::finish( bool success )
+{
+    if ( !success )
+    {
+        setError( FailedShownError );
+        setErrorText( i18n("Build of %1 failed", m_current.name) );
+    }
+
+    if ( !m_compilerIdentity.isEmpty() )
+        MsvcObjectCache::self().sync();
+
+    MsvcDependencyDatabase::self().sync( m_item->project() );
+
+    m_model->appendLine( success ? i18n("*** Finished ***") : i18n("*** Failed ***") );
+    emitResult();
+}
+
+bool ClangClBuildJob::needsCompile( MsvcBuildPlan::CompileUnit const & unit )
+{
+    const QDateTime objectTime = lastModified( unit.object );
+    if ( !objectTime.isValid() || objectTime < lastModified( unit.source ) )
+        return true;
+
+    for ( const KDevelop::Path & source : unit.batch )
+    {
+        if ( objectTime < lastModified( source ) )
+            return true;
+    }
+
+    // A rebuilt PCH invalidates everything using it
+    if ( m_current.hasPch() && unit.arguments.contains( "/Yu" + m_current.pchHeader.toLocalFile() ) &&
+         objectTime < headerTime( m_current.pchFile ) )
+        return true;
+
+    MsvcDependencyDatabase & db = MsvcDependencyDatabase::self();
+
+    // Never compiled by us, we do not know what it includes
+    if ( !db.contains( m_item->project(), unit.source ) )
+        return true;
+
+    // Defines, include directories or optimization changed in the project
+    if ( db.command( m_item->project(), unit.source ) != commandHash( unit ) )
+        return true;
+
+    for ( const KDevelop::Path & header : db.dependencies( m_item->project(), unit.source ) )
+    {
+        const QDateTime time = headerTime( header );
+        if ( !time.isValid() || objectTime < time )
+            return true;
+    }
+    return false;
+}
+
+QDateTime ClangClBuildJob::headerTime( KDevelop::Path const & header )
+{
+    auto it = m_headerTimes.find( header );
+    if ( it == m_headerTimes.end() )
+        it = m_headerTimes.insert( header, lastModified( header ) );
+    return *it;
+}
+
+QProcess * ClangClBuildJob::startProcess( const char * phase, QString const & detail,
+                                          QString const & program, QStringList const & arguments,
+                                          QProcess::ProcessChannelMode mode )
+{
+    QProcess * process = new QProcess( this );
+
+    const qint64 traceStart = MsvcTrace::timestamp();
+    if ( traceStart >= 0 )
+    {
+        connect( process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>( &QProcess::finished ),
+                 this, [phase, detail, traceStart]()
+                 {
+                     MsvcTrace::complete( phase, detail, traceStart );
+                 } );
+    }
+
+    process->setProcessChannelMode( mode );
+    process->setWorkingDirectory( m_current.projectPath.parent().toLocalFile() );
+
+    connect( process, static_cast<void (QProcess::*)(QProcess::ProcessError)>( &QProcess::error ), this, [this, process, program](QProcess::ProcessError error)
+             {
+                 if ( error == QProcess::FailedToStart )
+                 {
+                     m_model->appendLine( i18n("Failed to start %1", program) );
+                     m_running.removeOne( process );
+                     process->deleteLater();
+                     m_failed = true;
+                     m_pendingUnits.clear();
+                     if ( m_running.isEmpty() )
+                         finish( false );
+                 }
+             } );
+
+    m_running << process;
+    process->start( program, arguments );
+    return process;
+}
+
+void ClangClBuildJob::appendOutput( QProcess * process )
+{
+    appendLines( QString::fromLocal8Bit( process->readAll() ) );
+}
+
+void ClangClBuildJob::appendLines( QString const & output )
+{
+    for ( const QString & line : output.split( '\n', QString::SkipEmptyParts ) )
+        m_model->appendLine( line.trimmed() );
+}
@@ -0,0 +1,104 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef CLANGCLBUILDJOB_H
+#define CLANGCLBUILDJOB_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QProcess>
+#include <QVector>
+
+#include <outputview/outputjob.h>
+
+#include "msvcbuildplan.h"
+#include "msvctoolchain.h"
+
+namespace KDevelop
+{
+class OutputModel;
+class ProjectBuildFolderItem;
+}
+
+/**
+ * @brief Builds projects with clang-cl and lld-link directly, without devenv.
+ *
+ * Projects are built one after the other, the translation units of a project
+ * are compiled in parallel on all the cores, then the target is linked.
+ * Cleaning is done by CleanJob, like for the devenv backend.
+ */
+class ClangClBuildJob : public KDevelop::OutputJob
+{
+    Q_OBJECT
+
+public:
+    ClangClBuildJob( QObject* parent, KDevelop::ProjectBuildFolderItem* item );
+
+    void start() override;
+
+protected:
+    bool doKill() override;
+
+private:
+    void nextProject();
+    void queueUnits();
+    void scheduleCompiles();
+    void startPreprocess( MsvcBuildPlan::CompileUnit const & unit );
+    void startCompile( MsvcBuildPlan::CompileUnit const & unit, QByteArray const & cacheKey );
+    void unitFinished( MsvcBuildPlan::CompileUnit const & unit, bool success );
+    void compilerOutput( MsvcBuildPlan::CompileUnit const & unit, QString const & output, bool success );
+    void startLink();
+    void finish( bool success );
+
+    bool needsCompile( MsvcBuildPlan::CompileUnit const & unit );
+    QDateTime headerTime( KDevelop::Path const & header );
+    QProcess * startProcess( const char * phase, QString const & detail,
+                             QString const & program, QStringList const & arguments,
+                             QProcess::ProcessChannelMode mode = QProcess::MergedChannels );
+    void appendOutput( QProcess * process );
+    void appendLines( QString const & output );
+
+    KDevelop::ProjectBuildFolderItem * m_item;
+    MsvcToolchain::Profile m_toolchain;
+    KDevelop::OutputModel * m_model = nullptr;
+
+    QList<MsvcBuildPlan> m_plans;
+    MsvcBuildPlan m_current;
+    QVector<MsvcBuildPlan::CompileUnit> m_pendingUnits;
+    QList<QProcess*> m_running;
+
+    // Headers are shared by many units, stat them once per build
+    QHash<KDevelop::Path, QDateTime> m_headerTimes;
+
+    // Identifies the compiler binary in the object cache keys, empty when the cache is off
+    QByteArray m_compilerIdentity;
+
+    // The workspace root as paths are spelled in arguments and preprocessed sources,
+    // taken out of the cache keys so other checkouts hit the same objects
+    QList<QByteArray> m_workspaceRoots;
+
+    int m_maxJobs;
+    bool m_failed = false;
+    bool m_linkNeeded = false;
+    bool m_buildingPch = false;
+};
+
+#endif //CLANGCLBUILDJOB_H
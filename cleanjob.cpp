@@ -0,0 +1,209 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "cleanjob.h"
+#include "msvcbuildplan.h"
+#include "msvcmodelitems.h"
+#include "msvctoolchain.h"
+#include "debug.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <KLocalizedString>
+
+#include <outputview/ioutputview.h>
+#include <outputview/outputmodel.h>
+
+namespace
+{
+
+// What the linker writes next to the target
+const QStringList TARGET_EXTENSIONS = { "pdb", "ilk", "idb", "exp" };
+
+struct CleanProject
+{
+    typedef CleanJob::Result result_type;
+
+    bool dryRun;
+
+    CleanJob::Result operator()( CleanJob::Outputs const & outputs ) const
+    {
+        return CleanJob::clean( outputs, dryRun );
+    }
+};
+
+}
+
+CleanJob::CleanJob( QObject* parent, KDevelop::ProjectBuildFolderItem* item, bool dryRun ) :
+    KDevelop::OutputJob(parent),
+    m_item(item),
+    m_dryRun(dryRun),
+    m_watcher(new QFutureWatcher<Result>(this))
+{
+    connect( m_watcher, &QFutureWatcher<Result>::finished, this, &CleanJob::finished );
+
+    setCapabilities( Killable );
+    setToolTitle( i18n("Clean") );
+    setStandardToolView( KDevelop::IOutputView::BuildView );
+    setBehaviours( KDevelop::IOutputView::AllowUserClose | KDevelop::IOutputView::AutoScroll );
+
+    setObjectName( dryRun ?
+                   i18n("Clean, dry run (%1)", item->text()) :
+                   i18n("Clean (%1)", item->text()) );
+}
+
+CleanJob::~CleanJob()
+{
+    m_watcher->cancel();
+    m_watcher->waitForFinished();
+}
+
+void CleanJob::start()
+{
+    m_model = new KDevelop::OutputModel( m_item->path().parent().toUrl() );
+    setModel( m_model );
+    startOutput();
+
+    QList<MsvcProjectItem*> projects;
+    if ( MsvcProjectItem * projItem = dynamic_cast<MsvcProjectItem*>(m_item) )
+        projects << projItem;
+    else if ( MsvcSolutionItem * solItem = dynamic_cast<MsvcSolutionItem*>(m_item) )
+        projects = solItem->projects();
+
+    QList<Outputs> work;
+    for ( MsvcProjectItem * proj : projects )
+        work << outputs( proj );
+
+    m_watcher->setFuture( QtConcurrent::mapped( work, CleanProject{ m_dryRun } ) );
+}
+
+bool CleanJob::doKill()
+{
+    m_watcher->disconnect( this );
+    m_watcher->cancel();
+    m_watcher->waitForFinished();
+    return true;
+}
+
+void CleanJob::finished()
+{
+    int removed = 0;
+    int failed = 0;
+
+    for ( const Result & result : m_watcher->future().results() )
+    {
+        for ( const QString & file : result.removed )
+            m_model->appendLine( m_dryRun ? i18n("Would remove %1", file) : i18n("Removed %1", file) );
+
+        for ( const QString & file : result.failed )
+            m_model->appendLine( i18n("Cannot remove %1", file) );
+
+        removed += result.removed.size();
+        failed += result.failed.size();
+    }
+
+    if ( m_dryRun )
+        m_model->appendLine( i18np("1 file would be removed", "%1 files would be removed", removed) );
+    else
+        m_model->appendLine( i18np("Removed 1 file", "Removed %1 files", removed) );
+
+    if ( failed )
+    {
+        setError( FailedShownError );
+        setErrorText( i18np("Could not remove 1 file", "Could not remove %1 files", failed) );
+    }
+
+    emitResult();
+}
+
+CleanJob::Outputs CleanJob::outputs( MsvcProjectItem * project )
+{
+    const MsvcToolchain::Profile toolchain = MsvcToolchain::self().profile( project->project() );
+    const MsvcBuildPlan plan = MsvcBuildPlan::forProject( project, toolchain.unityBatchSize );
+
+    Outputs result;
+    result.name = plan.name;
+    result.files = plan.outputs();
+
+    // What the linker writes next to the target
+    if ( plan.output.isValid() )
+    {
+        const QString baseName = plan.output.lastPathSegment().section('.', 0, -2);
+        for ( const QString & ext : TARGET_EXTENSIONS )
+            result.files << KDevelop::Path( plan.output.parent(), baseName + '.' + ext );
+    }
+
+    // MSBuild keeps its tracking logs in $(IntDir)\<project>.tlog
+    if ( plan.intermediateDirectory.isValid() )
+        result.tlogDirectory = KDevelop::Path( plan.intermediateDirectory, plan.name + ".tlog" );
+
+    return result;
+}
+
+CleanJob::Result CleanJob::clean( Outputs const & outputs, bool dryRun )
+{
+    QStringList files;
+    for ( const KDevelop::Path & file : outputs.files )
+    {
+        if ( file.isLocalFile() && QFileInfo( file.toLocalFile() ).isFile() )
+            files << file.toLocalFile();
+    }
+
+    // Only the project's own files: the intermediate directory may be shared
+    // with other projects, so nothing is removed from it by pattern
+    const QString tlogDirectory = outputs.tlogDirectory.isValid() ? outputs.tlogDirectory.toLocalFile() : QString();
+    if ( !tlogDirectory.isEmpty() && QFileInfo( tlogDirectory ).isDir() )
+    {
+        QDirIterator it( tlogDirectory, QDir::Files, QDirIterator::Subdirectories );
+        while ( it.hasNext() )
+            files << it.next();
+    }
+
+    files.removeDuplicates();
+
+    Result result;
+    result.name = outputs.name;
+
+    if ( dryRun )
+    {
+        result.removed = files;
+        return result;
+    }
+
+    for ( const QString & file : files )
+    {
+        if ( QFile::remove( file ) )
+            result.removed << file;
+        else
+            result.failed << file;
+    }
+
+    if ( !tlogDirectory.isEmpty() )
+        QDir().rmdir( tlogDirectory );
+
+    qCDebug(KDEV_MSVC) << "Cleaned" << outputs.name << ":" << result.removed.size() << "files";
+    return result;
+}
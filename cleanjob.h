@@ -0,0 +1,95 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef CLEANJOB_H
+#define CLEANJOB_H
+
+#include <QStringList>
+
+#include <outputview/outputjob.h>
+
+#include <kdevplatform/util/path.h>
+
+template<class> class QFutureWatcher;
+
+namespace KDevelop
+{
+class OutputModel;
+class ProjectBuildFolderItem;
+}
+
+class MsvcProjectItem;
+
+/**
+ * @brief Deletes the outputs of projects directly, without running devenv /Clean.
+ *
+ * The outputs are those the build plan of the current configuration writes
+ * (target, objects, PCH, generated sources) plus the linker side files and
+ * the MSBuild tracking logs of the project. Nothing else in the intermediate
+ * directory is touched. Projects are cleaned in parallel, one task per
+ * project. In dry run mode the files are only listed.
+ */
+class CleanJob : public KDevelop::OutputJob
+{
+    Q_OBJECT
+
+public:
+    CleanJob( QObject* parent, KDevelop::ProjectBuildFolderItem* item, bool dryRun = false );
+    ~CleanJob() override;
+
+    void start() override;
+
+    /**
+     * @brief What cleaning a project looks at, collected on the GUI thread.
+     */
+    struct Outputs
+    {
+        QString name;
+        KDevelop::Path::List files;
+        KDevelop::Path tlogDirectory;
+    };
+
+    struct Result
+    {
+        QString name;
+        QStringList removed;
+        QStringList failed;
+    };
+
+    static Outputs outputs( MsvcProjectItem * project );
+
+    /**
+     * @brief Deletes (or with @p dryRun only lists) the files of @p outputs, thread safe.
+     */
+    static Result clean( Outputs const & outputs, bool dryRun );
+
+protected:
+    bool doKill() override;
+
+private:
+    void finished();
+
+    KDevelop::ProjectBuildFolderItem * m_item;
+    bool m_dryRun;
+    KDevelop::OutputModel * m_model = nullptr;
+    QFutureWatcher<Result> * m_watcher;
+};
+
+#endif //CLEANJOB_H
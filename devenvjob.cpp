@@ -21,12 +21,10 @@
 
 #include "devenvjob.h"
 #include "debug.h"
-#include "msvcconfig.h"
+#include "msvctoolchain.h"
 
-#include <QFileInfo>
 #include <QRegularExpression>
 
-#include <KConfigGroup>
 #include <KLocalizedString>
 
 #include <interfaces/iproject.h>
@@ -98,24 +96,16 @@ QStringList DevEnvJob::commandLine() const
     if ( !m_item )
         return QStringList();
     
-    KSharedConfigPtr configPtr = m_item->project()->projectConfiguration();
+    const MsvcToolchain::Profile toolchain = MsvcToolchain::self().profile( m_item->project() );
     
-    qCWarning(KDEV_MSVC) << configPtr->group("Project").groupList();
-    
-    KConfigGroup builderGroup( configPtr, MsvcConfig::CONFIG_GROUP );
-    
-    QString builder = builderGroup.readEntry( MsvcConfig::DEVENV_BINARY, QString() );
-    
-    QFileInfo fi(builder);
-    if (!fi.exists() || !fi.isExecutable())
+    if ( !toolchain.valid )
     {
-        qCWarning(KDEV_MSVC) << "Badly configured devenv.exe";
         return {};
     }
     
     // Note: this command line seems to work with both .sln and .vcproj
     QStringList result;
-    result << builder;
+    result << toolchain.devenv.toLocalFile();
     
     result << m_item->path().toLocalFile();
     
@@ -130,7 +120,7 @@ QStringList DevEnvJob::commandLine() const
         break;
     }
    
-    result << builderGroup.readEntry( MsvcConfig::ACTIVE_CONFIGURATION, "Debug");
+    result << toolchain.configuration;
     
     return result;
 }
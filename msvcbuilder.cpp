@@ -20,10 +20,81 @@
 
 
 #include "msvcbuilder.h"
+#include "clangclbuildjob.h"
+#include "cleanjob.h"
 #include "devenvjob.h"
+#include "msvcbuildqueue.h"
+#include "msvcconfig.h"
+#include "msvctoolchain.h"
+#include "ninjajob.h"
+#include "uptodatejob.h"
+#include "msvcmodelitems.h"
+#include "msvcprojectgraph.h"
+#include "debug.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+
+namespace
+{
+
+QDateTime lastModified( KDevelop::Path const & path )
+{
+    if ( !path.isValid() || !path.isLocalFile() )
+        return QDateTime();
+
+    QFileInfo info( path.toLocalFile() );
+    return info.exists() ? info.lastModified() : QDateTime();
+}
+
+// Newest modification time of every file below item.
+QDateTime newestInput( KDevelop::ProjectBaseItem * item )
+{
+    KDevelop::Path::List files;
+    if ( MsvcFilterItem * filter = dynamic_cast<MsvcFilterItem*>( item ) )
+        files = filter->pendingFilePaths();
+
+    QDateTime result;
+    for ( const KDevelop::Path & path : files )
+    {
+        const QDateTime t = lastModified( path );
+        if ( t.isValid() && (!result.isValid() || t > result) )
+            result = t;
+    }
+
+    for ( KDevelop::ProjectBaseItem * child : item->children() )
+    {
+        const QDateTime t = child->file() ? lastModified( child->path() ) : newestInput( child );
+
+        if ( t.isValid() && (!result.isValid() || t > result) )
+            result = t;
+    }
+    return result;
+}
+
+}
+
+MsvcBuilder::MsvcBuilder() :
+    m_queue( new MsvcBuildQueue( &MsvcBuilder::createBuildJob ) )
+{
+}
+
+MsvcBuilder::~MsvcBuilder()
+{
+    delete m_queue;
+}
 
 KJob * MsvcBuilder::build(KDevelop::ProjectBaseItem* item)
 {
+    auto * folder = dynamic_cast<KDevelop::ProjectBuildFolderItem*>(item);
+    if ( folder && isUpToDate(folder) )
+    {
+        UpToDateJob * job = new UpToDateJob(nullptr, folder);
+        job->setAutoDelete(true);
+        return job;
+    }
+
     return runDevEnv(item, DevEnvJob::BuildCommand);
 }
 
@@ -32,14 +103,109 @@ KJob * MsvcBuilder::clean(KDevelop::ProjectBaseItem* item)
     return runDevEnv(item, DevEnvJob::CleanCommand);
 }
 
-DevEnvJob* MsvcBuilder::runDevEnv(KDevelop::ProjectBaseItem  * item, DevEnvJob::CommandType type)
+KJob* MsvcBuilder::runDevEnv(KDevelop::ProjectBaseItem  * item, DevEnvJob::CommandType type)
 {
     if ( KDevelop::ProjectBuildFolderItem * solItem = dynamic_cast<KDevelop::ProjectBuildFolderItem*>(item) )
     {
-        DevEnvJob * job = new DevEnvJob(nullptr, solItem, type );
+        // Devenv itself runs from the queue, so overlapping requests share one build.
+        MsvcBuildRequestJob * job = new MsvcBuildRequestJob(m_queue, solItem, type );
         job->setAutoDelete(true);
         return job;
     }
     
     return nullptr;
 }
+
+KJob* MsvcBuilder::createBuildJob( KDevelop::ProjectBuildFolderItem * item, DevEnvJob::CommandType type )
+{
+    const MsvcToolchain::Profile toolchain = MsvcToolchain::self().profile( item->project() );
+
+    if ( toolchain.backend == MsvcConfig::BACKEND_NINJA )
+        return new NinjaJob( nullptr, item, type );
+
+    // Deleting the outputs ourselves is much faster than devenv /Clean
+    if ( type == DevEnvJob::CleanCommand )
+        return new CleanJob( nullptr, item );
+
+    if ( toolchain.backend == MsvcConfig::BACKEND_CLANGCL )
+        return new ClangClBuildJob( nullptr, item );
+
+    return new DevEnvJob( nullptr, item, type );
+}
+
+bool MsvcBuilder::isUpToDate( KDevelop::ProjectBuildFolderItem * item ) const
+{
+    QList<MsvcProjectItem*> projects;
+    std::shared_ptr<const MsvcProjectGraph> graph;
+
+    if ( auto * proj = dynamic_cast<MsvcProjectItem*>(item) )
+    {
+        projects << proj;
+
+        // The projects it depends on are built with it
+        if ( auto * sol = dynamic_cast<MsvcSolutionItem*>(proj->parent()) )
+        {
+            graph = sol->dependencyGraph();
+            projects = graph->upstream( proj ) << proj;
+        }
+    }
+    else if ( auto * sol = dynamic_cast<MsvcSolutionItem*>(item) )
+    {
+        graph = sol->dependencyGraph();
+        projects = graph->buildOrder();
+    }
+
+    if ( projects.isEmpty() )
+        return false;
+
+    // The solution (or project) file itself is an input for everything
+    const QDateTime itemTime = lastModified( item->path() );
+    if ( !itemTime.isValid() )
+        return false;
+
+    // In build order, so the outputs of the dependencies are known
+    QHash<MsvcProjectItem*, QDateTime> outputTimes;
+    for ( MsvcProjectItem * proj : projects )
+    {
+        QDateTime newerThan = itemTime;
+        if ( graph )
+        {
+            for ( MsvcProjectItem * dependency : graph->dependencies( proj ) )
+                newerThan = qMax( newerThan, outputTimes.value( dependency ) );
+        }
+
+        const QDateTime outputTime = projectOutputTime( proj, newerThan );
+        if ( !outputTime.isValid() )
+        {
+            qCDebug(KDEV_MSVC) << proj->text() << "is out of date";
+            return false;
+        }
+        outputTimes.insert( proj, outputTime );
+    }
+
+    return true;
+}
+
+QDateTime MsvcBuilder::projectOutputTime( MsvcProjectItem * proj, QDateTime const & newerThan ) const
+{
+    const KDevelop::Path output = proj->targetPath();
+    const QDateTime outputTime = lastModified( output );
+
+    if ( !outputTime.isValid() || outputTime < newerThan )
+        return QDateTime();
+
+    // The item tree includes the project file, vcxproj keep their filters aside.
+    QDateTime inputTime = newestInput( proj );
+
+    KDevelop::Path filtersPath = proj->path();
+    filtersPath.setLastPathSegment( filtersPath.lastPathSegment() + ".filters" );
+    const QDateTime filtersTime = lastModified( filtersPath );
+
+    if ( filtersTime.isValid() && (!inputTime.isValid() || filtersTime > inputTime) )
+        inputTime = filtersTime;
+
+    if ( !inputTime.isValid() || outputTime < inputTime )
+        return QDateTime();
+
+    return outputTime;
+}
@@ -25,14 +25,23 @@
 
 #include "devenvjob.h"
 
+class QDateTime;
+
 namespace KDevelop 
 {
 class ProjectBaseItem;
+class ProjectBuildFolderItem;
 }
 
+class MsvcProjectItem;
+class MsvcBuildQueue;
+
 class MsvcBuilder : public KDevelop::IProjectBuilder
 {
 public:
+    MsvcBuilder();
+    ~MsvcBuilder() override;
+
     KJob* install(KDevelop::ProjectBaseItem* /*item*/, const QUrl &/*specificPrefix*/ = {}) override
     {
         return nullptr;
@@ -42,7 +51,27 @@ public:
     KJob* clean(KDevelop::ProjectBaseItem * item) override;
     
 private:
-    DevEnvJob* runDevEnv(KDevelop::ProjectBaseItem  *, DevEnvJob::CommandType );
+    KJob* runDevEnv(KDevelop::ProjectBaseItem  *, DevEnvJob::CommandType );
+
+    /**
+     * @brief Creates the job for the configured backend, run by the build queue.
+     */
+    static KJob* createBuildJob( KDevelop::ProjectBuildFolderItem *, DevEnvJob::CommandType );
+
+    /**
+     * @brief Returns true if no output of @p item is older than its inputs.
+     *
+     * This only looks at timestamps, anything we can not resolve is considered out of date.
+     */
+    bool isUpToDate( KDevelop::ProjectBuildFolderItem * item ) const;
+
+    /**
+     * @brief Returns the time the output of @p proj was written, or an invalid
+     * QDateTime if the project needs to be built.
+     */
+    QDateTime projectOutputTime( MsvcProjectItem * proj, QDateTime const & newerThan ) const;
+
+    MsvcBuildQueue * m_queue;
 
 };
 
@@ -20,8 +20,10 @@
 
 
 #include "msvcbuilderpreferences.h"
+#include "msvccompilecommands.h"
 #include "msvcconfig.h"
 #include "msvcmodelitems.h"
+#include "msvctoolchain.h"
 #include "debug.h"
 #include "ui_msvcconfig.h"
 
@@ -40,7 +42,7 @@ MsvcBuilderPreferences::MsvcBuilderPreferences(KDevelop::IPlugin* plugin,
 {
     m_configUi->setupUi(this);
 
-    auto compilers = MsvcConfig::findMSVC();
+    auto compilers = MsvcToolchain::self().installedCompilers();
 
     KComboBox * compVersionComboBox = m_configUi->version_combo;
     for (auto const & x : compilers )
@@ -76,6 +78,10 @@ MsvcBuilderPreferences::MsvcBuilderPreferences(KDevelop::IPlugin* plugin,
             m_configUi->config_combo->addItem( *iter );
     }
 
+    m_configUi->backend_combo->addItem( i18n("Visual Studio (devenv)"), QString(MsvcConfig::BACKEND_DEVENV) );
+    m_configUi->backend_combo->addItem( i18n("Ninja (clang-cl)"), QString(MsvcConfig::BACKEND_NINJA) );
+    m_configUi->backend_combo->addItem( i18n("clang-cl and lld-link"), QString(MsvcConfig::BACKEND_CLANGCL) );
+
     connect(compVersionComboBox, static_cast<void (QComboBox::*)(int)>( &KComboBox::currentIndexChanged ),
             this, showHideCustomCompPath);
 
@@ -87,6 +93,12 @@ MsvcBuilderPreferences::MsvcBuilderPreferences(KDevelop::IPlugin* plugin,
     connect( m_configUi->msvc_include, &KUrlRequester::textChanged, this, [this](QString const &) { emit changed(); } );
     connect( m_configUi->config_combo, static_cast<void (QComboBox::*)(int)>( &QComboBox::currentIndexChanged ), this, [this](int) { emit changed(); } );
     connect( m_configUi->arch_combo, static_cast<void (QComboBox::*)(int)>( &QComboBox::currentIndexChanged ), this, [this](int) { emit changed(); } );
+    connect( m_configUi->backend_combo, static_cast<void (QComboBox::*)(int)>( &QComboBox::currentIndexChanged ), this, [this](int) { emit changed(); } );
+    connect( m_configUi->export_compile_commands, &QCheckBox::toggled, this, [this](bool) { emit changed(); } );
+    connect( m_configUi->object_cache, &QCheckBox::toggled, this, [this](bool) { emit changed(); } );
+    connect( m_configUi->unity_build, &QCheckBox::toggled, this, [this](bool) { emit changed(); } );
+    connect( m_configUi->unity_build, &QCheckBox::toggled, m_configUi->unity_batch_size, &QWidget::setEnabled );
+    connect( m_configUi->unity_batch_size, static_cast<void (QSpinBox::*)(int)>( &QSpinBox::valueChanged ), this, [this](int) { emit changed(); } );
 }
 
 MsvcBuilderPreferences::~MsvcBuilderPreferences()
@@ -113,16 +125,25 @@ void MsvcBuilderPreferences::apply()
     //TODO saving currentText is not very pretty...
     cg.writeEntry( MsvcConfig::ACTIVE_CONFIGURATION, m_configUi->config_combo->currentText() );
     cg.writeEntry( MsvcConfig::ACTIVE_ARCHITECTURE, m_configUi->arch_combo->currentText() );
+    cg.writeEntry( MsvcConfig::BUILD_BACKEND, m_configUi->backend_combo->currentData().toString() );
+    cg.writeEntry( MsvcConfig::EXPORT_COMPILE_COMMANDS, m_configUi->export_compile_commands->isChecked() );
+    cg.writeEntry( MsvcConfig::OBJECT_CACHE, m_configUi->object_cache->isChecked() );
+    cg.writeEntry( MsvcConfig::UNITY_BUILD, m_configUi->unity_build->isChecked() );
+    cg.writeEntry( MsvcConfig::UNITY_BATCH_SIZE, m_configUi->unity_batch_size->value() );
     
     // Hidden for now
     if ( !cg.hasKey( MsvcConfig::WINSDK_INCLUDE ) )
     {
-        KDevelop::Path sdkPath = MsvcConfig::findWinSdk();
+        KDevelop::Path sdkPath = MsvcToolchain::self().winSdk();
         if ( sdkPath.isValid() )
         {
             cg.writeEntry( MsvcConfig::WINSDK_INCLUDE, sdkPath.toLocalFile() );
         }
     }
+
+    MsvcToolchain::self().invalidate( m_project );
+
+    MsvcCompileCommandsExporter::exportIfEnabled( m_project );
 }
 
 void MsvcBuilderPreferences::reset()
@@ -150,6 +171,13 @@ void MsvcBuilderPreferences::reset()
     m_configUi->msvc_include->setUrl( cg.readEntry( MsvcConfig::MSVC_INCLUDE, QString() ) );
     m_configUi->config_combo->setCurrentItem( cg.readEntry( MsvcConfig::ACTIVE_CONFIGURATION, QString() ) );
     m_configUi->arch_combo->setCurrentItem( cg.readEntry( MsvcConfig::ACTIVE_ARCHITECTURE, QString() ) );
+    const int backendIndex = m_configUi->backend_combo->findData( cg.readEntry( MsvcConfig::BUILD_BACKEND, MsvcConfig::BACKEND_DEVENV ) );
+    m_configUi->backend_combo->setCurrentIndex( qMax( backendIndex, 0 ) );
+    m_configUi->export_compile_commands->setChecked( cg.readEntry( MsvcConfig::EXPORT_COMPILE_COMMANDS, false ) );
+    m_configUi->object_cache->setChecked( cg.readEntry( MsvcConfig::OBJECT_CACHE, false ) );
+    m_configUi->unity_build->setChecked( cg.readEntry( MsvcConfig::UNITY_BUILD, false ) );
+    m_configUi->unity_batch_size->setValue( cg.readEntry( MsvcConfig::UNITY_BATCH_SIZE, 8 ) );
+    m_configUi->unity_batch_size->setEnabled( m_configUi->unity_build->isChecked() );
 }
 
 QString MsvcBuilderPreferences::name() const
@@ -0,0 +1,340 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "msvcbuildplan.h"
+#include "msvccompileflags.h"
+#include "msvcmodelitems.h"
+#include "msvcprojectgraph.h"
+#include "debug.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+
+namespace
+{
+
+// Leave generated sources alone when nothing changed, they would be recompiled for nothing
+bool writeIfChanged( KDevelop::Path const & path, QByteArray const & content )
+{
+    QFile file( path.toLocalFile() );
+    if ( file.open( QIODevice::ReadOnly ) && file.readAll() == content )
+        return true;
+
+    file.close();
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        qCWarning(KDEV_MSVC) << "Cannot write" << file.fileName();
+        return false;
+    }
+    return file.write( content ) == content.size();
+}
+
+QByteArray includeLine( KDevelop::Path const & path )
+{
+    return "#include \"" + path.toLocalFile().toUtf8() + "\"\n";
+}
+
+// foo.dll links against foo.lib
+KDevelop::Path importLibraryOf( KDevelop::Path const & dll )
+{
+    return KDevelop::Path( dll.parent(), dll.lastPathSegment().section('.', 0, -2) + ".lib" );
+}
+
+}
+
+KDevelop::Path::List MsvcBuildPlan::objects() const
+{
+    KDevelop::Path::List result;
+    result.reserve( units.size() );
+    if ( hasPch() )
+        result << pch.object;
+    for ( const CompileUnit & unit : units )
+        result << unit.object;
+    return result;
+}
+
+KDevelop::Path::List MsvcBuildPlan::outputs() const
+{
+    KDevelop::Path::List result = objects();
+    result << output << importLibrary << pchFile << unityFailures;
+
+    if ( hasPch() )
+        result << pch.source;
+    for ( const CompileUnit & unit : units )
+    {
+        if ( !unit.generated.isEmpty() )
+            result << unit.source;
+    }
+
+    result.removeAll( KDevelop::Path() );
+    return result;
+}
+
+bool MsvcBuildPlan::writeSources()
+{
+    QDir().mkpath( intermediateDirectory.toLocalFile() );
+
+    if ( hasPch() && !writeIfChanged( pch.source, pch.generated ) )
+        return false;
+
+    QVector<CompileUnit> result;
+    result.reserve( units.size() );
+    for ( const CompileUnit & unit : units )
+    {
+        if ( unit.generated.isEmpty() || writeIfChanged( unit.source, unit.generated ) )
+        {
+            result << unit;
+            continue;
+        }
+
+        for ( const KDevelop::Path & source : unit.batch )
+            result << unitFor( source, unit.arguments );
+    }
+
+    units = result;
+    return true;
+}
+
+MsvcBuildPlan::CompileUnit MsvcBuildPlan::unitFor( KDevelop::Path const & source, QStringList const & arguments ) const
+{
+    // Same naming as cl.exe: $(IntDir)\<basename>.obj
+    QString baseName = source.lastPathSegment().section('.', 0, -2);
+
+    if ( sharedBaseNames.contains( baseName.toLower() ) )
+    {
+        const QByteArray directory = source.parent().toLocalFile().toLower().toUtf8();
+        baseName += '-' + QString::fromLatin1( QCryptographicHash::hash( directory, QCryptographicHash::Md5 ).toHex().left( 8 ) );
+    }
+
+    CompileUnit unit;
+    unit.source = source;
+    unit.object = KDevelop::Path( intermediateDirectory, baseName + ".obj" );
+    unit.arguments = arguments;
+    return unit;
+}
+
+MsvcBuildPlan MsvcBuildPlan::forProject( MsvcProjectItem * project, int unityBatchSize )
+{
+    const MsvcCompileFlags flags( project );
+
+    MsvcBuildPlan plan;
+    plan.name = project->text();
+    plan.projectPath = project->path();
+    plan.type = flags.config().configurationType;
+    plan.subSystem = flags.config().subSystem;
+    plan.output = project->targetPath();
+    plan.intermediateDirectory = project->intermediatePath();
+    if ( plan.type == MsvcProjectConfig::DynamicLibrary && plan.output.isValid() )
+        plan.importLibrary = importLibraryOf( plan.output );
+
+    if ( MsvcSolutionItem * solItem = dynamic_cast<MsvcSolutionItem*>( project->parent() ) )
+    {
+        for ( MsvcProjectItem * dependency : solItem->dependencyGraph()->dependencies( project ) )
+        {
+            const KDevelop::Path library = linkLibrary( dependency );
+            if ( library.isValid() )
+                plan.libraries << library;
+        }
+    }
+
+    if ( plan.isValid() )
+        plan.makePch( flags );
+
+    const QStringList pchArguments = plan.hasPch() ?
+                                     QStringList{ "/Yu" + plan.pchHeader.toLocalFile(), "/Fp" + plan.pchFile.toLocalFile() } :
+                                     QStringList();
+
+    const KDevelop::Path::List sources = flags.sources();
+
+    // The intermediate directory is flat, a.cpp and sub/a.cpp would both end up in a.obj
+    QSet<QString> baseNames;
+    for ( const KDevelop::Path & source : sources )
+    {
+        const QString baseName = source.lastPathSegment().section('.', 0, -2).toLower();
+        if ( baseNames.contains( baseName ) )
+            plan.sharedBaseNames.insert( baseName );
+        baseNames.insert( baseName );
+    }
+
+    plan.units.reserve( sources.size() );
+    for ( const KDevelop::Path & source : sources )
+    {
+        const MsvcCompileFlags sourceFlags = flags.forSource( source );
+        QStringList arguments = sourceFlags.arguments( source );
+
+        // A C++ PCH can not be used from C, devenv projects turn it off for those files.
+        // Files with a PCH of their own are compiled without, we only build the project one
+        bool usePch = !sourceFlags.isC( source );
+        if ( usePch && plan.hasPch() && flags.hasOwnSettings( source ) )
+        {
+            usePch = sourceFlags.config().pchUsage != MsvcProjectConfig::PchNotUsing &&
+                     sourceFlags.pchHeader() == plan.pchHeader && sourceFlags.pchFile() == plan.pchFile;
+        }
+        if ( usePch )
+            arguments << pchArguments;
+
+        plan.units << plan.unitFor( source, arguments );
+    }
+
+    if ( unityBatchSize > 1 && plan.isValid() )
+        plan.makeUnity( flags, unityBatchSize );
+
+    return plan;
+}
+
+KDevelop::Path MsvcBuildPlan::linkLibrary( MsvcProjectItem * project )
+{
+    const KDevelop::Path target = project->targetPath();
+    if ( !target.isValid() )
+        return KDevelop::Path();
+
+    switch ( MsvcCompileFlags( project ).config().configurationType )
+    {
+    case MsvcProjectConfig::StaticLibrary:
+        return target;
+    case MsvcProjectConfig::DynamicLibrary:
+        return importLibraryOf( target );
+    default:
+        return KDevelop::Path();
+    }
+}
+
+void MsvcBuildPlan::makePch( MsvcCompileFlags const & flags )
+{
+    const KDevelop::Path header = flags.pchHeader();
+    const KDevelop::Path file = flags.pchFile();
+    if ( !header.isValid() || !file.isValid() )
+        return;
+
+    // Built from its own source, so we do not depend on the stdafx.cpp of the
+    // project which may not be marked as the one creating the PCH
+    CompileUnit unit;
+    unit.source = KDevelop::Path( intermediateDirectory, name + "-pch.cpp" );
+    unit.object = KDevelop::Path( intermediateDirectory, name + "-pch.obj" );
+    unit.arguments = flags.arguments( unit.source );
+    unit.arguments << "/Yc" + header.toLocalFile() << "/Fp" + file.toLocalFile();
+    unit.generated = "// Generated by KDevelop, do not edit\n" + includeLine( header );
+
+    pchHeader = header;
+    pchFile = file;
+    pch = unit;
+}
+
+void MsvcBuildPlan::rememberFailedBatch( CompileUnit const & unit ) const
+{
+    if ( !unityFailures.isValid() || unit.batch.isEmpty() )
+        return;
+
+    QFile file( unityFailures.toLocalFile() );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Append ) )
+    {
+        qCWarning(KDEV_MSVC) << "Cannot write" << file.fileName();
+        return;
+    }
+
+    for ( const KDevelop::Path & source : unit.batch )
+        file.write( source.toLocalFile().toUtf8() + '\n' );
+}
+
+void MsvcBuildPlan::makeUnity( MsvcCompileFlags const & flags, int batchSize )
+{
+    unityFailures = KDevelop::Path( intermediateDirectory, name + "-unity-failed.txt" );
+
+    QSet<QString> failed;
+    QFile failures( unityFailures.toLocalFile() );
+    if ( failures.open( QIODevice::ReadOnly ) )
+    {
+        for ( const QByteArray & line : failures.readAll().split( '\n' ) )
+        {
+            if ( !line.isEmpty() )
+                failed.insert( QString::fromUtf8( line ) );
+        }
+    }
+
+    // Only files sharing the whole command line (defines, PCH...) and the
+    // language can go together, a .c file included by a .cpp would be compiled as C++.
+    // The arguments and the language are those of the file, with its own settings
+    QVector< QVector<CompileUnit> > groups;
+    QVector<bool> groupIsC;
+    QHash<QString, int> groupIndex;
+    QVector<CompileUnit> alone;
+    for ( const CompileUnit & unit : units )
+    {
+        if ( failed.contains( unit.source.toLocalFile() ) )
+        {
+            alone << unit;
+            continue;
+        }
+
+        const bool c = flags.isC( unit.source );
+        const QString key = ( c ? QStringLiteral("c\n") : QStringLiteral("c++\n") ) + unit.arguments.join('\n');
+        auto it = groupIndex.find( key );
+        if ( it == groupIndex.end() )
+        {
+            it = groupIndex.insert( key, groups.size() );
+            groups.resize( groups.size() + 1 );
+            groupIsC << c;
+        }
+        groups[ *it ] << unit;
+    }
+
+    QVector<CompileUnit> result = alone;
+    int count = 0;
+    for ( int g = 0; g < groups.size(); ++g )
+    {
+        const QVector<CompileUnit> & group = groups.at( g );
+        for ( int first = 0; first < group.size(); first += batchSize )
+        {
+            const int size = qMin( batchSize, group.size() - first );
+            if ( size == 1 )
+            {
+                result << group.at( first );
+                continue;
+            }
+
+            const QString baseName = QStringLiteral("%1-unity-%2").arg( name ).arg( ++count );
+
+            CompileUnit unity;
+            unity.source = KDevelop::Path( intermediateDirectory, baseName + ( groupIsC.at( g ) ? ".c" : ".cpp" ) );
+            unity.object = KDevelop::Path( intermediateDirectory, baseName + ".obj" );
+            unity.arguments = group.at( first ).arguments;
+
+            QByteArray content = "// Generated by KDevelop, do not edit\n";
+
+            // With /Yu the PCH header has to come first
+            if ( hasPch() && unity.arguments.contains( "/Yu" + pchHeader.toLocalFile() ) )
+                content += includeLine( pchHeader );
+
+            for ( int i = first; i < first + size; ++i )
+            {
+                unity.batch << group.at( i ).source;
+                content += includeLine( group.at( i ).source );
+            }
+
+            unity.generated = content;
+            result << unity;
+        }
+    }
+
+    units = result;
+}
@@ -0,0 +1,136 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCBUILDPLAN_H
+#define MSVCBUILDPLAN_H
+
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+#include <kdevplatform/util/path.h>
+
+#include "msvcprojectconfig.h"
+
+class MsvcCompileFlags;
+class MsvcProjectItem;
+
+/**
+ * @brief What has to be run to build a project without devenv.
+ *
+ * This is computed from the model on the GUI thread and then handed to
+ * the generators / builders that run the compiler themselves.
+ */
+struct MsvcBuildPlan
+{
+    struct CompileUnit
+    {
+        KDevelop::Path  source;
+        KDevelop::Path  object;
+        QStringList     arguments;
+
+        // The files included by source when it is a generated unity file
+        KDevelop::Path::List batch;
+
+        // Content of source when the plan generates it (unity files, PCH source)
+        QByteArray generated;
+    };
+
+    QString                         name;
+    KDevelop::Path                  projectPath;
+    MsvcProjectConfig::TargetType   type = MsvcProjectConfig::Unknown;
+    MsvcProjectConfig::SubSystem    subSystem = MsvcProjectConfig::SubSystemNotSet;
+    KDevelop::Path                  output;
+    KDevelop::Path                  importLibrary;  // of a dll, written by the linker next to it
+    KDevelop::Path                  intermediateDirectory;
+    KDevelop::Path::List            libraries;      // linkLibrary() of the projects it depends on
+    QVector<CompileUnit>            units;
+
+    // Precompiled header, built from a generated source before the units
+    KDevelop::Path                  pchHeader;
+    KDevelop::Path                  pchFile;
+    CompileUnit                     pch;
+
+    // Sources of unity batches that failed, they are compiled on their own from then on
+    KDevelop::Path                  unityFailures;
+
+    /**
+     * @brief Returns false when the project can not be built this way.
+     */
+    bool isValid() const { return output.isValid() && intermediateDirectory.isValid(); }
+
+    bool hasPch() const { return pchFile.isValid(); }
+
+    /**
+     * @brief The objects the target is linked from.
+     */
+    KDevelop::Path::List objects() const;
+
+    /**
+     * @brief Every file building the plan writes: target, objects, PCH and generated sources.
+     */
+    KDevelop::Path::List outputs() const;
+
+    /**
+     * @brief Writes the generated sources to the intermediate directory, unchanged
+     * ones are left alone. A unity file that can not be written is replaced by
+     * the units of its files. Returns false if the PCH source can not be written.
+     */
+    bool writeSources();
+
+    /**
+     * @brief The unit compiling @p source on its own.
+     *
+     * The object is named like cl.exe does, $(IntDir)\<basename>.obj, unless
+     * another source of the project has the same base name: those get a short
+     * hash of their directory so they do not overwrite each other.
+     */
+    CompileUnit unitFor( KDevelop::Path const & source, QStringList const & arguments ) const;
+
+    /**
+     * @brief Keep the files of the unity batch @p unit out of the batches of later builds.
+     */
+    void rememberFailedBatch( CompileUnit const & unit ) const;
+
+    /**
+     * @brief Computes the plan of @p project.
+     *
+     * With @p unityBatchSize > 1, files of the same language compiled with the
+     * same arguments are grouped in batches of at most that many files and the
+     * unity sources including them are generated in the intermediate directory.
+     * Nothing is written to disk until writeSources() is called.
+     */
+    static MsvcBuildPlan forProject( MsvcProjectItem * project, int unityBatchSize = 0 );
+
+    /**
+     * @brief What linking against @p project means: its static library or the
+     * import library of its dll, invalid for anything else.
+     */
+    static KDevelop::Path linkLibrary( MsvcProjectItem * project );
+
+private:
+    void makePch( MsvcCompileFlags const & flags );
+    void makeUnity( MsvcCompileFlags const & flags, int batchSize );
+
+    // Lower case base names used by more than one source
+    QSet<QString> sharedBaseNames;
+};
+
+#endif //MSVCBUILDPLAN_H
@@ -0,0 +1,221 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "msvcbuildqueue.h"
+#include "msvcmodelitems.h"
+#include "msvctrace.h"
+#include "debug.h"
+
+#include <interfaces/iproject.h>
+
+#include <KLocalizedString>
+
+MsvcBuildRequestJob::MsvcBuildRequestJob( MsvcBuildQueue * queue,
+                                          KDevelop::ProjectBuildFolderItem * item,
+                                          DevEnvJob::CommandType command ) :
+    m_queue(queue),
+    m_project(item->project()),
+    m_path(item->path()),
+    m_command(command)
+{
+    setCapabilities( Killable );
+    setObjectName( command == DevEnvJob::CleanCommand ?
+                   i18n("Clean (%1)", item->text()) :
+                   i18n("Build (%1)", item->text()) );
+}
+
+void MsvcBuildRequestJob::start()
+{
+    if ( !m_queue )
+    {
+        setError( UserDefinedError );
+        setErrorText( i18n("The build queue is gone") );
+        emitResult();
+        return;
+    }
+
+    m_queue->enqueue( this );
+}
+
+void MsvcBuildRequestJob::buildFinished( KJob * build )
+{
+    if ( build && build->error() )
+    {
+        setError( build->error() );
+        setErrorText( build->errorText() );
+    }
+    emitResult();
+}
+
+bool MsvcBuildRequestJob::doKill()
+{
+    if ( m_queue )
+        m_queue->cancel( this );
+    return true;
+}
+
+MsvcBuildQueue::MsvcBuildQueue( JobFactory factory, QObject * parent ) :
+    QObject(parent),
+    m_factory(factory),
+    m_running{ nullptr, KDevelop::Path(), DevEnvJob::BuildCommand, {} }
+{
+}
+
+MsvcBuildQueue::~MsvcBuildQueue()
+{
+    if ( m_runningJob )
+        m_runningJob->kill( KJob::Quietly );
+}
+
+bool MsvcBuildQueue::covers( const Entry & entry, const Entry & other )
+{
+    if ( entry.command != other.command || !entry.project || entry.project != other.project )
+        return false;
+
+    if ( entry.path == other.path )
+        return true;
+
+    // A solution covers its projects
+    KDevelop::ProjectBaseItem * item = MsvcSolutionItem::findBuildItem( entry.project, entry.path );
+    for ( KDevelop::ProjectBaseItem * p = MsvcSolutionItem::findBuildItem( other.project, other.path ); item && p; p = p->parent() )
+    {
+        if ( p == item )
+            return true;
+    }
+    return false;
+}
+
+void MsvcBuildQueue::enqueue( MsvcBuildRequestJob * request )
+{
+    // Requests only merge across the tail of entries with the same command,
+    // so a build never moves ahead of an earlier clean (or the other way round).
+    int tail = m_pending.size();
+    while ( tail > 0 && m_pending[tail - 1].command == request->command() )
+        --tail;
+
+    Entry merged{ request->project(), request->path(), request->command(), { request } };
+
+    // Someone already waiting for the same thing (or more)?
+    for ( int i = tail; i < m_pending.size(); ++i )
+    {
+        Entry & entry = m_pending[i];
+        if ( covers( entry, merged ) )
+        {
+            qCDebug(KDEV_MSVC) << "Build request for" << merged.path << "merged with" << entry.path;
+            entry.requests << request;
+            return;
+        }
+    }
+
+    // Absorb whatever this request covers
+    int position = m_pending.size();
+
+    for ( int i = m_pending.size() - 1; i >= tail; --i )
+    {
+        if ( covers( merged, m_pending[i] ) )
+        {
+            qCDebug(KDEV_MSVC) << "Build request for" << m_pending[i].path << "absorbed by" << merged.path;
+            merged.requests << m_pending[i].requests;
+            m_pending.removeAt(i);
+            position = i;
+        }
+    }
+
+    m_pending.insert( position, merged );
+
+    if ( !m_runningJob )
+        startNext();
+}
+
+void MsvcBuildQueue::cancel( MsvcBuildRequestJob * request )
+{
+    for ( int i = 0; i < m_pending.size(); ++i )
+    {
+        if ( m_pending[i].requests.removeAll( request ) > 0 )
+        {
+            if ( m_pending[i].requests.isEmpty() )
+                m_pending.removeAt(i);
+            return;
+        }
+    }
+
+    if ( m_running.requests.removeAll( request ) > 0 &&
+         m_running.requests.isEmpty() &&
+         m_runningJob )
+    {
+        // Nobody is interested anymore
+        m_runningJob->kill( KJob::EmitResult );
+    }
+}
+
+void MsvcBuildQueue::startNext()
+{
+    while ( !m_pending.isEmpty() )
+    {
+        m_running = m_pending.takeFirst();
+        m_running.requests.removeAll( nullptr );
+
+        if ( m_running.requests.isEmpty() )
+            continue;
+
+        // Closed or reloaded while it waited
+        KDevelop::ProjectBuildFolderItem * item = MsvcSolutionItem::findBuildItem( m_running.project, m_running.path );
+        KJob * job = item ? m_factory( item, m_running.command ) : nullptr;
+        if ( !job )
+        {
+            for ( const auto & request : m_running.requests )
+            {
+                if ( request )
+                    request->buildFinished( nullptr );
+            }
+            continue;
+        }
+
+        job->setAutoDelete( true );
+        m_runningJob = job;
+        m_runningSince = MsvcTrace::timestamp();
+
+        // Not registered with the run controller: the request job is, and stopping it stops this one
+        connect( job, &KJob::result, this, &MsvcBuildQueue::onBuildFinished );
+        job->start();
+        return;
+    }
+}
+
+void MsvcBuildQueue::onBuildFinished( KJob * job )
+{
+    const QList< QPointer<MsvcBuildRequestJob> > requests = m_running.requests;
+
+    MsvcTrace::complete( m_running.command == DevEnvJob::CleanCommand ? "clean job" : "build job",
+                         job->objectName(), m_runningSince );
+    MsvcTrace::flush();
+
+    m_running = Entry{ nullptr, KDevelop::Path(), DevEnvJob::BuildCommand, {} };
+    m_runningJob.clear();
+
+    for ( const auto & request : requests )
+    {
+        if ( request )
+            request->buildFinished( job );
+    }
+
+    startNext();
+}
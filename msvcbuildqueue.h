@@ -0,0 +1,126 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCBUILDQUEUE_H
+#define MSVCBUILDQUEUE_H
+
+#include <KJob>
+
+#include <QList>
+#include <QObject>
+#include <QPointer>
+
+#include <functional>
+
+#include <kdevplatform/util/path.h>
+
+#include "devenvjob.h"
+
+namespace KDevelop
+{
+class IProject;
+}
+
+class MsvcBuildQueue;
+
+/**
+ * @brief Job handed out by the builder for every build request.
+ *
+ * It does not run anything by itself: it waits in the MsvcBuildQueue
+ * and finishes together with the build that ended up covering it.
+ */
+class MsvcBuildRequestJob : public KJob
+{
+    Q_OBJECT
+
+public:
+    MsvcBuildRequestJob( MsvcBuildQueue * queue,
+                         KDevelop::ProjectBuildFolderItem * item,
+                         DevEnvJob::CommandType command );
+
+    void start() override;
+
+    KDevelop::IProject * project() const { return m_project; }
+    KDevelop::Path path() const { return m_path; }
+    DevEnvJob::CommandType command() const { return m_command; }
+
+    /**
+     * @brief Called by the queue when the build covering this request is done.
+     */
+    void buildFinished( KJob * build );
+
+protected:
+    bool doKill() override;
+
+private:
+    QPointer<MsvcBuildQueue> m_queue;
+    QPointer<KDevelop::IProject> m_project;
+    KDevelop::Path m_path;
+    DevEnvJob::CommandType m_command;
+};
+
+/**
+ * @brief Serializes builds and merges overlapping requests.
+ *
+ * Only one build runs at a time. A request for an item whose build
+ * is already pending is absorbed by it, a request for a solution absorbs the
+ * pending requests of its projects. Merging never crosses a pending request
+ * with a different command, so builds and cleans run in the order they were
+ * requested. Requests arriving while a build runs are collected into a single
+ * follow-up build. Items are kept by path and looked up again when their build
+ * starts, the project may have been closed or reloaded meanwhile.
+ */
+class MsvcBuildQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Creates the job that actually builds (devenv, ninja, ...)
+    typedef std::function< KJob * ( KDevelop::ProjectBuildFolderItem *, DevEnvJob::CommandType ) > JobFactory;
+
+    explicit MsvcBuildQueue( JobFactory factory, QObject * parent = nullptr );
+    ~MsvcBuildQueue() override;
+
+    void enqueue( MsvcBuildRequestJob * request );
+    void cancel( MsvcBuildRequestJob * request );
+
+private:
+    struct Entry
+    {
+        QPointer<KDevelop::IProject> project;
+        KDevelop::Path path;
+        DevEnvJob::CommandType command;
+        QList< QPointer<MsvcBuildRequestJob> > requests;
+    };
+
+    static bool covers( const Entry & entry, const Entry & other );
+
+    void startNext();
+    void onBuildFinished( KJob * job );
+
+    JobFactory m_factory;
+    QList<Entry> m_pending;
+
+    Entry m_running;
+    QPointer<KJob> m_runningJob;
+    qint64 m_runningSince = -1;
+};
+
+#endif //MSVCBUILDQUEUE_H
@@ -0,0 +1,283 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "msvccompilecommands.h"
+#include "msvccompileflags.h"
+#include "msvcconfig.h"
+#include "msvcmodelitems.h"
+#include "debug.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <KConfig>
+#include <KConfigGroup>
+
+#include <interfaces/iproject.h>
+
+#include <memory>
+
+namespace
+{
+
+QByteArray jsonString( QString const & s )
+{
+    QByteArray result;
+    result.reserve( s.size() + 2 );
+    result += '"';
+
+    for ( const char c : s.toUtf8() )
+    {
+        switch ( c )
+        {
+        case '"':  result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        case '\r': result += "\\r"; break;
+        case '\t': result += "\\t"; break;
+        default:
+            if ( static_cast<unsigned char>(c) < 0x20 )
+                result += "\\u00" + QByteArray::number( static_cast<int>(c), 16 ).rightJustified(2, '0');
+            else
+                result += c;
+        }
+    }
+
+    result += '"';
+    return result;
+}
+
+
+QString modificationTime( KDevelop::Path const & path )
+{
+    return QFileInfo( path.toLocalFile() ).lastModified().toString( Qt::ISODate );
+}
+
+}
+
+MsvcCompileCommandsExporter::MsvcCompileCommandsExporter( MsvcSolutionItem * solution ) :
+    m_solutionPath(solution->path()),
+    m_fragmentDir(MsvcConfig::dataDirectory( solution->project() ), QStringLiteral("compile_commands"))
+{
+    for ( MsvcProjectItem * proj : solution->projects() )
+    {
+        const MsvcCompileFlags flags( proj );
+
+        Project project;
+        project.path = proj->path();
+        project.compiler = flags.toolchain().compiler.isValid() ?
+                           flags.toolchain().compiler.toLocalFile() :
+                           QStringLiteral("cl.exe");
+
+        // Files without settings of their own only differ between C and C++
+        QStringList cArguments;
+        QStringList cppArguments;
+        const KDevelop::Path::List sources = flags.sources();
+        project.arguments.reserve( sources.size() );
+        for ( const KDevelop::Path & source : sources )
+        {
+            if ( flags.hasOwnSettings( source ) )
+            {
+                project.arguments << flags.arguments( source );
+            }
+            else
+            {
+                QStringList & arguments = flags.isC( source ) ? cArguments : cppArguments;
+                if ( arguments.isEmpty() )
+                    arguments = flags.arguments( source );
+                project.arguments << arguments;
+            }
+
+            project.sources << source.toLocalFile();
+        }
+
+        m_projects << project;
+    }
+}
+
+void MsvcCompileCommandsExporter::exportIfEnabled( KDevelop::IProject * project )
+{
+    KConfigGroup cg( project->projectConfiguration(), MsvcConfig::CONFIG_GROUP );
+
+    if ( !cg.readEntry( MsvcConfig::EXPORT_COMPILE_COMMANDS, false ) )
+        return;
+
+    if ( MsvcSolutionItem * solItem = dynamic_cast<MsvcSolutionItem*>( project->projectItem() ) )
+    {
+        const auto exporter = std::make_shared<MsvcCompileCommandsExporter>( solItem );
+        QtConcurrent::run( [exporter]() { exporter->exportCommands(); } );
+    }
+}
+
+bool MsvcCompileCommandsExporter::exportCommands()
+{
+    KDevelop::Path output = m_solutionPath.parent();
+    output.addPath( QStringLiteral("compile_commands.json") );
+    return exportCommands( output );
+}
+
+bool MsvcCompileCommandsExporter::exportCommands( KDevelop::Path const & output )
+{
+    // Exports started one after the other share the fragment index
+    static QMutex mutex;
+    QMutexLocker lock( &mutex );
+
+    m_updatedProjects = 0;
+
+    if ( !QDir().mkpath( m_fragmentDir.toLocalFile() ) )
+    {
+        qCWarning(KDEV_MSVC) << "Cannot create" << m_fragmentDir;
+        return false;
+    }
+
+    KConfig index( KDevelop::Path( m_fragmentDir, QStringLiteral("index") ).toLocalFile(), KConfig::SimpleConfig );
+    QStringList oldFragments = index.groupList();
+    QStringList fragments;
+
+    for ( const Project & proj : m_projects )
+    {
+        const QString name = QString::fromLatin1(
+            QCryptographicHash::hash( proj.path.toLocalFile().toUtf8(), QCryptographicHash::Md5 ).toHex() );
+        const QString fileName = KDevelop::Path( m_fragmentDir, name + ".json" ).toLocalFile();
+        const QString print = fingerprint( proj );
+
+        KConfigGroup entry( &index, name );
+
+        if ( entry.readEntry( "Fingerprint", QString() ) != print || !QFile::exists( fileName ) )
+        {
+            if ( !writeFragment( proj, fileName ) )
+                return false;
+
+            entry.writeEntry( "Project", proj.path.toLocalFile() );
+            entry.writeEntry( "Fingerprint", print );
+            ++m_updatedProjects;
+        }
+
+        fragments << fileName;
+        oldFragments.removeAll( name );
+    }
+
+    // Projects that left the solution
+    for ( const QString & name : oldFragments )
+    {
+        QFile::remove( KDevelop::Path( m_fragmentDir, name + ".json" ).toLocalFile() );
+        index.deleteGroup( name );
+    }
+    index.sync();
+
+    QSaveFile out( output.toLocalFile() );
+    if ( !out.open( QIODevice::WriteOnly ) )
+    {
+        qCWarning(KDEV_MSVC) << "Cannot write" << output;
+        return false;
+    }
+
+    out.write( "[\n" );
+
+    bool first = true;
+    QByteArray buffer( 64 * 1024, Qt::Uninitialized );
+    for ( const QString & fileName : fragments )
+    {
+        QFile fragment( fileName );
+        if ( !fragment.open( QIODevice::ReadOnly ) || fragment.size() == 0 )
+            continue;
+
+        if ( !first )
+            out.write( ",\n" );
+        first = false;
+
+        qint64 n;
+        while ( ( n = fragment.read( buffer.data(), buffer.size() ) ) > 0 )
+            out.write( buffer.constData(), n );
+    }
+
+    out.write( "\n]\n" );
+
+    qCDebug(KDEV_MSVC) << "Exported" << output << "," << m_updatedProjects << "project(s) updated";
+    return out.commit();
+}
+
+QString MsvcCompileCommandsExporter::fingerprint( Project const & proj )
+{
+    KDevelop::Path filtersPath = proj.path;
+    filtersPath.setLastPathSegment( filtersPath.lastPathSegment() + ".filters" );
+
+    QCryptographicHash hash( QCryptographicHash::Md5 );
+    hash.addData( proj.path.toLocalFile().toUtf8() );
+    hash.addData( modificationTime( proj.path ).toUtf8() );
+    hash.addData( modificationTime( filtersPath ).toUtf8() );
+    hash.addData( proj.compiler.toUtf8() );
+
+    // Wildcards and ExcludedFromBuild change the files without touching the project file
+    for ( int i = 0; i < proj.sources.size(); ++i )
+    {
+        hash.addData( proj.sources[i].toUtf8() );
+        hash.addData( "\n", 1 );
+
+        // The shared lists are only hashed the first time in a row
+        if ( i > 0 && proj.arguments[i].isSharedWith( proj.arguments[i - 1] ) )
+            continue;
+        hash.addData( proj.arguments[i].join('\n').toUtf8() );
+        hash.addData( "\n", 1 );
+    }
+
+    return QString::fromLatin1( hash.result().toHex() );
+}
+
+bool MsvcCompileCommandsExporter::writeFragment( Project const & proj, QString const & fileName )
+{
+    QSaveFile out( fileName );
+    if ( !out.open( QIODevice::WriteOnly ) )
+    {
+        qCWarning(KDEV_MSVC) << "Cannot write" << fileName;
+        return false;
+    }
+
+    const QByteArray directory = jsonString( proj.path.parent().toLocalFile() );
+
+    for ( int i = 0; i < proj.sources.size(); ++i )
+    {
+        const QString & sourceFile = proj.sources[i];
+
+        QByteArray entry;
+        entry += i == 0 ? "  {\n" : ",\n  {\n";
+        entry += "    \"directory\": " + directory + ",\n";
+        entry += "    \"file\": " + jsonString( sourceFile ) + ",\n";
+        entry += "    \"arguments\": [" + jsonString( proj.compiler );
+
+        for ( const QString & arg : proj.arguments[i] )
+            entry += ", " + jsonString( arg );
+
+        entry += ", \"/c\", " + jsonString( sourceFile ) + "]\n  }";
+
+        out.write( entry );
+    }
+
+    return out.commit();
+}
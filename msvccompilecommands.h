@@ -0,0 +1,91 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCCOMPILECOMMANDS_H
+#define MSVCCOMPILECOMMANDS_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <kdevplatform/util/path.h>
+
+class MsvcSolutionItem;
+
+namespace KDevelop
+{
+class IProject;
+}
+
+/**
+ * @brief Writes a compile_commands.json for the current configuration of a solution.
+ *
+ * Every project gets its own fragment in the plugin data directory, it is only
+ * regenerated when the project (or the flags it is compiled with) changed.
+ * The final file is then streamed together from the fragments, so nothing
+ * has to hold the whole document in memory.
+ *
+ * The constructor takes a snapshot of the model and must run on the GUI
+ * thread, exporting only touches that snapshot and the disk.
+ */
+class MsvcCompileCommandsExporter
+{
+public:
+    explicit MsvcCompileCommandsExporter( MsvcSolutionItem * solution );
+
+    /**
+     * @brief Export to compile_commands.json next to the solution file.
+     */
+    bool exportCommands();
+    bool exportCommands( KDevelop::Path const & output );
+
+    /**
+     * @brief Number of projects whose fragment was regenerated by the last export.
+     */
+    int updatedProjects() const { return m_updatedProjects; }
+
+    /**
+     * @brief Export all the solutions of @p project in the background, if it is configured to.
+     */
+    static void exportIfEnabled( KDevelop::IProject * project );
+
+private:
+    /**
+     * @brief What a project contributes, collected on the GUI thread.
+     */
+    struct Project
+    {
+        KDevelop::Path path;
+        QString compiler;
+        QStringList sources;
+        QVector<QStringList> arguments;    // of each source, files without settings of their own share them
+    };
+
+    static QString fingerprint( Project const & proj );
+    static bool writeFragment( Project const & proj, QString const & fileName );
+
+    KDevelop::Path m_solutionPath;
+    KDevelop::Path m_fragmentDir;
+    QList<Project> m_projects;
+    int m_updatedProjects = 0;
+};
+
+#endif //MSVCCOMPILECOMMANDS_H
@@ -0,0 +1,364 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "msvccompileflags.h"
+#include "msvcfileregistry.h"
+#include "msvcmodelitems.h"
+#include "msvcprojectdata.h"
+#include "msvctrace.h"
+#include "debug.h"
+
+#include <QFileInfo>
+#include <QSet>
+
+#include <interfaces/iproject.h>
+
+MsvcCompileFlags::MsvcCompileFlags( MsvcProjectItem const * project ) :
+    m_project(project),
+    m_config(project->getCurrentConfig()),
+    m_toolchain(MsvcToolchain::self().profile( project->project() ))
+{
+}
+
+KDevelop::Path::List MsvcCompileFlags::includeDirectories() const
+{
+    MSVC_TRACE_SPAN( "include resolution" );
+
+    KDevelop::Path::List result;
+
+    if ( m_toolchain.msvcInclude.isValid() )
+    {
+        result.push_back( m_toolchain.msvcInclude );
+    }
+    
+    if ( m_toolchain.winSdkInclude.isValid() )
+    {
+        result.push_back( m_toolchain.winSdkInclude );
+    }
+
+    MsvcVariableReplacer replacer; 
+    
+    for (QString const & s : replacer.replace(m_config.additionalIncludeDirectories, m_project) )
+    {
+        // Relative paths are relative to the project path.
+        KDevelop::Path path = m_project->resolvePath( s );
+
+        if ( path.isValid() )
+            result << path;
+        else
+        {
+            qCWarning(KDEV_MSVC) << "Invalid include path:" << s;
+        }
+    }
+
+    return result;
+}
+
+QHash<QString,QString> MsvcCompileFlags::defines() const
+{
+    //TODO compiler-injected defines
+    QHash<QString,QString> result = m_config.preprocessorDefines;
+
+    // Visual Studio adds these on its own
+    if ( m_config.characterSet == MsvcProjectConfig::CharSetUnicode )
+    {
+        result.insert( "UNICODE", QString() );
+        result.insert( "_UNICODE", QString() );
+    }
+    else if ( m_config.characterSet == MsvcProjectConfig::CharSetMBCS )
+    {
+        result.insert( "_MBCS", QString() );
+    }
+
+    for ( const QString & name : m_config.undefines )
+        result.remove( name.trimmed() );
+
+    result.remove( QString() );
+    return result;
+}
+
+KDevelop::Path::List MsvcCompileFlags::forcedIncludes() const
+{
+    if ( m_forcedIncludesResolved || m_config.forcedIncludeFiles.isEmpty() )
+        return m_forcedIncludes;
+
+    const KDevelop::Path::List directories = includeDirectories();
+
+    MsvcVariableReplacer replacer;
+    for ( const QString & header : replacer.replace( m_config.forcedIncludeFiles, m_project ) )
+    {
+        const KDevelop::Path path = findHeader( header, directories );
+        if ( !path.isValid() )
+            qCDebug(KDEV_MSVC) << "Forced include not found:" << header;
+        else if ( !m_forcedIncludes.contains( path ) )
+            m_forcedIncludes << path;
+    }
+
+    m_forcedIncludesResolved = true;
+    return m_forcedIncludes;
+}
+
+QStringList MsvcCompileFlags::parserArguments( KDevelop::Path const & source ) const
+{
+    if ( hasOwnSettings( source ) )
+        return forSource( source ).parserArguments( source );
+
+    QStringList result;
+
+    for ( const KDevelop::Path & header : forcedIncludes() )
+        result << "-include" << header.toLocalFile();
+
+    for ( const QString & name : m_config.undefines )
+        result << "-U" + name.trimmed();
+
+    const bool c = isC( source );
+    if ( m_config.compileAs != MsvcProjectConfig::CompileAsDefault )
+        result << "-x" << ( c ? QStringLiteral("c") : QStringLiteral("c++") );
+
+    if ( c )
+    {
+        if ( !m_config.cLanguageStandard.isEmpty() )
+            result << "-std=" + m_config.cLanguageStandard;
+    }
+    else if ( !m_config.languageStandard.isEmpty() )
+    {
+        // c++latest is the draft after the last supported standard, and
+        // clang before 10 only knows C++20 by its draft name
+        const bool draft = m_config.languageStandard == "c++latest" || m_config.languageStandard == "c++20";
+        result << "-std=" + ( draft ? QStringLiteral("c++2a") : m_config.languageStandard );
+    }
+
+    static const QHash<QString, QString> conformance =
+    {
+        { "/Zc:wchar_t-", "-fno-wchar" },
+        { "/Zc:twoPhase-", "-fdelayed-template-parsing" },
+        { "/permissive-", "-fno-delayed-template-parsing" },
+        { "/Zc:sizedDealloc-", "-fno-sized-deallocation" },
+        { "/Zc:alignedNew-", "-fno-aligned-allocation" },
+        { "/Zc:threadSafeInit-", "-fno-threadsafe-statics" },
+        { "/Zc:char8_t", "-fchar8_t" },
+        { "/Zc:char8_t-", "-fno-char8_t" },
+        { "/Zc:trigraphs", "-trigraphs" }
+    };
+    for ( const QString & flag : m_config.conformanceFlags )
+    {
+        const QString argument = conformance.value( flag );
+        if ( !argument.isEmpty() )
+            result << argument;
+    }
+
+    return result;
+}
+
+QStringList MsvcCompileFlags::arguments( KDevelop::Path const & source ) const
+{
+    if ( hasOwnSettings( source ) )
+        return forSource( source ).arguments( source );
+
+    QStringList result;
+    result << "/nologo";
+
+    for ( const KDevelop::Path & p : includeDirectories() )
+    {
+        result << "/I" + p.toLocalFile();
+    }
+
+    const QHash<QString,QString> defs = defines();
+    for ( auto it = defs.constBegin(); it != defs.constEnd(); ++it )
+    {
+        result << ( it.value().isEmpty() ? "/D" + it.key() : "/D" + it.key() + "=" + it.value() );
+    }
+
+    static const char * optimization[] = { "/Od", "/O1", "/O2", "/Ox" };
+    if ( m_config.optimizationLevel >= 0 && m_config.optimizationLevel < 4 )
+        result << optimization[ m_config.optimizationLevel ];
+
+    if ( m_config.intrinsicInstructions )
+        result << "/Oi";
+
+    static const char * runtime[] = { "/MT", "/MTd", "/MD", "/MDd" };
+    result << runtime[ m_config.rtLibrary ];
+
+    if ( m_config.warningLevel >= 0 && m_config.warningLevel <= 4 )
+        result << "/W" + QString::number( m_config.warningLevel );
+
+    for ( const KDevelop::Path & header : forcedIncludes() )
+        result << "/FI" + header.toLocalFile();
+
+    for ( const QString & name : m_config.undefines )
+        result << "/U" + name.trimmed();
+
+    if ( m_config.compileAs == MsvcProjectConfig::CompileAsC )
+        result << "/TC";
+    else if ( m_config.compileAs == MsvcProjectConfig::CompileAsCpp )
+        result << "/TP";
+
+    const QString & standard = isC( source ) ? m_config.cLanguageStandard : m_config.languageStandard;
+    if ( !standard.isEmpty() )
+        result << "/std:" + standard;
+
+    result << m_config.conformanceFlags;
+
+    return result;
+}
+
+KDevelop::Path MsvcCompileFlags::pchHeader() const
+{
+    if ( m_config.pchUsage == MsvcProjectConfig::PchNotUsing || m_config.pchThrough.isEmpty() )
+        return KDevelop::Path();
+
+    const KDevelop::Path result = findHeader( m_config.pchThrough, includeDirectories() );
+    if ( !result.isValid() )
+        qCDebug(KDEV_MSVC) << "Precompiled header not found:" << m_config.pchThrough;
+    return result;
+}
+
+KDevelop::Path MsvcCompileFlags::findHeader( QString const & header, KDevelop::Path::List const & includeDirectories ) const
+{
+    // The sources include it relative to themselves or to an include directory
+    KDevelop::Path::List candidates;
+    candidates << m_project->resolvePath( header );
+    for ( const KDevelop::Path & dir : includeDirectories )
+        candidates << KDevelop::Path( dir, QString( header ).replace('\\', '/') );
+
+    for ( const KDevelop::Path & candidate : candidates )
+    {
+        if ( candidate.isValid() && QFileInfo( candidate.toLocalFile() ).isFile() )
+            return candidate;
+    }
+    return KDevelop::Path();
+}
+
+KDevelop::Path MsvcCompileFlags::pchFile() const
+{
+    if ( m_config.pchUsage == MsvcProjectConfig::PchNotUsing || m_config.pchOutputFile.isEmpty() )
+        return KDevelop::Path();
+
+    MsvcVariableReplacer replacer;
+    return m_project->resolvePath( replacer.replace( m_config.pchOutputFile, m_project ) );
+}
+
+bool MsvcCompileFlags::isC( KDevelop::Path const & source ) const
+{
+    if ( hasOwnSettings( source ) )
+        return forSource( source ).isC( source );
+    return isC( source, m_config.compileAs );
+}
+
+bool MsvcCompileFlags::isC( KDevelop::Path const & source, MsvcProjectConfig::CompileAs compileAs )
+{
+    if ( compileAs != MsvcProjectConfig::CompileAsDefault )
+        return compileAs == MsvcProjectConfig::CompileAsC;
+    return source.lastPathSegment().endsWith( QLatin1String(".c"), Qt::CaseInsensitive );
+}
+
+bool MsvcCompileFlags::isCompilable( KDevelop::Path const & path )
+{
+    static const QStringList extensions = { "c", "cc", "cpp", "cxx", "c++" };
+
+    const QString ext = path.lastPathSegment().section('.', -1).toLower();
+    return extensions.contains( ext );
+}
+
+bool MsvcCompileFlags::hasOwnSettings( KDevelop::Path const & source ) const
+{
+    if ( !m_sourceSettingsResolved )
+    {
+        m_sourceSettingsResolved = true;
+
+        const std::shared_ptr<const MsvcProjectData> data = m_project->projectData();
+        if ( !data )
+            return false;
+
+        const auto settings = data->fileSettings( MsvcProjectItem::fullName( m_config ) );
+        for ( auto it = settings.constBegin(); it != settings.constEnd(); ++it )
+        {
+            QVector< QPair<QString, QString> > compilerSettings;
+            for ( const MsvcProjectData::FileSetting & setting : it.value() )
+            {
+                const QString name = data->string( setting.name );
+                if ( name != QLatin1String("ExcludedFromBuild") )
+                    compilerSettings.append( { name, data->string( setting.value ) } );
+            }
+            if ( !compilerSettings.isEmpty() )
+                m_sourceSettings.insert( data->filePath( it.key() ), compilerSettings );
+        }
+    }
+    return m_sourceSettings.contains( source );
+}
+
+MsvcCompileFlags MsvcCompileFlags::forSource( KDevelop::Path const & source ) const
+{
+    if ( !hasOwnSettings( source ) )
+        return *this;
+
+    MsvcCompileFlags result( *this );
+    for ( const auto & setting : m_sourceSettings.value( source ) )
+        applyVcxCompilerSetting( result.m_config, setting.first, setting.second );
+
+    // The file has no settings of its own on top of these
+    result.m_sourceSettings.clear();
+    result.m_forcedIncludesResolved = false;
+    result.m_forcedIncludes.clear();
+    return result;
+}
+
+KDevelop::Path::List MsvcCompileFlags::sources() const
+{
+    KDevelop::Path::List result;
+    const std::shared_ptr<const MsvcProjectData> data = m_project->projectData();
+    if ( !data )
+        return result;
+
+    const auto settings = data->fileSettings( MsvcProjectItem::fullName( m_config ) );
+    QSet<KDevelop::Path> seen;
+    for ( int i = 0; i < data->files().size(); ++i )
+    {
+        if ( data->files()[i].type != MsvcProjectData::CompileItem || data->isExcludedFromBuild( settings.value( i ) ) )
+            continue;
+
+        const KDevelop::Path path = data->filePath( i );
+        if ( !seen.contains( path ) )
+        {
+            seen.insert( path );
+            result << path;
+        }
+    }
+    return result;
+}
+
+MsvcProjectItem * MsvcCompileFlags::owningProject( KDevelop::ProjectBaseItem * item )
+{
+    // Files are looked up in the index of the solution, a shared file needs the walk
+    if ( item && item->file() && item->project() )
+    {
+        MsvcSolutionItem * solItem = dynamic_cast<MsvcSolutionItem*>( item->project()->projectItem() );
+        if ( MsvcProjectItem * projItem = solItem ? solItem->fileRegistry()->owningProject( item->path() ) : nullptr )
+            return projItem;
+    }
+
+    for ( KDevelop::ProjectBaseItem * p = item; p; p = p->parent() )
+    {
+        if ( MsvcProjectItem * projItem = dynamic_cast<MsvcProjectItem*>(p) )
+            return projItem;
+    }
+    return nullptr;
+}
@@ -0,0 +1,150 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCCOMPILEFLAGS_H
+#define MSVCCOMPILEFLAGS_H
+
+#include <QHash>
+#include <QStringList>
+
+#include <kdevplatform/util/path.h>
+
+#include "msvcprojectconfig.h"
+#include "msvctoolchain.h"
+
+namespace KDevelop
+{
+class ProjectBaseItem;
+}
+
+class MsvcProjectItem;
+
+/**
+ * @brief Resolves the compiler settings of a project for its current configuration.
+ *
+ * This is what the parser, the exporters and the builders that run the
+ * compiler themselves share, so they all see the same translation unit.
+ */
+class MsvcCompileFlags
+{
+public:
+    explicit MsvcCompileFlags( MsvcProjectItem const * project );
+
+    /**
+     * @brief Include directories, the toolchain ones first.
+     */
+    KDevelop::Path::List includeDirectories() const;
+
+    /**
+     * @brief The defines, without those the project undefines.
+     */
+    QHash<QString,QString> defines() const;
+
+    /**
+     * @brief Headers included before the first line of every source, searched like an include.
+     */
+    KDevelop::Path::List forcedIncludes() const;
+
+    /**
+     * @brief cl.exe compatible arguments to compile @p source, without the compiler
+     * executable, the source itself and the output options.
+     */
+    QStringList arguments( KDevelop::Path const & source ) const;
+
+    /**
+     * @brief The arguments that make the clang based parser see the translation
+     * unit cl compiles: forced includes, undefines, language standard and the
+     * conformance switches clang knows, in gcc syntax. Includes and defines are
+     * reported on their own.
+     */
+    QStringList parserArguments( KDevelop::Path const & source ) const;
+
+    /**
+     * @brief The header the precompiled header is built from, searched like
+     * an include, or an invalid path if the project does not use one.
+     */
+    KDevelop::Path pchHeader() const;
+
+    /**
+     * @brief The .pch file, or an invalid path if the project does not use one.
+     */
+    KDevelop::Path pchFile() const;
+
+    /**
+     * @brief The ClCompile items of the project this configuration builds.
+     */
+    KDevelop::Path::List sources() const;
+
+    /**
+     * @brief Returns true if @p source has compiler settings of its own in this configuration.
+     */
+    bool hasOwnSettings( KDevelop::Path const & source ) const;
+
+    /**
+     * @brief The flags @p source is compiled with: these with the settings of the file
+     * applied, like its own defines or PCH usage. arguments(), parserArguments() and
+     * isC() of a source already go through it.
+     */
+    MsvcCompileFlags forSource( KDevelop::Path const & source ) const;
+
+    MsvcProjectConfig const & config() const { return m_config; }
+    MsvcToolchain::Profile const & toolchain() const { return m_toolchain; }
+
+    /**
+     * @brief Returns true for the files cl.exe would compile (.c, .cpp and friends).
+     */
+    static bool isCompilable( KDevelop::Path const & path );
+
+    /**
+     * @brief Returns true if cl.exe compiles @p source as C in this configuration.
+     */
+    bool isC( KDevelop::Path const & source ) const;
+
+    /**
+     * @brief Returns true if cl.exe compiles @p source as C, by extension unless /TC or /TP says otherwise.
+     */
+    static bool isC( KDevelop::Path const & source, MsvcProjectConfig::CompileAs compileAs );
+
+
+    /**
+     * @brief The project @p item belongs to, or null.
+     */
+    static MsvcProjectItem * owningProject( KDevelop::ProjectBaseItem * item );
+
+private:
+    /**
+     * @brief @p header found relative to the project or to one of @p includeDirectories, invalid if not found.
+     */
+    KDevelop::Path findHeader( QString const & header, KDevelop::Path::List const & includeDirectories ) const;
+
+    MsvcProjectItem const * m_project;
+    MsvcProjectConfig m_config;
+    MsvcToolchain::Profile m_toolchain;
+
+    // Looked up once, arguments() is asked for every source
+    mutable bool m_forcedIncludesResolved = false;
+    mutable KDevelop::Path::List m_forcedIncludes;
+
+    // The ClCompile settings of the files that have some
+    mutable bool m_sourceSettingsResolved = false;
+    mutable QHash< KDevelop::Path, QVector< QPair<QString, QString> > > m_sourceSettings;
+};
+
+#endif //MSVCCOMPILEFLAGS_H
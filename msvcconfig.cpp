@@ -20,6 +20,7 @@
 
 
 #include "msvcconfig.h"
+#include "msvctoolchain.h"
 
 #include <QFileInfo>
 #include <QSettings>
@@ -37,6 +38,22 @@ const char* MsvcConfig::MSVC_INCLUDE = "MsvcIncludePath";
 const char* MsvcConfig::WINSDK_INCLUDE = "WinSdkIncludePath";
 const char* MsvcConfig::ACTIVE_CONFIGURATION = "Config";
 const char* MsvcConfig::ACTIVE_ARCHITECTURE  = "Arch";
+const char* MsvcConfig::EXPORT_COMPILE_COMMANDS = "ExportCompileCommands";
+const char* MsvcConfig::BUILD_BACKEND = "Backend";
+const char* MsvcConfig::NINJA_BINARY = "NinjaExecutable";
+const char* MsvcConfig::CLANG_CL_BINARY = "ClangClExecutable";
+const char* MsvcConfig::LLD_LINK_BINARY = "LldLinkExecutable";
+const char* MsvcConfig::LLVM_LIB_BINARY = "LlvmLibExecutable";
+const char* MsvcConfig::OBJECT_CACHE = "ObjectCache";
+const char* MsvcConfig::OBJECT_CACHE_SIZE = "ObjectCacheSizeMB";
+const char* MsvcConfig::UNITY_BUILD = "UnityBuild";
+const char* MsvcConfig::UNITY_BATCH_SIZE = "UnityBatchSize";
+const char* MsvcConfig::STARTUP_PROJECT = "StartupProject";
+const char* MsvcConfig::RECENT_PROJECTS = "RecentProjects";
+
+const char* MsvcConfig::BACKEND_DEVENV = "devenv";
+const char* MsvcConfig::BACKEND_NINJA = "ninja";
+const char* MsvcConfig::BACKEND_CLANGCL = "clangcl";
 
 bool MsvcConfig::isConfigured(const KDevelop::IProject* project)
 {
@@ -55,11 +72,12 @@ void MsvcConfig::guessCompilerIfNotConfigured(const KDevelop::IProject * project
         return;
     }
 
-    auto compilers = findMSVC();
+    auto compilers = MsvcToolchain::self().installedCompilers();
 
     if ( !compilers.empty() )
     {
         cg.writeEntry( DEVENV_BINARY, compilers.front().path.toLocalFile() );
+        MsvcToolchain::self().invalidate( project );
     }
 }
 
@@ -114,6 +132,11 @@ KDevelop::Path MsvcConfig::findWinSdk()
     return KDevelop::Path();
 }
 
+KDevelop::Path MsvcConfig::dataDirectory(const KDevelop::IProject* project)
+{
+    return KDevelop::Path( project->path(), QStringLiteral(".kdev4/msvc") );
+}
+
 QList< MsvcConfig::CompilerPath > MsvcConfig::findCompilerPath( const KDevelop::Path & common7path, int version )
 {
     static const QPair<QString, QString> devenvCandidateSubPaths[] =
@@ -138,3 +161,38 @@ QList< MsvcConfig::CompilerPath > MsvcConfig::findCompilerPath( const KDevelop::
     return result;
  
 }
+
+QString MsvcConfig::startupProject(const KDevelop::IProject* project)
+{
+    KConfigGroup cg(project->projectConfiguration(), CONFIG_GROUP);
+    return cg.readEntry(STARTUP_PROJECT, QString());
+}
+
+void MsvcConfig::setStartupProject(const KDevelop::IProject* project, const QString& name)
+{
+    KConfigGroup cg(project->projectConfiguration(), CONFIG_GROUP);
+    cg.writeEntry(STARTUP_PROJECT, name);
+}
+
+QStringList MsvcConfig::recentProjects(const KDevelop::IProject* project)
+{
+    KConfigGroup cg(project->projectConfiguration(), CONFIG_GROUP);
+    return cg.readEntry(RECENT_PROJECTS, QStringList());
+}
+
+void MsvcConfig::addRecentProject(const KDevelop::IProject* project, const QString& name)
+{
+    static const int maxRecentProjects = 10;
+
+    KConfigGroup cg(project->projectConfiguration(), CONFIG_GROUP);
+    QStringList recent = cg.readEntry(RECENT_PROJECTS, QStringList());
+    if (!recent.isEmpty() && recent.front() == name)
+        return;
+
+    recent.removeAll(name);
+    recent.prepend(name);
+    while (recent.size() > maxRecentProjects)
+        recent.removeLast();
+
+    cg.writeEntry(RECENT_PROJECTS, recent);
+}
@@ -22,6 +22,7 @@
 #define MSVCCONFIG_H
 
 #include <QList>
+#include <QStringList>
 
 #include <kdevplatform/util/path.h>
 
@@ -38,7 +39,24 @@ public:
                       *MSVC_INCLUDE,
                       *WINSDK_INCLUDE,
                       *ACTIVE_CONFIGURATION,
-                      *ACTIVE_ARCHITECTURE;
+                      *ACTIVE_ARCHITECTURE,
+                      *EXPORT_COMPILE_COMMANDS,
+                      *BUILD_BACKEND,
+                      *NINJA_BINARY,
+                      *CLANG_CL_BINARY,
+                      *LLD_LINK_BINARY,
+                      *LLVM_LIB_BINARY,
+                      *OBJECT_CACHE,
+                      *OBJECT_CACHE_SIZE,
+                      *UNITY_BUILD,
+                      *UNITY_BATCH_SIZE,
+                      *STARTUP_PROJECT,
+                      *RECENT_PROJECTS;
+
+    // Values of BUILD_BACKEND
+    static const char *BACKEND_DEVENV,
+                      *BACKEND_NINJA,
+                      *BACKEND_CLANGCL;
 
     struct CompilerPath
     {
@@ -60,6 +78,23 @@ public:
     static QList< CompilerPath > findMSVC();
     
     static KDevelop::Path findWinSdk();
+
+    /**
+     * Directory where the plugin keeps its own files for the given project.
+     */
+    static KDevelop::Path dataDirectory(const KDevelop::IProject* project);
+
+    /**
+     * The project of the solution that is loaded first, empty if none was chosen.
+     */
+    static QString startupProject(const KDevelop::IProject* project);
+    static void setStartupProject(const KDevelop::IProject* project, const QString& name);
+
+    /**
+     * Projects of the solution recently worked in, most recent first.
+     */
+    static QStringList recentProjects(const KDevelop::IProject* project);
+    static void addRecentProject(const KDevelop::IProject* project, const QString& name);
     
 private:
     static QList< CompilerPath > findCompilerPath( const KDevelop::Path & common7path, int version );
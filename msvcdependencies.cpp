@@ -0,0 +1,323 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "msvcdependencies.h"
+#include "msvcconfig.h"
+#include "debug.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStringList>
+#include <QVector>
+
+#include <algorithm>
+
+#include <interfaces/iproject.h>
+
+namespace
+{
+// Bump when the on disk format changes
+const quint32 DATABASE_VERSION = 3;
+
+// What clang-cl and cl.exe print for every include with /showIncludes
+const QString INCLUDE_NOTE = QStringLiteral("Note: including file:");
+}
+
+MsvcDependencyDatabase & MsvcDependencyDatabase::self()
+{
+    static MsvcDependencyDatabase instance;
+    return instance;
+}
+
+bool MsvcDependencyDatabase::contains( const KDevelop::IProject * project, KDevelop::Path const & source )
+{
+    QMutexLocker lock( &m_mutex );
+    return data( project ).dependencies.contains( source );
+}
+
+KDevelop::Path::List MsvcDependencyDatabase::dependencies( const KDevelop::IProject * project, KDevelop::Path const & source )
+{
+    QMutexLocker lock( &m_mutex );
+    return data( project ).dependencies.value( source );
+}
+
+QByteArray MsvcDependencyDatabase::command( const KDevelop::IProject * project, KDevelop::Path const & source )
+{
+    QMutexLocker lock( &m_mutex );
+    return data( project ).commands.value( source );
+}
+
+void MsvcDependencyDatabase::setDependencies( const KDevelop::IProject * project, KDevelop::Path const & source,
+                                              KDevelop::Path::List const & headers, QByteArray const & command,
+                                              KDevelop::Path::List const & batch )
+{
+    QMutexLocker lock( &m_mutex );
+
+    Data & d = data( project );
+    auto it = d.dependencies.find( source );
+    if ( it != d.dependencies.end() && *it == headers && d.commands.value( source ) == command &&
+         d.batches.value( source ) == batch )
+        return;
+
+    unindex( d, source );
+    d.dependencies.insert( source, headers );
+    d.commands.insert( source, command );
+    if ( batch.isEmpty() )
+        d.batches.remove( source );
+    else
+        d.batches.insert( source, batch );
+    index( d, source );
+    d.dirty = true;
+}
+
+void MsvcDependencyDatabase::remove( const KDevelop::IProject * project, KDevelop::Path const & source )
+{
+    QMutexLocker lock( &m_mutex );
+
+    Data & d = data( project );
+    unindex( d, source );
+    d.commands.remove( source );
+    d.batches.remove( source );
+    if ( d.dependencies.remove( source ) )
+        d.dirty = true;
+}
+
+KDevelop::Path::List MsvcDependencyDatabase::affectedBy( const KDevelop::IProject * project, KDevelop::Path const & header )
+{
+    QMutexLocker lock( &m_mutex );
+
+    const Data & d = data( project );
+
+    // A unity source stands for the files of its batch
+    QSet<KDevelop::Path> affected;
+    for ( const KDevelop::Path & source : d.includers.value( includerKey( header ) ) )
+    {
+        auto batch = d.batches.constFind( source );
+        if ( batch == d.batches.constEnd() )
+        {
+            affected.insert( source );
+            continue;
+        }
+        for ( const KDevelop::Path & file : *batch )
+            affected.insert( file );
+    }
+
+    KDevelop::Path::List result = affected.toList().toVector();
+    std::sort( result.begin(), result.end() );
+    return result;
+}
+
+QString MsvcDependencyDatabase::includerKey( KDevelop::Path const & path )
+{
+    // /showIncludes reports headers spelled like the #include, Windows ignores the case
+    return path.pathOrUrl().toCaseFolded();
+}
+
+void MsvcDependencyDatabase::index( Data & data, KDevelop::Path const & source )
+{
+    data.includers[ includerKey( source ) ].insert( source );
+    for ( const KDevelop::Path & header : data.dependencies.value( source ) )
+        data.includers[ includerKey( header ) ].insert( source );
+}
+
+void MsvcDependencyDatabase::unindex( Data & data, KDevelop::Path const & source )
+{
+    auto drop = [&data, &source]( KDevelop::Path const & path )
+    {
+        auto it = data.includers.find( includerKey( path ) );
+        if ( it == data.includers.end() )
+            return;
+        it->remove( source );
+        if ( it->isEmpty() )
+            data.includers.erase( it );
+    };
+
+    drop( source );
+    for ( const KDevelop::Path & header : data.dependencies.value( source ) )
+        drop( header );
+}
+
+void MsvcDependencyDatabase::sync( const KDevelop::IProject * project )
+{
+    QMutexLocker lock( &m_mutex );
+
+    Data & d = data( project );
+    if ( !d.dirty )
+        return;
+
+    QDir().mkpath( d.file.parent().toLocalFile() );
+
+    QSaveFile file( d.file.toLocalFile() );
+    if ( !file.open( QIODevice::WriteOnly ) )
+    {
+        qCWarning(KDEV_MSVC) << "Cannot write" << d.file;
+        return;
+    }
+
+    // Headers are shared by most translation units, store each path once
+    QStringList paths;
+    QHash<KDevelop::Path, quint32> indices;
+    auto indexOf = [&paths, &indices]( KDevelop::Path const & path )
+    {
+        auto it = indices.find( path );
+        if ( it == indices.end() )
+        {
+            it = indices.insert( path, paths.size() );
+            paths << path.pathOrUrl();
+        }
+        return *it;
+    };
+
+    QVector<quint32> table;
+    QVector<QByteArray> commands;
+    commands.reserve( d.dependencies.size() );
+    for ( auto it = d.dependencies.constBegin(); it != d.dependencies.constEnd(); ++it )
+    {
+        table << indexOf( it.key() ) << quint32( it->size() );
+        for ( const KDevelop::Path & header : *it )
+            table << indexOf( header );
+
+        const KDevelop::Path::List batch = d.batches.value( it.key() );
+        table << quint32( batch.size() );
+        for ( const KDevelop::Path & source : batch )
+            table << indexOf( source );
+
+        commands << d.commands.value( it.key() );
+    }
+
+    QDataStream out( &file );
+    out << DATABASE_VERSION << paths << quint32( d.dependencies.size() ) << table << commands;
+
+    if ( file.commit() )
+        d.dirty = false;
+}
+
+QString MsvcDependencyDatabase::takeIncludes( QString const & output, KDevelop::Path::List & headers )
+{
+    QStringList lines;
+    for ( const QString & line : output.split( '\n' ) )
+    {
+        if ( line.startsWith( INCLUDE_NOTE ) )
+        {
+            // The path is indented by the include depth
+            const QString header = line.mid( INCLUDE_NOTE.size() ).trimmed();
+            if ( !header.isEmpty() )
+            {
+                const KDevelop::Path path( QDir::fromNativeSeparators( header ) );
+                if ( !headers.contains( path ) )
+                    headers << path;
+            }
+        }
+        else
+        {
+            lines << line;
+        }
+    }
+    return lines.join('\n');
+}
+
+MsvcDependencyDatabase::Data & MsvcDependencyDatabase::data( const KDevelop::IProject * project )
+{
+    const KDevelop::Path key = project->path();
+
+    auto it = m_projects.find( key );
+    if ( it == m_projects.end() )
+    {
+        it = m_projects.insert( key, Data() );
+        it->file = KDevelop::Path( MsvcConfig::dataDirectory( project ), QStringLiteral("dependencies") );
+        load( *it );
+    }
+    return *it;
+}
+
+void MsvcDependencyDatabase::load( Data & data )
+{
+    QFile file( data.file.toLocalFile() );
+    if ( !file.open( QIODevice::ReadOnly ) )
+        return;
+
+    QDataStream in( &file );
+
+    quint32 version = 0;
+    in >> version;
+    if ( version != DATABASE_VERSION )
+        return;
+
+    QStringList strings;
+    quint32 count = 0;
+    QVector<quint32> table;
+    QVector<QByteArray> commands;
+    in >> strings >> count >> table >> commands;
+
+    if ( in.status() != QDataStream::Ok )
+        return;
+
+    QVector<KDevelop::Path> paths;
+    paths.reserve( strings.size() );
+    for ( const QString & s : strings )
+        paths << KDevelop::Path( s );
+
+    int pos = 0;
+    auto next = [&table, &pos]() { return pos < table.size() ? table.at( pos++ ) : quint32(-1); };
+
+    // A size followed by as many indices of paths
+    auto readList = [&]( KDevelop::Path::List & list )
+    {
+        const quint32 size = next();
+        if ( size > quint32( table.size() - pos ) )
+            return false;
+
+        list.reserve( size );
+        for ( quint32 n = 0; n < size; ++n )
+        {
+            const quint32 index = next();
+            if ( index < quint32( paths.size() ) )
+                list << paths.at( index );
+        }
+        return true;
+    };
+
+    data.dependencies.reserve( count );
+    for ( quint32 i = 0; i < count; ++i )
+    {
+        const quint32 source = next();
+        KDevelop::Path::List headers;
+        KDevelop::Path::List batch;
+        if ( source >= quint32( paths.size() ) || !readList( headers ) || !readList( batch ) )
+        {
+            qCWarning(KDEV_MSVC) << "Corrupted dependency database" << data.file;
+            data.dependencies.clear();
+            data.commands.clear();
+            data.batches.clear();
+            data.includers.clear();
+            return;
+        }
+
+        const KDevelop::Path & path = paths.at( source );
+        data.dependencies.insert( path, headers );
+        data.commands.insert( path, commands.value( int( i ) ) );
+        if ( !batch.isEmpty() )
+            data.batches.insert( path, batch );
+        index( data, path );
+    }
+}
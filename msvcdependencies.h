@@ -0,0 +1,117 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCDEPENDENCIES_H
+#define MSVCDEPENDENCIES_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+
+#include <kdevplatform/util/path.h>
+
+namespace KDevelop
+{
+class IProject;
+}
+
+/**
+ * @brief Headers each translation unit includes, as reported by the compiler.
+ *
+ * The lists come from the /showIncludes output of plugin driven compiles and
+ * are complete (nested includes are reported too), so a translation unit has
+ * to be recompiled when any of its headers is newer than its object. Each
+ * entry also keeps a hash of the command line that compiled the unit, which
+ * has to be compiled again when its defines or include directories change.
+ * One database is kept per project, under MsvcConfig::dataDirectory().
+ */
+class MsvcDependencyDatabase
+{
+public:
+    static MsvcDependencyDatabase & self();
+
+    /**
+     * @brief Returns true if the headers of @p source are known.
+     */
+    bool contains( const KDevelop::IProject * project, KDevelop::Path const & source );
+
+    KDevelop::Path::List dependencies( const KDevelop::IProject * project, KDevelop::Path const & source );
+
+    /**
+     * @brief The hash of the command line @p source was compiled with, empty if not known.
+     */
+    QByteArray command( const KDevelop::IProject * project, KDevelop::Path const & source );
+
+    /**
+     * @brief Record what @p source includes. For a generated unity source, @p batch
+     * is the files it includes, affectedBy() reports them in its place.
+     */
+    void setDependencies( const KDevelop::IProject * project, KDevelop::Path const & source,
+                          KDevelop::Path::List const & headers, QByteArray const & command,
+                          KDevelop::Path::List const & batch = KDevelop::Path::List() );
+
+    void remove( const KDevelop::IProject * project, KDevelop::Path const & source );
+
+    /**
+     * @brief The sources of the solution that include @p header, directly or not.
+     * Paths are compared ignoring the case, like Windows does.
+     */
+    KDevelop::Path::List affectedBy( const KDevelop::IProject * project, KDevelop::Path const & header );
+
+    /**
+     * @brief Write the database of @p project to disk, if it changed.
+     */
+    void sync( const KDevelop::IProject * project );
+
+    /**
+     * @brief Removes the /showIncludes notes from the compiler @p output and
+     * returns the included files in @p headers.
+     */
+    static QString takeIncludes( QString const & output, KDevelop::Path::List & headers );
+
+private:
+    MsvcDependencyDatabase() = default;
+
+    struct Data
+    {
+        KDevelop::Path file;
+        QHash<KDevelop::Path, KDevelop::Path::List> dependencies;
+        QHash<KDevelop::Path, QByteArray> commands;
+        QHash<KDevelop::Path, KDevelop::Path::List> batches;
+
+        // Reverse of dependencies, by includerKey() of the header; a source includes itself
+        QHash<QString, QSet<KDevelop::Path>> includers;
+
+        bool dirty = false;
+    };
+
+    Data & data( const KDevelop::IProject * project );
+    static void load( Data & data );
+
+    static QString includerKey( KDevelop::Path const & path );
+    static void index( Data & data, KDevelop::Path const & source );
+    static void unindex( Data & data, KDevelop::Path const & source );
+
+    QMutex m_mutex;
+    QHash<KDevelop::Path, Data> m_projects;
+};
+
+#endif //MSVCDEPENDENCIES_H
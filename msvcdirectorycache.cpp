@@ -0,0 +1,272 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "msvcdirectorycache.h"
+#include "msvctrace.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <QtConcurrent/QtConcurrentMap>
+
+namespace
+{
+
+// '*' and '?' within one path segment, case insensitive like Windows
+bool matchSegment( QString const & pattern, QString const & name )
+{
+    int p = 0, n = 0, star = -1, starName = 0;
+    while ( n < name.size() )
+    {
+        if ( p < pattern.size() && ( pattern[p] == '?' || pattern[p].toCaseFolded() == name[n].toCaseFolded() ) )
+        {
+            ++p;
+            ++n;
+        }
+        else if ( p < pattern.size() && pattern[p] == '*' )
+        {
+            star = p++;
+            starName = n;
+        }
+        else if ( star >= 0 )
+        {
+            p = star + 1;
+            n = ++starName;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    while ( p < pattern.size() && pattern[p] == '*' )
+        ++p;
+    return p == pattern.size();
+}
+
+// Whole paths, "**" stands for any number of segments
+bool matchSegmentsFrom( QStringList const & pattern, int p, QStringList const & path, int n )
+{
+    if ( p == pattern.size() )
+        return n == path.size();
+
+    if ( pattern[p] == QLatin1String("**") )
+    {
+        for ( int k = n; k <= path.size(); ++k )
+        {
+            if ( matchSegmentsFrom( pattern, p + 1, path, k ) )
+                return true;
+        }
+        return false;
+    }
+
+    return n < path.size() && matchSegment( pattern[p], path[n] ) && matchSegmentsFrom( pattern, p + 1, path, n + 1 );
+}
+
+// Whether a directory below @p path can still match
+bool prefixMatches( QStringList const & pattern, QStringList const & path )
+{
+    for ( int i = 0; i < path.size(); ++i )
+    {
+        if ( i >= pattern.size() )
+            return false;
+        if ( pattern[i] == QLatin1String("**") )
+            return true;
+        if ( !matchSegment( pattern[i], path[i] ) )
+            return false;
+    }
+    return true;
+}
+
+QStringList splitItems( QString const & items )
+{
+    QStringList result;
+    for ( QString item : items.split( ';', QString::SkipEmptyParts ) )
+    {
+        item = item.trimmed().replace( '\\', '/' );
+        if ( !item.isEmpty() )
+            result << item;
+    }
+    return result;
+}
+
+struct Directory
+{
+    QString path;
+    QStringList relative;
+};
+
+struct ListDirectory
+{
+    typedef MsvcDirectoryCache::Listing result_type;
+
+    MsvcDirectoryCache::Listing operator()( Directory const & dir ) const
+    {
+        return cache->list( dir.path );
+    }
+
+    MsvcDirectoryCache * cache;
+};
+
+}
+
+bool MsvcDirectoryCache::hasWildcards( QString const & item )
+{
+    return item.contains( '*' ) || item.contains( '?' );
+}
+
+bool MsvcDirectoryCache::matchSegment( QString const & pattern, QString const & name )
+{
+    return ::matchSegment( pattern, name );
+}
+
+bool MsvcDirectoryCache::matchSegments( QStringList const & pattern, QStringList const & path )
+{
+    return ::matchSegmentsFrom( pattern, 0, path, 0 );
+}
+
+MsvcDirectoryCache::Listing MsvcDirectoryCache::list( QString const & dir )
+{
+    const QDateTime modified = QFileInfo( dir ).lastModified();
+    {
+        QMutexLocker lock( &m_mutex );
+
+        auto it = m_entries.constFind( dir );
+        if ( it != m_entries.constEnd() && it->modified == modified )
+            return it->listing;
+    }
+
+    MsvcTrace::count( "directory listings" );
+
+    // Symbolic links to directories are not followed, they could loop
+    const QDir d( dir );
+    Listing listing;
+    listing.files = d.entryList( QDir::Files | QDir::Hidden, QDir::NoSort );
+    listing.directories = d.entryList( QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden | QDir::NoSymLinks, QDir::NoSort );
+
+    QMutexLocker lock( &m_mutex );
+    m_entries.insert( dir, { modified, listing } );
+    return listing;
+}
+
+QStringList MsvcDirectoryCache::expand( QString const & baseDir, QString const & include, QString const & exclude )
+{
+    QList<QStringList> excludePatterns;
+    QStringList excludePaths;
+    for ( const QString & e : splitItems( exclude ) )
+    {
+        if ( hasWildcards( e ) )
+            excludePatterns << e.split( '/', QString::SkipEmptyParts );
+        else
+            excludePaths << e;
+    }
+
+    auto excluded = [&excludePatterns, &excludePaths]( QString const & path )
+    {
+        if ( excludePaths.contains( path, Qt::CaseInsensitive ) )
+            return true;
+
+        const QStringList segments = path.split( '/', QString::SkipEmptyParts );
+        for ( const QStringList & pattern : excludePatterns )
+        {
+            if ( matchSegmentsFrom( pattern, 0, segments, 0 ) )
+                return true;
+        }
+        return false;
+    };
+
+    QStringList result;
+    for ( const QString & item : splitItems( include ) )
+    {
+        if ( !hasWildcards( item ) )
+        {
+            if ( !excluded( item ) )
+                result << item;
+            continue;
+        }
+
+        MSVC_TRACE_SPAN_DETAIL( "glob", item );
+
+        // The part before the first wildcard is a plain directory
+        int wildcard = item.indexOf( '*' );
+        const int question = item.indexOf( '?' );
+        if ( question >= 0 && ( wildcard < 0 || question < wildcard ) )
+            wildcard = question;
+        const int slash = item.lastIndexOf( '/', wildcard );
+        const QString fixed = slash < 0 ? QString() : item.left( slash );
+
+        QStringList dirPattern = item.mid( slash + 1 ).split( '/', QString::SkipEmptyParts );
+        QString filePattern = dirPattern.takeLast();
+        if ( filePattern == QLatin1String("**") )
+        {
+            // "dir/**" is every file below dir
+            dirPattern << filePattern;
+            filePattern = QStringLiteral("*");
+        }
+
+        const bool recursive = dirPattern.contains( QStringLiteral("**") );
+        const QString prefix = fixed.isEmpty() ? QString() : fixed + '/';
+
+        QList<Directory> level;
+        level << Directory{ QDir::isAbsolutePath( fixed ) ? fixed : QDir( baseDir ).filePath( fixed ), {} };
+
+        QStringList matches;
+        while ( !level.isEmpty() )
+        {
+            const QList<Listing> listings = QtConcurrent::blockingMapped< QList<Listing> >( level, ListDirectory{ this } );
+
+            QList<Directory> next;
+            for ( int i = 0; i < level.size(); ++i )
+            {
+                const Directory & dir = level[i];
+                const Listing & listing = listings[i];
+
+                if ( matchSegmentsFrom( dirPattern, 0, dir.relative, 0 ) )
+                {
+                    const QString dirPrefix = prefix + ( dir.relative.isEmpty() ? QString() : dir.relative.join( '/' ) + '/' );
+                    for ( const QString & file : listing.files )
+                    {
+                        if ( !matchSegment( filePattern, file ) )
+                            continue;
+
+                        const QString path = dirPrefix + file;
+                        if ( !excluded( path ) )
+                            matches << path;
+                    }
+                }
+
+                if ( !recursive && dir.relative.size() >= dirPattern.size() )
+                    continue;
+
+                for ( const QString & sub : listing.directories )
+                {
+                    const QStringList relative = dir.relative + QStringList( sub );
+                    if ( prefixMatches( dirPattern, relative ) )
+                        next << Directory{ dir.path + '/' + sub, relative };
+                }
+            }
+            level = next;
+        }
+
+        matches.sort( Qt::CaseInsensitive );
+        result << matches;
+    }
+    return result;
+}
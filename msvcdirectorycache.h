@@ -0,0 +1,86 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCDIRECTORYCACHE_H
+#define MSVCDIRECTORYCACHE_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+
+/**
+ * @brief Expands the wildcards of MSBuild items.
+ *
+ * Directory listings are kept for the whole solution, so globs over the
+ * same tree share them, and a directory is only listed again when its
+ * modification time changed. The levels of a recursive glob are listed in
+ * parallel.
+ */
+class MsvcDirectoryCache
+{
+public:
+    struct Listing
+    {
+        QStringList files;
+        QStringList directories;
+    };
+
+    static bool hasWildcards( QString const & item );
+
+    /**
+     * @brief Returns true if the path segment @p name matches @p pattern,
+     * where '*' and '?' do not cross segments. The case is ignored, like Windows does.
+     */
+    static bool matchSegment( QString const & pattern, QString const & name );
+
+    /**
+     * @brief Returns true if the segments of @p path match @p pattern,
+     * where a "**" segment matches any number of segments.
+     */
+    static bool matchSegments( QStringList const & pattern, QStringList const & path );
+
+    /**
+     * @brief Expand the Include of an item, with MSBuild semantics.
+     *
+     * @p include and @p exclude are ';' separated lists of paths relative to
+     * @p baseDir, '*' and '?' match within a path segment, "**" matches any
+     * number of directories. Paths without wildcards are kept as they are.
+     * The results are written like the include, with forward slashes.
+     */
+    QStringList expand( QString const & baseDir, QString const & include, QString const & exclude );
+
+    /**
+     * @brief The files and subdirectories of @p dir.
+     */
+    Listing list( QString const & dir );
+
+private:
+    struct Entry
+    {
+        QDateTime modified;
+        Listing listing;
+    };
+
+    QMutex m_mutex;
+    QHash< QString, Entry > m_entries;
+};
+
+#endif //MSVCDIRECTORYCACHE_H
@@ -0,0 +1,107 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "msvcfileregistry.h"
+
+KDevelop::Path MsvcFileRegistry::add( KDevelop::Path const & path, MsvcProjectItem * project )
+{
+    QMutexLocker lock( &m_mutex );
+
+    auto it = m_files.find( path );
+    if ( it == m_files.end() )
+        it = m_files.insert( path, {} );
+
+    if ( !it->contains( project ) )
+        it->append( project );
+
+    return it.key();
+}
+
+KDevelop::Path MsvcFileRegistry::canonical( KDevelop::Path const & path ) const
+{
+    QMutexLocker lock( &m_mutex );
+
+    auto it = m_files.constFind( path );
+    return it == m_files.constEnd() ? path : it.key();
+}
+
+QList<MsvcProjectItem*> MsvcFileRegistry::projectsContaining( KDevelop::Path const & path ) const
+{
+    QMutexLocker lock( &m_mutex );
+
+    return m_files.value( path ).toList();
+}
+
+MsvcProjectItem * MsvcFileRegistry::owningProject( KDevelop::Path const & path ) const
+{
+    QMutexLocker lock( &m_mutex );
+
+    auto it = m_files.constFind( path );
+    return it != m_files.constEnd() && it->size() == 1 ? it->front() : nullptr;
+}
+
+void MsvcFileRegistry::remove( KDevelop::Path const & path, MsvcProjectItem * project )
+{
+    QMutexLocker lock( &m_mutex );
+
+    auto it = m_files.find( path );
+    if ( it == m_files.end() )
+        return;
+
+    it->removeOne( project );
+    if ( it->isEmpty() )
+        m_files.erase( it );
+}
+
+void MsvcFileRegistry::removeProject( MsvcProjectItem * project )
+{
+    QMutexLocker lock( &m_mutex );
+
+    for ( auto it = m_files.begin(); it != m_files.end(); )
+    {
+        it->removeOne( project );
+        if ( it->isEmpty() )
+            it = m_files.erase( it );
+        else
+            ++it;
+    }
+}
+
+void MsvcFileRegistry::clear()
+{
+    QMutexLocker lock( &m_mutex );
+    m_files.clear();
+}
+
+int MsvcFileRegistry::fileCount() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_files.size();
+}
+
+int MsvcFileRegistry::referenceCount() const
+{
+    QMutexLocker lock( &m_mutex );
+
+    int result = 0;
+    for ( const QVector<MsvcProjectItem*> & owners : m_files )
+        result += owners.size();
+    return result;
+}
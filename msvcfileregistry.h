@@ -0,0 +1,78 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCFILEREGISTRY_H
+#define MSVCFILEREGISTRY_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QVector>
+
+#include <kdevplatform/util/path.h>
+
+class MsvcProjectItem;
+
+/**
+ * @brief The files of a solution, each stored once.
+ *
+ * Every project listing a file gets the same Path instance from add(), so
+ * the file items of a shared header share their path storage. The registry
+ * is also the index from a path to the projects listing it, kept up to date
+ * by the import and the re-parse of a project, so the owner of a file is
+ * found without walking the model. Used from the parser threads.
+ */
+class MsvcFileRegistry
+{
+public:
+    /**
+     * @brief Record that @p project lists @p path and return the canonical instance of the path.
+     */
+    KDevelop::Path add( KDevelop::Path const & path, MsvcProjectItem * project );
+
+    /**
+     * @brief The canonical instance of @p path, or @p path if it is not known.
+     */
+    KDevelop::Path canonical( KDevelop::Path const & path ) const;
+
+    QList<MsvcProjectItem*> projectsContaining( KDevelop::Path const & path ) const;
+
+    /**
+     * @brief The project listing @p path, null if none or several do.
+     */
+    MsvcProjectItem * owningProject( KDevelop::Path const & path ) const;
+
+    /**
+     * @brief @p project does not list @p path any more.
+     */
+    void remove( KDevelop::Path const & path, MsvcProjectItem * project );
+
+    void removeProject( MsvcProjectItem * project );
+    void clear();
+
+    int fileCount() const;
+    int referenceCount() const;
+
+private:
+    mutable QMutex m_mutex;
+    QHash< KDevelop::Path, QVector<MsvcProjectItem*> > m_files;
+};
+
+#endif //MSVCFILEREGISTRY_H
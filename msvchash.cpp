@@ -0,0 +1,173 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "msvchash.h"
+
+#include <QtEndian>
+
+#include <cstring>
+
+namespace
+{
+
+const quint64 PRIME1 = 0x9E3779B185EBCA87ULL;
+const quint64 PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+const quint64 PRIME3 = 0x165667B19E3779F9ULL;
+const quint64 PRIME4 = 0x85EBCA77C2B2AE63ULL;
+const quint64 PRIME5 = 0x27D4EB2F165667C5ULL;
+
+inline quint64 rotl( quint64 x, int r )
+{
+    return ( x << r ) | ( x >> ( 64 - r ) );
+}
+
+inline quint64 read64( uchar const * p )
+{
+    quint64 value;
+    std::memcpy( &value, p, sizeof(value) );
+    return qFromLittleEndian( value );
+}
+
+inline quint32 read32( uchar const * p )
+{
+    quint32 value;
+    std::memcpy( &value, p, sizeof(value) );
+    return qFromLittleEndian( value );
+}
+
+inline quint64 round( quint64 acc, quint64 input )
+{
+    acc += input * PRIME2;
+    acc = rotl( acc, 31 );
+    return acc * PRIME1;
+}
+
+inline quint64 mergeRound( quint64 acc, quint64 value )
+{
+    acc ^= round( 0, value );
+    return acc * PRIME1 + PRIME4;
+}
+
+}
+
+MsvcHash::State::State( quint64 seed ) :
+    seed(seed),
+    v{ seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1 }
+{
+}
+
+void MsvcHash::State::consume( uchar const * stripe )
+{
+    for ( int i = 0; i < 4; ++i )
+        v[i] = round( v[i], read64( stripe + 8 * i ) );
+}
+
+quint64 MsvcHash::State::digest( uchar const * tail, int size, quint64 length ) const
+{
+    quint64 h;
+    if ( length >= 32 )
+    {
+        h = rotl( v[0], 1 ) + rotl( v[1], 7 ) + rotl( v[2], 12 ) + rotl( v[3], 18 );
+        for ( int i = 0; i < 4; ++i )
+            h = mergeRound( h, v[i] );
+    }
+    else
+    {
+        h = seed + PRIME5;
+    }
+    h += length;
+
+    uchar const * p = tail;
+    uchar const * const end = tail + size;
+    for ( ; p + 8 <= end; p += 8 )
+    {
+        h ^= round( 0, read64( p ) );
+        h = rotl( h, 27 ) * PRIME1 + PRIME4;
+    }
+    if ( p + 4 <= end )
+    {
+        h ^= quint64( read32( p ) ) * PRIME1;
+        h = rotl( h, 23 ) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for ( ; p < end; ++p )
+    {
+        h ^= quint64( *p ) * PRIME5;
+        h = rotl( h, 11 ) * PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+MsvcHash::MsvcHash() :
+    m_states{ State( 0 ), State( PRIME5 ) }
+{
+}
+
+void MsvcHash::addData( char const * data, int size )
+{
+    uchar const * p = reinterpret_cast<uchar const *>( data );
+    uchar const * const end = p + size;
+    m_length += size;
+
+    // Complete the stripe left over by the last call first
+    if ( m_buffered > 0 )
+    {
+        const int n = qMin( 32 - m_buffered, size );
+        std::memcpy( m_buffer + m_buffered, p, n );
+        m_buffered += n;
+        p += n;
+        if ( m_buffered < 32 )
+            return;
+
+        for ( State & state : m_states )
+            state.consume( m_buffer );
+        m_buffered = 0;
+    }
+
+    for ( ; p + 32 <= end; p += 32 )
+    {
+        for ( State & state : m_states )
+            state.consume( p );
+    }
+
+    m_buffered = int( end - p );
+    std::memcpy( m_buffer, p, m_buffered );
+}
+
+QByteArray MsvcHash::result() const
+{
+    QByteArray result( 16, Qt::Uninitialized );
+    for ( int i = 0; i < 2; ++i )
+        qToBigEndian( m_states[i].digest( m_buffer, m_buffered, m_length ), reinterpret_cast<uchar *>( result.data() ) + 8 * i );
+    return result;
+}
+
+QByteArray MsvcHash::hash( QByteArray const & data )
+{
+    MsvcHash hash;
+    hash.addData( data );
+    return hash.result();
+}
@@ -0,0 +1,67 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCHASH_H
+#define MSVCHASH_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+/**
+ * @brief Fast non-cryptographic 128 bit hash, for content addressed keys.
+ *
+ * Two XXH64 with different seeds over the same data: many times faster than
+ * MD5 on preprocessed sources, and wide enough for a local cache key.
+ * The data can be added in chunks of any size, the result does not depend on them.
+ */
+class MsvcHash
+{
+public:
+    MsvcHash();
+
+    void addData( char const * data, int size );
+    void addData( QByteArray const & data ) { addData( data.constData(), data.size() ); }
+
+    /**
+     * @brief The 16 bytes of the hash of what was added so far.
+     */
+    QByteArray result() const;
+
+    static QByteArray hash( QByteArray const & data );
+
+private:
+    struct State
+    {
+        explicit State( quint64 seed );
+
+        void consume( uchar const * stripe );
+        quint64 digest( uchar const * tail, int size, quint64 length ) const;
+
+        quint64 seed;
+        quint64 v[4];
+    };
+
+    State m_states[2];
+    uchar m_buffer[32];
+    int m_buffered = 0;
+    quint64 m_length = 0;
+};
+
+#endif //MSVCHASH_H
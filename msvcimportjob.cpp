@@ -20,17 +20,26 @@
 
 #include "msvcimportjob.h"
 #include "debug.h"
+#include "msvcconfig.h"
+#include "msvcinputfile.h"
 #include "msvcmodelitems.h"
+#include "msvcprojectdiff.h"
+#include "msvcprojectgraph.h"
 #include "msvcprojectparser.h"
+#include "msvcstatistics.h"
+#include "msvctrace.h"
 
 #include <QDebug>
-#include <QFile>
+#include <QElapsedTimer>
 #include <QFutureWatcher>
 #include <QRegularExpression>
+#include <QSet>
 #include <QThreadPool>
 #include <QUuid>
 #include <QXmlStreamReader>
 
+#include <algorithm>
+
 #include <QtConcurrent/QtConcurrentRun>
 
 #include <KLocalizedString>
@@ -61,11 +70,29 @@ MsvcProjectParser * CreateProjectParser( KDevelop::Path const & path, KDevelop::
 
 MsvcImportSolutionJob::MsvcImportSolutionJob(MsvcSolutionItem* dom) :
     m_dom(dom),
-    m_solutionPath(dom->path()),
-    m_futureWatcher(new QFutureWatcher<void>(this))
+    m_solutionFiles(dom->solutionFiles()),
+    m_futureWatcher(new QFutureWatcher<void>(this)),
+    m_startupProject(MsvcConfig::startupProject(dom->project())),
+    m_recentProjects(MsvcConfig::recentProjects(dom->project()))
 {
+    connect(this, &MsvcImportSolutionJob::projectReady,
+            this, &MsvcImportSolutionJob::publishReadyProjects, Qt::QueuedConnection);
     connect(m_futureWatcher, &QFutureWatcher<void>::finished,
-            this, [this]() { emitResult(); } );
+            this, [this]()
+            {
+                for ( const QString & config : m_configurations )
+                    m_dom->addConfiguration( config );
+                publishReadyProjects();
+                m_dom->setProjectDependencies( m_dependencies );
+                for ( const QList<MsvcProjectItem*> & cycle : m_dom->dependencyGraph()->cycles() )
+                {
+                    QStringList names;
+                    for ( MsvcProjectItem * proj : cycle )
+                        names << proj->text();
+                    qCWarning(KDEV_MSVC) << "Projects depending on each other:" << names;
+                }
+                emitResult();
+            } );
     
     setCapabilities(KJob::Killable);
     setObjectName(i18n("Solution Import: %1", m_dom->project()->name()));
@@ -75,6 +102,10 @@ MsvcImportSolutionJob::~MsvcImportSolutionJob()
 {
     m_futureWatcher->cancel();
     m_futureWatcher->waitForFinished();
+
+    // Parsed but never shown
+    for ( const auto & ready : m_ready )
+        delete ready.first;
 }
 
 void MsvcImportSolutionJob::start()
@@ -91,10 +122,19 @@ bool MsvcImportSolutionJob::doKill()
     return true;
 }
 
-void MsvcImportSolutionJob::parseProject(const QString & relativePath)
+void MsvcImportSolutionJob::parseProject(const KDevelop::Path & path)
 {
-    const KDevelop::Path path (m_solutionPath.parent(), relativePath);
+    MSVC_TRACE_SPAN_DETAIL( "project parse", path.pathOrUrl() );
+
+    QElapsedTimer timer;
+    timer.start();
+
     QScopedPointer< MsvcProjectParser > parser( CreateProjectParser( path, m_dom->project() ) );
+    if ( !parser )
+        return;
+    parser->setFileRegistry( m_dom->fileRegistry() );
+    parser->setDirectoryCache( m_dom->directoryCache() );
+    parser->setParseCache( m_dom->parseCache() );
     
     // Although MsvcProjectParser can work asynchronously, I could not figure out
     // how to protect access to IProject. Run it synchrnously for now.
@@ -104,19 +144,110 @@ void MsvcImportSolutionJob::parseProject(const QString & relativePath)
     
     if ( future.isResultReadyAt(0) )
     {
-        m_dom->appendRow( future.result() );
+        {
+            QMutexLocker lock( &m_readyMutex );
+            m_ready << qMakePair( future.result(), timer.elapsed() );
+        }
+        emit projectReady();
+    }
+}
+
+void MsvcImportSolutionJob::publishReadyProjects()
+{
+    QList< QPair<MsvcProjectItem*, qint64> > ready;
+    {
+        QMutexLocker lock( &m_readyMutex );
+        ready.swap( m_ready );
+    }
+
+    for ( const auto & project : ready )
+    {
+        MsvcStatistics::self().setParseTime( project.first->path(), project.second );
+        m_dom->appendRow( project.first );
     }
 }
 
 void MsvcImportSolutionJob::run()
 {
-    QFile file( m_solutionPath.toLocalFile() );
-    if (! file.open(QFile::ReadOnly) )
+    QList<SolutionProject> projects;
+    for ( const KDevelop::Path & solution : m_solutionFiles )
+        readSolution( solution, projects );
+
+    for ( const SolutionProject & project : projects )
+    {
+        if ( !project.dependencies.isEmpty() )
+            m_dependencies.insert( project.uuid, project.dependencies );
+    }
+
+    for ( int index : priorityOrder( projects ) )
+    {
+        if ( m_futureWatcher->isCanceled() )
+            return;
+
+        qCDebug(KDEV_MSVC) << "About to parse project file: " << projects[index].path;
+        parseProject( projects[index].path );
+    }
+}
+
+QList<int> MsvcImportSolutionJob::priorityOrder( QList<SolutionProject> const & projects ) const
+{
+    QList<int> order;
+    QSet<int> queued;
+    auto enqueue = [&order, &queued]( int index )
     {
-        qCWarning(KDEV_MSVC) << "Failed to open " << m_solutionPath;
+        if ( index >= 0 && !queued.contains( index ) )
+        {
+            queued.insert( index );
+            order << index;
+        }
+    };
+
+    auto indexOfName = [&projects]( QString const & name )
+    {
+        for ( int i = 0; i < projects.size(); ++i )
+        {
+            if ( projects[i].name.compare( name, Qt::CaseInsensitive ) == 0 )
+                return i;
+        }
+        return -1;
+    };
+
+    if ( !m_startupProject.isEmpty() )
+        enqueue( indexOfName( m_startupProject ) );
+    for ( const QString & name : m_recentProjects )
+        enqueue( indexOfName( name ) );
+
+    // What they depend on, nearest first
+    QHash<QUuid, int> byUuid;
+    for ( int i = 0; i < projects.size(); ++i )
+        byUuid.insert( projects[i].uuid, i );
+
+    for ( int i = 0; i < order.size(); ++i )
+    {
+        for ( const QUuid & dependency : projects[order[i]].dependencies )
+            enqueue( byUuid.value( dependency, -1 ) );
+    }
+
+    for ( int i = 0; i < projects.size(); ++i )
+        enqueue( i );
+
+    return order;
+}
+
+void MsvcImportSolutionJob::readSolution( KDevelop::Path const & solution, QList<SolutionProject> & projects )
+{
+    MSVC_TRACE_SPAN_DETAIL( "sln read", solution.pathOrUrl() );
+
+    MsvcInputFile input( solution.toLocalFile() );
+    if (! input.open() )
+    {
+        qCWarning(KDEV_MSVC) << "Failed to open " << solution;
         return;
     }
     
+    // Decoded once, the lines are cut from the text
+    MsvcLineReader file( input.text() );
+
     QString line; 
     
     // TODO split this mess into multiple functions in a class.
@@ -148,34 +279,52 @@ void MsvcImportSolutionJob::run()
 
             QRegularExpressionMatch result = regex.match( line );
 
-            if (! result.isValid() )
+            if (! result.hasMatch() )
             {
                 continue; // Ignore stuff we do not know about
             }
 
-            QString nextLine;
+            SolutionProject project;
+//             QUuid _ = result.captured(1);
+            project.name = result.captured(2);
+            project.path = KDevelop::Path( solution.parent(), result.captured(3).replace('\\','/') );
+            project.uuid = QUuid( result.captured(4) );
 
-            // Skip dependency description and other amenities..
+            // The ProjectDependencies section lists "{uuid} = {uuid}", skip the other amenities..
+            static const QRegularExpression dependencyRegex( R"(^(\{[A-Fa-f0-9\-]+\})\s*=\s*\{[A-Fa-f0-9\-]+\}$)" );
+
+            QString nextLine;
             do
             {
                 nextLine = file.readLine();
-            }
-            while ( !(file.error() || file.atEnd() || nextLine.startsWith("EndProject") ) );
 
-//             QUuid _ = result.captured(1);
-            QString projectName = result.captured(2);
-            QString projectPath = result.captured(3);
-//             QUuid projectUUID = result.captured(4);
-
-            qCDebug(KDEV_MSVC) << "About to parse project file: " << projectPath;
+                QRegularExpressionMatch dependency = dependencyRegex.match( nextLine.trimmed() );
+                if ( dependency.hasMatch() )
+                    project.dependencies << QUuid( dependency.captured(1) );
+            }
+            while ( !(file.atEnd() || nextLine.startsWith("EndProject") ) );
 
-            parseProject( projectPath.replace('\\','/') );
+            // Listed by an other solution too
+            auto known = std::find_if( projects.begin(), projects.end(),
+                                       [&project]( SolutionProject const & p ) { return p.path == project.path; } );
+            if ( known == projects.end() )
+            {
+                projects << project;
+            }
+            else
+            {
+                for ( const QUuid & dependency : project.dependencies )
+                {
+                    if ( !known->dependencies.contains( dependency ) )
+                        known->dependencies << dependency;
+                }
+            }
         }
         else if ( line.trimmed().startsWith(globStart) )
         {
-            while ( line = file.readLine(), !(file.error() || file.atEnd() || line.trimmed().startsWith(globEnd) ) )
+            while ( line = file.readLine(), !(file.atEnd() || line.trimmed().startsWith(globEnd) ) )
             {
-                const QRegularExpression globalSectionStart (R"(GlobalSection\s*\(([a-zA-Z]+)\)\s*=\s*([a-zA-Z]+))");
+                static const QRegularExpression globalSectionStart (R"(GlobalSection\s*\(([a-zA-Z]+)\)\s*=\s*([a-zA-Z]+))");
                 const QString globalSectionEnd = "EndGlobalSection";
 
                 QRegularExpressionMatch result = globalSectionStart.match( line.trimmed() );
@@ -186,15 +335,15 @@ void MsvcImportSolutionJob::run()
                 if ( result.captured(1) == "SolutionConfigurationPlatforms" && 
                      result.captured(2) == "preSolution" )
                 {
-                    while ( line = file.readLine(), !(file.error() || file.atEnd() || line.startsWith(globalSectionEnd) ) )
+                    while ( line = file.readLine(), !(file.atEnd() || line.startsWith(globalSectionEnd) ) )
                     {
-                        const QRegularExpression configRegex (R"(([a-zA-Z0-9_]+\|[a-zA-Z0-9_]+)\s*=\s*[a-zA-Z0-9_]+\|[a-zA-Z0-9_]+)");
+                        static const QRegularExpression configRegex (R"(([a-zA-Z0-9_]+\|[a-zA-Z0-9_]+)\s*=\s*[a-zA-Z0-9_]+\|[a-zA-Z0-9_]+)");
 
                         QRegularExpressionMatch cfgMatch = configRegex.match( line.trimmed() );
 
                         if ( cfgMatch.isValid() )
                         {
-                            m_dom->addConfiguration( cfgMatch.captured(1) );
+                            m_configurations << cfgMatch.captured(1);
                         }
                     }
                 }
@@ -203,3 +352,108 @@ void MsvcImportSolutionJob::run()
         // else skip line
     }
 }
+
+MsvcReloadProjectJob::MsvcReloadProjectJob(MsvcProjectItem* item) :
+    m_project(item->project()),
+    m_projectPath(item->path()),
+    m_parser(CreateProjectParser(item->path(), item->project())),
+    m_futureWatcher(new QFutureWatcher< std::shared_ptr<MsvcProjectData> >(this))
+{
+    if ( m_parser )
+    {
+        if ( MsvcSolutionItem * solItem = dynamic_cast<MsvcSolutionItem*>( item->parent() ) )
+        {
+            m_parser->setDirectoryCache( solItem->directoryCache() );
+            // Reloaded because something changed, maybe only what the cache cannot see
+            m_parser->setParseCache( solItem->parseCache(), false );
+        }
+    }
+
+    connect(m_futureWatcher, &QFutureWatcher< std::shared_ptr<MsvcProjectData> >::finished,
+            this, [this]()
+            {
+                if ( !m_futureWatcher->isCanceled() )
+                    apply( m_futureWatcher->result() );
+                emitResult();
+            } );
+
+    setCapabilities(KJob::Killable);
+    setObjectName(i18n("Project Reload: %1", item->text()));
+}
+
+MsvcReloadProjectJob::~MsvcReloadProjectJob()
+{
+    if ( m_futureWatcher )
+    {
+        m_futureWatcher->cancel();
+        m_futureWatcher->waitForFinished();
+    }
+    delete m_parser;
+}
+
+void MsvcReloadProjectJob::start()
+{
+    if ( !m_parser )
+    {
+        setError( KJob::UserDefinedError );
+        setErrorText( i18n("Unknown project file type: %1", m_projectPath.pathOrUrl()) );
+        emitResult();
+        return;
+    }
+
+    m_futureWatcher->setFuture( QtConcurrent::run( m_parser, &MsvcProjectParser::parseData ) );
+}
+
+bool MsvcReloadProjectJob::doKill()
+{
+    // Do not wait for the parser, it goes away on its own once done
+    QFutureWatcher< std::shared_ptr<MsvcProjectData> > * watcher = m_futureWatcher;
+    MsvcProjectParser * parser = m_parser;
+    m_futureWatcher = nullptr;
+    m_parser = nullptr;
+
+    watcher->disconnect( this );
+    watcher->setParent( nullptr );
+    watcher->cancel();
+
+    if ( watcher->isRunning() )
+    {
+        connect( watcher, &QFutureWatcher< std::shared_ptr<MsvcProjectData> >::finished,
+                 watcher, [watcher, parser]()
+                 {
+                     delete parser;
+                     watcher->deleteLater();
+                 } );
+    }
+    else
+    {
+        delete parser;
+        watcher->deleteLater();
+    }
+
+    return true;
+}
+
+void MsvcReloadProjectJob::apply( std::shared_ptr<MsvcProjectData> const & data )
+{
+    if ( !data )
+    {
+        setError( KJob::UserDefinedError );
+        setErrorText( i18n("Could not parse %1", m_projectPath.pathOrUrl()) );
+        return;
+    }
+
+    // The item (or the whole project) may have gone away while we were parsing
+    MsvcSolutionItem * solItem = m_project ? dynamic_cast<MsvcSolutionItem*>( m_project->projectItem() ) : nullptr;
+    if ( !solItem )
+        return;
+
+    for ( MsvcProjectItem * proj : solItem->projects() )
+    {
+        if ( proj->path() == m_projectPath )
+        {
+            m_changedFiles = MsvcProjectDiff::apply( proj, data ).reparse;
+            return;
+        }
+    }
+}
@@ -25,11 +25,19 @@
 #include <KJob>
 #include <KCompositeJob>
 
+#include <QHash>
+#include <QMutex>
+#include <QPointer>
+#include <QUuid>
+
 #include <kdevplatform/util/path.h>
 
+#include <memory>
+
 template<class> class QFutureWatcher;
 class QXmlStreamReader;
 
+class MsvcProjectData;
 class MsvcProjectItem;
 class MsvcSolutionItem;
 class MsvcProjectParser;
@@ -41,6 +49,13 @@ class ProjectFolderItem;
 class IProject;
 }
 
+/**
+ * @brief Read the solutions of an item and parse their projects.
+ *
+ * A project listed by several solutions is parsed and added once. The startup project and the recently used ones are parsed first, then
+ * the projects they depend on, then the rest in solution order. Each project
+ * is added to the solution item as soon as it is parsed.
+ */
 class MsvcImportSolutionJob : public KJob
 {
     Q_OBJECT
@@ -50,19 +65,83 @@ public:
     
     void start() override;
 
+Q_SIGNALS:
+    // Emitted from the parsing thread, queued
+    void projectReady();
+
 protected:
     bool doKill() override;
 
 private:
-    void parseProject( const QString & relativePath );
+    struct SolutionProject
+    {
+        QString name;
+        KDevelop::Path path;
+        QUuid uuid;
+        QList<QUuid> dependencies;
+    };
+
+    void parseProject( const KDevelop::Path & path );
+
+    /**
+     * @brief Add the parsed projects to the solution, in the main thread.
+     */
+    void publishReadyProjects();
+
+    /**
+     * @brief Read the projects of @p solution into @p projects, merging those already listed.
+     */
+    void readSolution( KDevelop::Path const & solution, QList<SolutionProject> & projects );
+    QList<int> priorityOrder( QList<SolutionProject> const & projects ) const;
 
 private:
     void run();
 
     MsvcSolutionItem * m_dom;
-    KDevelop::Path m_solutionPath;
+    KDevelop::Path::List m_solutionFiles;
     QFutureWatcher<void> * m_futureWatcher;
+
+    // Filled by run(), handed to the solution when it is done
+    QHash< QUuid, QList<QUuid> > m_dependencies;
+    QStringList m_configurations;
+
+    QString m_startupProject;
+    QStringList m_recentProjects;
+
+    QMutex m_readyMutex;
+    QList< QPair<MsvcProjectItem*, qint64> > m_ready;
 };
 
 
+/**
+ * @brief Parse one project of a solution again and update its item with
+ * MsvcProjectDiff, instead of replacing it.
+ */
+class MsvcReloadProjectJob : public KJob
+{
+    Q_OBJECT
+public:
+    explicit MsvcReloadProjectJob(MsvcProjectItem* item);
+    ~MsvcReloadProjectJob();
+
+    void start() override;
+
+    /**
+     * @brief Files whose parse is out of date after the update.
+     */
+    KDevelop::Path::List changedFiles() const { return m_changedFiles; }
+
+protected:
+    bool doKill() override;
+
+private:
+    void apply( std::shared_ptr<MsvcProjectData> const & data );
+
+    QPointer<KDevelop::IProject> m_project;
+    KDevelop::Path m_projectPath;
+    MsvcProjectParser * m_parser;
+    QFutureWatcher< std::shared_ptr<MsvcProjectData> > * m_futureWatcher;
+    KDevelop::Path::List m_changedFiles;
+};
+
 #endif //MSVCIMPORTJOB_H
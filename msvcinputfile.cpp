@@ -0,0 +1,164 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "msvcinputfile.h"
+#include "msvctrace.h"
+#include "debug.h"
+
+#include <QRegularExpression>
+#include <QTextCodec>
+
+#include <cstring>
+
+namespace
+{
+
+bool isAscii( QByteArray const & data )
+{
+    const uchar * p = reinterpret_cast<const uchar*>( data.constData() );
+    const uchar * end = p + data.size();
+
+    // Eight bytes at a time, the high bits of all of them at once
+    for ( ; end - p >= 8; p += 8 )
+    {
+        quint64 word;
+        memcpy( &word, p, sizeof(word) );
+        if ( word & Q_UINT64_C(0x8080808080808080) )
+            return false;
+    }
+    for ( ; p != end; ++p )
+    {
+        if ( *p & 0x80 )
+            return false;
+    }
+    return true;
+}
+
+}
+
+MsvcInputFile::MsvcInputFile( QString const & fileName ) :
+    m_file( fileName )
+{
+}
+
+bool MsvcInputFile::open()
+{
+    MSVC_TRACE_SPAN_DETAIL( "input open", m_file.fileName() );
+
+    if ( !m_file.open( QFile::ReadOnly ) )
+        return false;
+
+    // A mapping faults (SIGBUS) if the file is truncated while we read it, which
+    // happens when Visual Studio saves it. Reading is as fast for the usual sizes,
+    // only the huge files are worth that risk.
+    const qint64 size = m_file.size();
+    if ( uchar * mapped = size > MapThreshold ? m_file.map( 0, size ) : nullptr )
+    {
+        m_data = QByteArray::fromRawData( reinterpret_cast<const char*>( mapped ), int( size ) );
+    }
+    else
+    {
+        m_data = m_file.readAll();
+    }
+
+    detectEncoding();
+    return true;
+}
+
+void MsvcInputFile::detectEncoding()
+{
+    if ( m_data.startsWith( "\xEF\xBB\xBF" ) )
+    {
+        m_encoding = Utf8;
+    }
+    else if ( m_data.startsWith( "\xFF\xFE" ) )
+    {
+        m_encoding = Utf16LE;
+    }
+    else if ( m_data.startsWith( "\xFE\xFF" ) )
+    {
+        m_encoding = Utf16BE;
+    }
+    else if ( isAscii( m_data ) )
+    {
+        m_encoding = Ascii;
+    }
+    else
+    {
+        // vcproj files of older versions declare windows-1252
+        static const QRegularExpression declaration( R"(^<\?xml[^>]*encoding\s*=\s*["']([^"']+)["'])" );
+
+        const QString prolog = QString::fromLatin1( m_data.left( 128 ) );
+        const QString declared = declaration.match( prolog ).captured( 1 );
+
+        if ( declared.isEmpty() || declared.compare( QLatin1String("utf-8"), Qt::CaseInsensitive ) == 0 )
+        {
+            m_encoding = Utf8;
+        }
+        else
+        {
+            m_encoding = Declared;
+            m_declared = declared.toLatin1();
+        }
+    }
+}
+
+QString MsvcInputFile::text() const
+{
+    switch ( m_encoding )
+    {
+        case Ascii:
+            return QString::fromLatin1( m_data.constData(), m_data.size() );
+        case Declared:
+            if ( QTextCodec * codec = QTextCodec::codecForName( m_declared ) )
+                return codec->toUnicode( m_data );
+            return QString::fromLatin1( m_data.constData(), m_data.size() );
+        case Utf8:
+        {
+            const int bom = m_data.startsWith( "\xEF\xBB\xBF" ) ? 3 : 0;
+            return QString::fromUtf8( m_data.constData() + bom, m_data.size() - bom );
+        }
+        case Utf16LE:
+        case Utf16BE:
+        {
+            const int size = ( m_data.size() - 2 ) / 2;
+            QString result( size, Qt::Uninitialized );
+
+            const uchar * p = reinterpret_cast<const uchar*>( m_data.constData() ) + 2;
+            for ( int i = 0; i < size; ++i, p += 2 )
+                result[i] = m_encoding == Utf16LE ? QChar( p[0], p[1] ) : QChar( p[1], p[0] );
+            return result;
+        }
+    }
+    return QString();
+}
+
+QString MsvcLineReader::readLine()
+{
+    if ( atEnd() )
+        return QString();
+
+    int end = m_text.indexOf( '\n', m_position );
+    end = end < 0 ? m_text.size() : end + 1;
+
+    const QString line = m_text.mid( m_position, end - m_position );
+    m_position = end;
+    return line;
+}
@@ -0,0 +1,103 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCINPUTFILE_H
+#define MSVCINPUTFILE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+/**
+ * @brief Read-only input of the project and solution readers.
+ *
+ * The file is read into memory, only files above MapThreshold are memory
+ * mapped (read too if that fails). Its encoding is detected once, from the
+ * byte order mark or the XML declaration. XML readers get the bytes without
+ * a copy, line based readers get the text decoded in one go, with a fast
+ * path for ASCII.
+ */
+class MsvcInputFile
+{
+public:
+    enum Encoding
+    {
+        Ascii,
+        Utf8,
+        Utf16LE,
+        Utf16BE,
+        Declared    // not Unicode, as named by the XML declaration (windows-1252 usually)
+    };
+
+    // Files up to this size are read, not mapped
+    enum { MapThreshold = 16 * 1024 * 1024 };
+
+    explicit MsvcInputFile( QString const & fileName );
+
+    bool open();
+    QString fileName() const { return m_file.fileName(); }
+
+    Encoding encoding() const { return m_encoding; }
+
+    /**
+     * @brief The raw contents, valid as long as this object is.
+     */
+    QByteArray data() const { return m_data; }
+
+    /**
+     * @brief The contents decoded, without the byte order mark.
+     */
+    QString text() const;
+
+private:
+    Q_DISABLE_COPY(MsvcInputFile)
+
+    void detectEncoding();
+
+    QFile m_file;
+    QByteArray m_data;
+    Encoding m_encoding = Ascii;
+    QByteArray m_declared;
+};
+
+/**
+ * @brief Splits a text in lines, like QIODevice::readLine() does.
+ */
+class MsvcLineReader
+{
+public:
+    explicit MsvcLineReader( QString const & text ) :
+        m_text( text )
+    {
+    }
+
+    /**
+     * @brief The next line, with its line terminator.
+     */
+    QString readLine();
+
+    bool atEnd() const { return m_position >= m_text.size(); }
+
+private:
+    QString m_text;
+    int m_position = 0;
+};
+
+#endif //MSVCINPUTFILE_H
@@ -0,0 +1,275 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/*
+ * Loads a solution the way the plugin does, without the GUI, so the parser
+ * can be timed and profiled (perf, valgrind, heaptrack...) on its own.
+ */
+
+#include "msvcimportjob.h"
+#include "msvcmodelitems.h"
+#include "msvcstatistics.h"
+#include "msvctrace.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QTextStream>
+
+#include <functional>
+
+#include <shell/core.h>
+#include <tests/autotestshell.h>
+#include <tests/testcore.h>
+#include <tests/testproject.h>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+
+QTextStream & out()
+{
+    static QTextStream stream( stdout );
+    return stream;
+}
+
+// Peak resident set size of the process in KiB, -1 if unknown
+qint64 peakRss()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if ( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof(counters) ) )
+        return qint64( counters.PeakWorkingSetSize / 1024 );
+    return -1;
+#elif defined(Q_OS_LINUX)
+    QFile status( QStringLiteral("/proc/self/status") );
+    if ( status.open( QIODevice::ReadOnly ) )
+    {
+        for ( const QByteArray & line : status.readAll().split('\n') )
+        {
+            if ( line.startsWith("VmHWM:") )
+                return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+        }
+    }
+    return -1;
+#else
+    struct rusage usage;
+    if ( getrusage( RUSAGE_SELF, &usage ) != 0 )
+        return -1;
+#if defined(Q_OS_MAC)
+    return usage.ru_maxrss / 1024; // bytes there
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+void dumpTree( KDevelop::ProjectBaseItem * item, int depth )
+{
+    QString kind;
+    if ( dynamic_cast<MsvcSolutionItem*>(item) )
+        kind = QStringLiteral("[solution] ");
+    else if ( MsvcProjectItem * proj = dynamic_cast<MsvcProjectItem*>(item) )
+        kind = QStringLiteral("[project %1] ").arg( proj->getCurrentConfig().configurationName );
+    else if ( dynamic_cast<MsvcFilterItem*>(item) )
+        kind = QStringLiteral("[filter] ");
+    else if ( item->target() )
+        kind = QStringLiteral("[target] ");
+
+    out() << QString( depth * 2, ' ' ) << kind << item->text() << '\n';
+
+    for ( KDevelop::ProjectBaseItem * child : item->children() )
+        dumpTree( child, depth + 1 );
+}
+
+void dumpConfigurations( MsvcSolutionItem * solution )
+{
+    out() << "Solution configurations: " << QStringList( solution->getConfigurations() ).join(", ") << '\n';
+
+    for ( MsvcProjectItem * proj : solution->projects() )
+    {
+        const MsvcProjectConfig config = proj->getCurrentConfig();
+
+        out() << proj->text() << ": " << proj->configurationNames().join(", ") << '\n'
+              << "  current:  " << config.configurationName << '|' << config.targetArchitecture << '\n'
+              << "  output:   " << proj->targetPath().pathOrUrl() << '\n'
+              << "  intdir:   " << proj->intermediatePath().pathOrUrl() << '\n'
+              << "  includes: " << proj->includeDirectories().size() << '\n'
+              << "  defines:  " << proj->defines().size() << '\n';
+    }
+}
+
+struct Timings
+{
+    qint64 min = -1;
+    qint64 max = 0;
+    qint64 total = 0;
+    int runs = 0;
+
+    void add( qint64 msecs )
+    {
+        min = min < 0 ? msecs : qMin( min, msecs );
+        max = qMax( max, msecs );
+        total += msecs;
+        ++runs;
+    }
+};
+
+}
+
+int main( int argc, char ** argv )
+{
+    QCoreApplication app( argc, argv );
+    app.setApplicationName( QStringLiteral("msvc-load-solution") );
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription( QStringLiteral("Loads a Visual Studio solution like the KDevelop MSVC plugin does.") );
+    parser.addHelpOption();
+    parser.addPositionalArgument( QStringLiteral("solution"), QStringLiteral("The .sln files to load together."),
+                                  QStringLiteral("solution...") );
+
+    const QCommandLineOption treeOption( QStringLiteral("dump-tree"), QStringLiteral("Print the project tree.") );
+    const QCommandLineOption configOption( QStringLiteral("dump-configs"), QStringLiteral("Print the configurations of every project.") );
+    const QCommandLineOption statsOption( QStringLiteral("stats"), QStringLiteral("Print the statistics report.") );
+    const QCommandLineOption repeatOption( QStringLiteral("repeat"), QStringLiteral("Load the solution <n> times."),
+                                           QStringLiteral("n"), QStringLiteral("1") );
+    const QCommandLineOption activeOption( QStringLiteral("config"), QStringLiteral("Solution configuration to activate, like Debug|Win32."),
+                                           QStringLiteral("name") );
+    const QCommandLineOption traceOption( QStringLiteral("trace"), QStringLiteral("Write a Chrome trace to <file>."),
+                                          QStringLiteral("file") );
+
+    parser.addOptions( { treeOption, configOption, statsOption, repeatOption, activeOption, traceOption } );
+    parser.process( app );
+
+    if ( parser.positionalArguments().isEmpty() )
+        parser.showHelp( 1 );
+
+    KDevelop::Path::List solutionFiles;
+    for ( const QString & argument : parser.positionalArguments() )
+    {
+        const QFileInfo solutionFile( argument );
+        if ( !solutionFile.isFile() )
+        {
+            QTextStream( stderr ) << "No such file: " << solutionFile.filePath() << '\n';
+            return 1;
+        }
+        solutionFiles << KDevelop::Path( solutionFile.absoluteFilePath() );
+    }
+
+    if ( parser.isSet( traceOption ) )
+        MsvcTrace::setOutputFile( parser.value( traceOption ) );
+
+    const int repeat = qMax( 1, parser.value( repeatOption ).toInt() );
+    const KDevelop::Path solutionPath = solutionFiles.front();
+
+    // No plugin is needed, we drive the parser ourselves
+    KDevelop::AutoTestShell::init( { QStringLiteral("none") } );
+    KDevelop::TestCore::initialize( KDevelop::Core::NoUi );
+
+    QMap<int, QPair<QString, Timings> > phases;
+    auto timed = [&phases]( int order, const char * name, std::function<void()> const & phase )
+    {
+        QElapsedTimer timer;
+        timer.start();
+        phase();
+
+        auto & entry = phases[order];
+        entry.first = QString::fromLatin1( name );
+        entry.second.add( timer.elapsed() );
+    };
+
+    for ( int run = 0; run < repeat; ++run )
+    {
+        KDevelop::TestProject * project = new KDevelop::TestProject( solutionPath.parent() );
+        MsvcSolutionItem * solution = new MsvcSolutionItem( project, solutionPath );
+        solution->setSolutionFiles( solutionFiles );
+        project->setProjectItem( solution );
+
+        timed( 0, "import", [solution]()
+               {
+                   MsvcImportSolutionJob * job = new MsvcImportSolutionJob( solution );
+                   job->exec();
+               } );
+
+        timed( 1, "configure", [&]()
+               {
+                   const QString config = parser.isSet( activeOption ) ?
+                                          parser.value( activeOption ) :
+                                          solution->getConfigurations().value( 0 );
+                   solution->setCurrentConfig( config );
+               } );
+
+        // What the language support asks for every file it parses
+        timed( 2, "resolve flags", [solution]()
+               {
+                   for ( MsvcProjectItem * proj : solution->projects() )
+                   {
+                       proj->includeDirectories();
+                       proj->defines();
+                       proj->extraArguments( proj->path() );
+                       proj->targetPath();
+                   }
+               } );
+
+        if ( run == 0 )
+        {
+            if ( parser.isSet( treeOption ) )
+                dumpTree( solution, 0 );
+            if ( parser.isSet( configOption ) )
+                dumpConfigurations( solution );
+        }
+
+        if ( run == repeat - 1 && parser.isSet( statsOption ) )
+        {
+            for ( const QString & line : MsvcStatistics::self().report( { solution } ) )
+                out() << line << '\n';
+        }
+
+        timed( 3, "close", [project]() { delete project; } );
+    }
+
+    out() << "Phase            min ms    avg ms    max ms   (" << repeat << " runs)\n";
+    for ( const auto & phase : phases )
+    {
+        const Timings & t = phase.second;
+        out() << phase.first.leftJustified( 14 )
+              << QString::number( t.min ).rightJustified( 10 )
+              << QString::number( t.total / t.runs ).rightJustified( 10 )
+              << QString::number( t.max ).rightJustified( 10 ) << '\n';
+    }
+
+    const qint64 rss = peakRss();
+    out() << "Peak RSS: " << ( rss >= 0 ? QString::number( rss ) + " KiB" : QStringLiteral("unknown") ) << '\n';
+    out().flush();
+
+    MsvcTrace::flush();
+
+    KDevelop::TestCore::shutdown();
+    return 0;
+}
@@ -19,32 +19,99 @@
  */
 
 #include "msvcmanager.h"
+#include "affectedfilesjob.h"
+#include "cleanjob.h"
+#include "statisticsjob.h"
 #include "msvcbuilder.h"
+#include "msvccompilecommands.h"
+#include "msvccompileflags.h"
 #include "msvcconfig.h"
+#include "msvcfileregistry.h"
 #include "msvcbuilderpreferences.h"
 #include "msvcimportjob.h"
 #include "msvcmodelitems.h"
+#include "msvcstatistics.h"
+#include "msvctoolchain.h"
+#include "msvctrace.h"
 #include "debug.h"
 
+#include <QAction>
+#include <QDBusConnection>
 #include <QDebug>
 #include <QDir>
 #include <QHash>
 #include <QMessageBox>
+#include <QPointer>
+#include <QTimer>
 
 #include <KConfigGroup>
+#include <KDirWatch>
+#include <KLocalizedString>
 #include <KPluginFactory>
 #include <KSharedConfig>
 
+#include <interfaces/context.h>
+#include <interfaces/contextmenuextension.h>
+#include <interfaces/icore.h>
+#include <interfaces/idocument.h>
+#include <interfaces/idocumentcontroller.h>
+#include <interfaces/ilanguagecontroller.h>
 #include <interfaces/iproject.h>
+#include <interfaces/iprojectcontroller.h>
+#include <interfaces/iruncontroller.h>
+#include <language/backgroundparser/backgroundparser.h>
+#include <language/duchain/topducontext.h>
 #include <project/projectmodel.h>
+#include <serialization/indexedstring.h>
 
 K_PLUGIN_FACTORY_WITH_JSON(MsvcSupportFactory, "kdevmsvcmanager.json", registerPlugin<MsvcProjectManager>();)
 
+namespace
+{
+
+// The filter below the project at @p projectPath reached through the filters called @p names
+MsvcFilterItem * findFilter( KDevelop::IProject * project, KDevelop::Path const & projectPath, QStringList const & names )
+{
+    KDevelop::ProjectBaseItem * item = dynamic_cast<MsvcProjectItem*>( MsvcSolutionItem::findBuildItem( project, projectPath ) );
+
+    for ( const QString & name : names )
+    {
+        KDevelop::ProjectBaseItem * next = nullptr;
+        for ( KDevelop::ProjectBaseItem * child : item ? item->children() : QList<KDevelop::ProjectBaseItem*>() )
+        {
+            if ( dynamic_cast<MsvcFilterItem*>( child ) && child->text() == name )
+            {
+                next = child;
+                break;
+            }
+        }
+        item = next;
+    }
+    return dynamic_cast<MsvcFilterItem*>( item );
+}
+
+}
+
 MsvcProjectManager::MsvcProjectManager(QObject * parent, const QVariantList &) :
     KDevelop::AbstractFileManagerPlugin("kdevmsvcmanager", parent),
-    m_builder( new MsvcBuilder() )
+    m_builder( new MsvcBuilder() ),
+    m_projectFiles( new KDirWatch( this ) ),
+    m_reloadTimer( new QTimer( this ) )
 {
     KDEV_USE_EXTENSION_INTERFACE(IBuildSystemManager)
+
+    QDBusConnection::sessionBus().registerObject( QStringLiteral("/org/kdevelop/MsvcManager"), this,
+                                                  QDBusConnection::ExportScriptableSlots );
+
+    connect( KDevelop::ICore::self()->documentController(), &KDevelop::IDocumentController::documentOpened,
+             this, &MsvcProjectManager::documentOpened );
+
+    connect( m_projectFiles, &KDirWatch::dirty, this, &MsvcProjectManager::projectFileChanged );
+    connect( m_projectFiles, &KDirWatch::created, this, &MsvcProjectManager::projectFileChanged );
+
+    m_reloadTimer->setSingleShot( true );
+    m_reloadTimer->setInterval( 500 );
+    connect( m_reloadTimer, &QTimer::timeout, this, &MsvcProjectManager::reloadChangedProjects );
 }
 
 KDevelop::ProjectFolderItem* MsvcProjectManager::import( KDevelop::IProject* project )
@@ -55,6 +122,7 @@ KDevelop::ProjectFolderItem* MsvcProjectManager::import( KDevelop::IProject* pro
     
     KDevelop::Path path( project->path(),
                          grp.readEntry("CreatedFrom", QString() ) );
+    KDevelop::Path::List solutions;
 
     // Might happen on windows
     if ( ! path.lastPathSegment().endsWith(".sln", Qt::CaseInsensitive) )
@@ -77,106 +145,319 @@ KDevelop::ProjectFolderItem* MsvcProjectManager::import( KDevelop::IProject* pro
             return nullptr;
         }
 
-        // FIXME: we just pick the first file here.
-
+        // All of them go in one item, the first one names it and is the one built
         path.setLastPathSegment( files.front().fileName() );
+        for ( const QFileInfo & file : files )
+            solutions << KDevelop::Path( file.absoluteFilePath() );
     }
 
     MsvcConfig::guessCompilerIfNotConfigured( project );
 
-    return new MsvcSolutionItem( project, path );
+    MsvcSolutionItem * solItem = new MsvcSolutionItem( project, path );
+    if ( solutions.size() > 1 )
+        solItem->setSolutionFiles( solutions );
+    return solItem;
 }
 
 KJob* MsvcProjectManager::createImportJob( KDevelop::ProjectFolderItem* item )
 {
+    if ( MsvcProjectItem * projItem = dynamic_cast<MsvcProjectItem*>(item) )
+    {
+        // Update the project in place instead of rebuilding it
+        MsvcReloadProjectJob * job = new MsvcReloadProjectJob(projItem);
+        connect( job, &KJob::result, this, [job]()
+                 {
+                     MsvcTrace::flush();
+                     reparse( job->changedFiles() );
+                 } );
+        return job;
+    }
+
     MsvcSolutionItem * solItem = dynamic_cast<MsvcSolutionItem*>(item);
     Q_ASSERT(solItem);
     
-    return new MsvcImportSolutionJob(solItem);
+    MsvcImportSolutionJob * job = new MsvcImportSolutionJob(solItem);
+    
+    KDevelop::IProject * project = item->project();
+    connect( job, &KJob::result, this, [this, project, solItem](KJob * job)
+             {
+                 MsvcTrace::flush();
+
+                 if ( job->error() )
+                     return;
+
+                 watchProjectFiles( solItem );
+                 MsvcCompileCommandsExporter::exportIfEnabled( project );
+             } );
+    
+    return job;
 }
 
-KDevelop::IProjectBuilder* MsvcProjectManager::builder() const
+void MsvcProjectManager::watchProjectFiles( MsvcSolutionItem * solItem )
 {
-    return m_builder;
+    for ( MsvcProjectItem * projItem : solItem->projects() )
+    {
+        const QString fileName = projItem->path().toLocalFile();
+        const QStringList watchedFiles = { fileName, fileName + QStringLiteral(".filters") };
+        for ( const QString & watched : watchedFiles )
+        {
+            if ( !m_projectFiles->contains( watched ) )
+                m_projectFiles->addFile( watched );
+        }
+    }
 }
 
-KDevelop::Path::List MsvcProjectManager::includeDirectories(KDevelop::ProjectBaseItem * item) const
+void MsvcProjectManager::projectFileChanged( QString const & fileName )
 {
-    KDevelop::Path::List result;
+    QString projectFile = fileName;
+    if ( projectFile.endsWith( QLatin1String(".filters"), Qt::CaseInsensitive ) )
+        projectFile.chop( 8 );
 
-    if (!item)
+    m_changedProjects.insert( KDevelop::Path( projectFile ) );
+    m_reloadTimer->start();
+}
+
+void MsvcProjectManager::reloadChangedProjects()
+{
+    const QSet<KDevelop::Path> changed = m_changedProjects;
+    m_changedProjects.clear();
+
+    for ( const KDevelop::Path & path : changed )
     {
-        return result;
+        MsvcProjectItem * found = nullptr;
+        for ( KDevelop::IProject * project : KDevelop::ICore::self()->projectController()->projects() )
+        {
+            found = dynamic_cast<MsvcProjectItem*>( MsvcSolutionItem::findBuildItem( project, path ) );
+            if ( found )
+                break;
+        }
+
+        if ( !found )
+        {
+            // Its solution was closed
+            m_projectFiles->removeFile( path.toLocalFile() );
+            m_projectFiles->removeFile( path.toLocalFile() + QStringLiteral(".filters") );
+            continue;
+        }
+
+        // Its result would be outdated anyway
+        if ( QPointer<KJob> running = m_reloadJobs.take( path ) )
+            running->kill( KJob::Quietly );
+
+        qCDebug(KDEV_MSVC) << path << "changed, updating" << found->text();
+        KJob * job = createImportJob( found );
+        m_reloadJobs.insert( path, job );
+        KDevelop::ICore::self()->runController()->registerJob( job );
     }
-   
-    KSharedConfigPtr cfg = item->project()->projectConfiguration();
-    KConfigGroup grp = cfg->group(MsvcConfig::CONFIG_GROUP);
-    
-    KDevelop::Path msIncludePath( grp.readEntry(MsvcConfig::MSVC_INCLUDE, QString() ) );
-    
-    if ( msIncludePath.isValid() || msIncludePath.isEmpty() )
+}
+
+void MsvcProjectManager::reparse( KDevelop::Path::List const & files )
+{
+    KDevelop::BackgroundParser * parser = KDevelop::ICore::self()->languageController()->backgroundParser();
+
+    const KDevelop::TopDUContext::Features features(
+        KDevelop::TopDUContext::VisibleDeclarationsAndContexts | KDevelop::TopDUContext::ForceUpdate );
+
+    for ( const KDevelop::Path & file : files )
+        parser->addDocument( KDevelop::IndexedString( file.pathOrUrl() ), features );
+}
+
+KDevelop::ContextMenuExtension MsvcProjectManager::contextMenuExtension( KDevelop::Context* context )
+{
+    KDevelop::ContextMenuExtension ext;
+
+    if ( context->type() != KDevelop::Context::ProjectItemContext )
+        return ext;
+
+    const QList<KDevelop::ProjectBaseItem*> items = static_cast<KDevelop::ProjectItemContext*>( context )->items();
+    if ( items.size() != 1 )
+        return ext;
+
+    KDevelop::ProjectBaseItem * item = items.front();
+
+    MsvcFilterItem * filter = dynamic_cast<MsvcFilterItem*>( item );
+    if ( !filter && dynamic_cast<MsvcPendingFilesItem*>( item ) )
+        filter = dynamic_cast<MsvcFilterItem*>( item->parent() );
+
+    if ( filter && filter->hasPendingFiles() )
     {
-        result.push_back( std::move(msIncludePath) );
+        // The model may be reloaded before the action is triggered, find the filter again then
+        QPointer<KDevelop::IProject> project = filter->project();
+        MsvcProjectItem * projItem = MsvcCompileFlags::owningProject( filter );
+        const KDevelop::Path projectPath = projItem ? projItem->path() : KDevelop::Path();
+        QStringList names;
+        for ( KDevelop::ProjectBaseItem * p = filter; p && p != projItem; p = p->parent() )
+            names.prepend( p->text() );
+
+        QAction * action = new QAction( i18np("Load %1 File", "Load %1 Files", filter->pendingFileCount()), this );
+        connect( action, &QAction::triggered, this, [project, projectPath, names]()
+                 {
+                     if ( MsvcFilterItem * filter = findFilter( project, projectPath, names ) )
+                         filter->loadFiles();
+                 } );
+        ext.addAction( KDevelop::ContextMenuExtension::ExtensionGroup, action );
+        return ext;
     }
-    
-    KDevelop::Path winSdkIncludePath( grp.readEntry(MsvcConfig::WINSDK_INCLUDE, QString() ) );
-    
-    if ( winSdkIncludePath.isValid() || winSdkIncludePath.isEmpty() )
+
+    if ( dynamic_cast<MsvcProjectItem*>( item ) || dynamic_cast<MsvcSolutionItem*>( item ) )
     {
-        result.push_back( std::move(winSdkIncludePath) );
+        // The model may be reloaded before the action is triggered, look the item up again then
+        QPointer<KDevelop::IProject> project = item->project();
+        const KDevelop::Path path = item->path();
+
+        QAction * action = new QAction( i18n("Show Files Clean Would Remove"), this );
+        connect( action, &QAction::triggered, this, [project, path]()
+                 {
+                     if ( KDevelop::ProjectBuildFolderItem * folder = MsvcSolutionItem::findBuildItem( project, path ) )
+                         KDevelop::ICore::self()->runController()->registerJob( new CleanJob( nullptr, folder, true ) );
+                 } );
+        ext.addAction( KDevelop::ContextMenuExtension::BuildGroup, action );
+
+        if ( MsvcProjectItem * projItem = dynamic_cast<MsvcProjectItem*>( item ) )
+        {
+            const QString name = projItem->text();
+
+            QAction * startupAction = new QAction( i18n("Set as Startup Project"), this );
+            startupAction->setCheckable( true );
+            startupAction->setChecked( MsvcConfig::startupProject( project ) == name );
+            connect( startupAction, &QAction::triggered, this, [project, name]( bool checked )
+                     {
+                         if ( project )
+                             MsvcConfig::setStartupProject( project, checked ? name : QString() );
+                     } );
+            ext.addAction( KDevelop::ContextMenuExtension::ExtensionGroup, startupAction );
+        }
+
+        if ( dynamic_cast<MsvcSolutionItem*>( item ) )
+        {
+            QAction * statsAction = new QAction( i18n("MSVC Statistics"), this );
+            connect( statsAction, &QAction::triggered, this, [project]()
+                     {
+                         MsvcSolutionItem * solItem = project ? dynamic_cast<MsvcSolutionItem*>( project->projectItem() ) : nullptr;
+                         if ( !solItem )
+                             return;
+
+                         const QStringList report = MsvcStatistics::self().report( { solItem } );
+                         KDevelop::ICore::self()->runController()->registerJob( new StatisticsJob( nullptr, report ) );
+                     } );
+            ext.addAction( KDevelop::ContextMenuExtension::ExtensionGroup, statsAction );
+        }
+        return ext;
     }
-   
-    for ( KDevelop::ProjectBaseItem * p = item; p; p = p->parent() )
+
+    KDevelop::ProjectFileItem * file = items.front()->file();
+    if ( !file || MsvcCompileFlags::isCompilable( file->path() ) || !MsvcCompileFlags::owningProject( file ) )
+        return ext;
+
+    KDevelop::IProject * project = file->project();
+    const KDevelop::Path header = file->path();
+
+    QAction * action = new QAction( i18n("Show Files Including %1", header.lastPathSegment()), this );
+    connect( action, &QAction::triggered, this, [project, header]()
+             {
+                 KDevelop::ICore::self()->runController()->registerJob( new AffectedFilesJob( nullptr, project, header ) );
+             } );
+    ext.addAction( KDevelop::ContextMenuExtension::ExtensionGroup, action );
+
+    return ext;
+}
+
+QString MsvcProjectManager::statistics() const
+{
+    QList<MsvcSolutionItem*> solutions;
+    for ( KDevelop::IProject * project : KDevelop::ICore::self()->projectController()->projects() )
+    {
+        if ( MsvcSolutionItem * solItem = dynamic_cast<MsvcSolutionItem*>( project->projectItem() ) )
+            solutions << solItem;
+    }
+
+    return MsvcStatistics::self().report( solutions ).join('\n');
+}
+
+void MsvcProjectManager::documentOpened( KDevelop::IDocument * document )
+{
+    const KDevelop::Path path( document->url() );
+
+    for ( KDevelop::IProject * project : KDevelop::ICore::self()->projectController()->projects() )
     {
-        if ( MsvcProjectItem * projItem = dynamic_cast<MsvcProjectItem*>(p) )
+        MsvcSolutionItem * solItem = dynamic_cast<MsvcSolutionItem*>( project->projectItem() );
+        if ( !solItem )
+            continue;
+
+        const QList<MsvcProjectItem*> owners = solItem->fileRegistry()->projectsContaining( path );
+        for ( MsvcProjectItem * projItem : owners )
         {
-            const QUrl projectPath = projItem->path().parent().toUrl();
-            QStringList includes = projItem->getCurrentConfig().additionalIncludeDirectories;
-            
-            MsvcVariableReplacer replacer; 
-            
-            for (QString const & s : replacer.replace(includes, projItem) )
-            {
-                QUrl url = QUrl::fromUserInput(s);
-                
-                // Relative paths are relative to the project path.
-                if ( url.isRelative() )
-                    url = projectPath.resolved(url);
-
-                if ( url.isValid() )
-                    result << KDevelop::Path(url);
-                else
-                {
-                    qCWarning(KDEV_MSVC) << "Invalid include path:" << s;
-                }
-            }
-            break;
+            if ( MsvcFilterItem * filter = projItem->pendingFilterFor( path ) )
+                filter->loadFiles();
         }
+
+        // Parsed first the next time the solution is opened. A header shared
+        // by many projects would otherwise push every one of them to the front.
+        if ( !owners.isEmpty() )
+            MsvcConfig::addRecentProject( project, owners.front()->text() );
+    }
+}
+
+KDevelop::IProjectBuilder* MsvcProjectManager::builder() const
+{
+    return m_builder;
+}
+
+KDevelop::Path::List MsvcProjectManager::includeDirectories(KDevelop::ProjectBaseItem * item) const
+{
+    if (!item)
+    {
+        return {};
+    }
+   
+    if ( MsvcProjectItem * projItem = MsvcCompileFlags::owningProject(item) )
+    {
+        return projItem->includeDirectories();
     }
    
+    // Not in a project, we only know about the toolchain
+    const MsvcToolchain::Profile toolchain = MsvcToolchain::self().profile( item->project() );
+    
+    KDevelop::Path::List result;
+    for ( const KDevelop::Path & p : { toolchain.msvcInclude, toolchain.winSdkInclude } )
+    {
+        if ( p.isValid() )
+            result.push_back( p );
+    }
     return result;
 }
 
 QHash<QString,QString> MsvcProjectManager::defines(KDevelop::ProjectBaseItem* item) const
 {
-    //TODO compiler-injected defines
-    
     if (!item)
     {
         return {};
     }
 
-    for ( KDevelop::ProjectBaseItem * p = item; p; p = p->parent() )
+    if ( MsvcProjectItem * projItem = MsvcCompileFlags::owningProject(item) )
     {
-        if ( MsvcProjectItem * projItem = dynamic_cast<MsvcProjectItem*>(p) )
-        {
-            return projItem->getCurrentConfig().preprocessorDefines;
-        }
+        return projItem->defines();
     }
     
     return {};
 }
 
+QString MsvcProjectManager::extraArguments(KDevelop::ProjectBaseItem* item) const
+{
+    if (!item)
+    {
+        return {};
+    }
+
+    // Forced includes, undefines and the language switches cl would get for this file
+    if ( MsvcProjectItem * projItem = MsvcCompileFlags::owningProject(item) )
+    {
+        return projItem->extraArguments( item->path() );
+    }
+
+    return {};
+}
+
 bool MsvcProjectManager::hasIncludesOrDefines(KDevelop::ProjectBaseItem* item) const
 {
     return true;
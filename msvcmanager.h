@@ -21,15 +21,31 @@
 #ifndef MSVCMANAGER_H
 #define MSVCMANAGER_H
 
+#include <QHash>
+#include <QPointer>
+#include <QSet>
+
 #include <project/abstractfilemanagerplugin.h>
 #include <project/interfaces/ibuildsystemmanager.h>
 
+#include <kdevplatform/util/path.h>
+
+class KDirWatch;
+class KJob;
+class QTimer;
 class MsvcBuilder;
+class MsvcSolutionItem;
+
+namespace KDevelop
+{
+class IDocument;
+}
 
 class MsvcProjectManager : public KDevelop::AbstractFileManagerPlugin, public KDevelop::IBuildSystemManager
 {
     Q_OBJECT
     Q_INTERFACES( KDevelop::IBuildSystemManager )
+    Q_CLASSINFO( "D-Bus Interface", "org.kdevelop.MsvcManager" )
 
 public:
     
@@ -40,12 +56,44 @@ public:
     KJob* createImportJob( KDevelop::ProjectFolderItem* item) override;
     //END AbstractFileManager
 
+    KDevelop::ContextMenuExtension contextMenuExtension( KDevelop::Context* context ) override;
+
+public Q_SLOTS:
+    /**
+     * @brief The MsvcStatistics report of the open solutions, also exported on D-Bus:
+     * qdbus org.kde.kdevelop-<pid> /org/kdevelop/MsvcManager statistics
+     */
+    Q_SCRIPTABLE QString statistics() const;
+
+private Q_SLOTS:
+    /**
+     * @brief Load the unloaded files of the filter holding @p document and
+     * remember its projects as recently used.
+     */
+    void documentOpened( KDevelop::IDocument * document );
+
+    /**
+     * @brief A .vcxproj, .vcproj or .filters file changed, update its project
+     * once the file has been quiet for a moment.
+     */
+    void projectFileChanged( QString const & fileName );
+
+    /**
+     * @brief Reload the projects changed since the last time, a reload
+     * still running for one of them is cancelled.
+     */
+    void reloadChangedProjects();
+
+public:
+
     //BEGIN IBuildSystemManager
     KDevelop::IProjectBuilder*  builder() const override;
 
     KDevelop::Path::List includeDirectories(KDevelop::ProjectBaseItem*) const override;
     
     QHash<QString,QString> defines(KDevelop::ProjectBaseItem*) const override;
+
+    QString extraArguments(KDevelop::ProjectBaseItem*) const override;
     
     bool hasIncludesOrDefines(KDevelop::ProjectBaseItem* item) const override;
     
@@ -86,7 +134,23 @@ public:
     //END IBuildSystemManager
 
 private:
+    /**
+     * @brief Watch the files of the projects of @p solItem.
+     */
+    void watchProjectFiles( MsvcSolutionItem * solItem );
+
+    /**
+     * @brief Parse @p files again, their flags or their project changed.
+     */
+    static void reparse( KDevelop::Path::List const & files );
+
     MsvcBuilder * m_builder = 0;
+    KDirWatch * m_projectFiles;
+
+    // Saving from Visual Studio touches the project and its filters, several times
+    QTimer * m_reloadTimer;
+    QSet<KDevelop::Path> m_changedProjects;
+    QHash< KDevelop::Path, QPointer<KJob> > m_reloadJobs;
 };
 
 #endif //MSVCMANAGER_H
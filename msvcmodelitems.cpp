@@ -19,12 +19,39 @@
  */
 
 #include "msvcmodelitems.h"
+#include "msvccompileflags.h"
+#include "msvcdirectorycache.h"
+#include "msvcfileregistry.h"
+#include "msvcparsecache.h"
+#include "msvcprojectdata.h"
+#include "msvcprojectgraph.h"
+#include "msvcstatistics.h"
+#include "msvctoolchain.h"
+#include "msvctrace.h"
 #include "debug.h"
 
+#include <QDir>
 #include <QRegularExpression>
 
+#include <KLocalizedString>
+#include <KShell>
+
+#include <algorithm>
+
+#include <interfaces/iproject.h>
 #include <project/projectmodel.h>
 
+namespace
+{
+
+// File items are sorted by name, case insensitively
+bool pendingLessThan( QStringRef const & a, QStringRef const & b )
+{
+    return a.compare( b, Qt::CaseInsensitive ) < 0;
+}
+
+}
+
 bool MsvcFilterItem::lessThan(const KDevelop::ProjectBaseItem* item) const
 {
     if ( item->type() > CustomProjectItemType )
@@ -41,28 +68,104 @@ QString MsvcFilterItem::iconName() const
     return QStringLiteral("filter");
 }
 
-QUrl MsvcExecutableTargetItem::builtUrl() const
+void MsvcFilterItem::setPendingFiles( std::shared_ptr<const MsvcProjectData> data, QVector<int> const & files )
 {
-    // Walk up and find our project parent (should be the first one)
-    KDevelop::ProjectBaseItem * p = parent();
-    while ( p && !dynamic_cast<MsvcProjectItem*>(p) )
-        p = p->parent();
-   
-    if (!p)
+    if ( placeholder_ )
     {
-        // Bail out
-        return QUrl();
+        removeRow( placeholder_->row() );
+        placeholder_ = nullptr;
     }
-    
-    Q_ASSERT( dynamic_cast<MsvcProjectItem*>(p) );
-   
-    MsvcProjectItem * proj = static_cast<MsvcProjectItem*>(p);
-    
-    MsvcVariableReplacer replacer;
-    QString outputFilePath = replacer.replace( proj->getCurrentConfig().outputFile,
-                                               proj ).replace('\\', '/');
+    pending_files_.clear();
+    data_.reset();
+
+    if ( files.isEmpty() )
+        return;
+
+    pending_files_.reserve( files.size() );
+    for ( int file : files )
+    {
+        const PendingFile pending = { data->fileName( file ), file };
+        pending_files_.append( pending );
+    }
+
+    // Same order as ProjectBaseItem::lessThan() gives file items, so loadFiles()
+    // appends them where the model sorts them anyway
+    std::sort( pending_files_.begin(), pending_files_.end(),
+               []( PendingFile const & a, PendingFile const & b ) { return pendingLessThan( a.name, b.name ); } );
+
+    data_ = std::move( data );
+    placeholder_ = new MsvcPendingFilesItem( project(), pending_files_.size(), this );
+}
+
+KDevelop::Path::List MsvcFilterItem::pendingFilePaths() const
+{
+    KDevelop::Path::List result;
+    result.reserve( pending_files_.size() );
+    for ( const PendingFile & pending : pending_files_ )
+        result.append( data_->filePath( pending.file ) );
+    return result;
+}
+
+bool MsvcFilterItem::hasPendingFile( KDevelop::Path const & path ) const
+{
+    const QString name = path.lastPathSegment();
+
+    const QStringRef key( &name );
+
+    // Only the files with the same name need a full comparison
+    auto first = std::lower_bound( pending_files_.begin(), pending_files_.end(), key,
+                                   []( PendingFile const & a, QStringRef const & b ) { return pendingLessThan( a.name, b ); } );
+
+    const QString localFile = path.toLocalFile();
+    for ( auto it = first; it != pending_files_.end() && it->name.compare( key, Qt::CaseInsensitive ) == 0; ++it )
+    {
+        if ( data_->filePath( it->file ).toLocalFile().compare( localFile, Qt::CaseInsensitive ) == 0 )
+            return true;
+    }
+    return false;
+}
+
+void MsvcFilterItem::loadFiles()
+{
+    if ( !hasPendingFiles() )
+        return;
+
+    MSVC_TRACE_SPAN_DETAIL( "load filter", text() );
+
+    removeRow( placeholder_->row() );
+    placeholder_ = nullptr;
+
+    MsvcProjectItem * proj = MsvcCompileFlags::owningProject( this );
+    std::shared_ptr<MsvcFileRegistry> files = proj ? proj->fileRegistry() : nullptr;
+
+    for ( const PendingFile & pending : pending_files_ )
+    {
+        const KDevelop::Path path = data_->filePath( pending.file );
+        new KDevelop::ProjectFileItem( project(), files ? files->canonical( path ) : path, this );
+    }
+
+    pending_files_ = {};
+    data_.reset();
+}
+
+MsvcPendingFilesItem::MsvcPendingFilesItem( KDevelop::IProject * project, int count, MsvcFilterItem * parent ) :
+    KDevelop::ProjectBaseItem( project, i18np("%1 file not loaded", "%1 files not loaded", count), parent )
+{
+}
+
+QString MsvcPendingFilesItem::iconName() const
+{
+    return QStringLiteral("document-multiple");
+}
+
+QUrl MsvcExecutableTargetItem::builtUrl() const
+{
+    // Targets are created right below their project
+    MsvcProjectItem * proj = dynamic_cast<MsvcProjectItem*>( parent() );
+    if ( !proj )
+        proj = MsvcCompileFlags::owningProject( parent() );
 
-    return QUrl( outputFilePath );
+    return proj ? proj->targetPath().toUrl() : QUrl();
 }
 
 MsvcProjectItem::MsvcProjectItem( KDevelop::IProject* project,
@@ -73,6 +176,12 @@ MsvcProjectItem::MsvcProjectItem( KDevelop::IProject* project,
     setText( path.lastPathSegment().section('.', 0, -2) );
 }
 
+MsvcProjectItem::~MsvcProjectItem()
+{
+    if ( files_ )
+        files_->removeProject( this );
+}
+
 bool MsvcProjectItem::lessThan(const KDevelop::ProjectBaseItem* item) const
 {
     if ( item->type() > CustomProjectItemType )
@@ -84,39 +193,250 @@ bool MsvcProjectItem::lessThan(const KDevelop::ProjectBaseItem* item) const
     return KDevelop::ProjectBaseItem::lessThan(item);
 }
 
-void MsvcProjectItem::addConfiguration(const MsvcProjectConfig & config)
+bool MsvcProjectItem::setCurrentConfiguration(const QString& configFullName)
 {
-    QString configFullName = config.configurationName + "|" + config.targetArchitecture;
-    configurations_.insert( configFullName, config );
-    
-    if ( current_config_.isEmpty() )
+    QMutexLocker lock( &cache_mutex_ );
+
+    if ( findConfiguration( configFullName ) )
     {
-        current_config_ = configFullName;
+        if ( current_config_ != configFullName )
+        {
+            current_config_ = configFullName;
+            clearCaches();
+        }
+        return true;
     }
+    return false;
 }
 
-bool MsvcProjectItem::setCurrentConfiguration(const QString& configFullName)
+void MsvcProjectItem::setProjectData( std::shared_ptr<const MsvcProjectData> data )
 {
-    if ( configurations_.contains( configFullName ) )
+    QMutexLocker lock( &cache_mutex_ );
+
+    data_ = std::move( data );
+
+    // Keep the current configuration if it is still there, else take the first one
+    if ( !findConfiguration( current_config_ ) )
     {
-        current_config_ = configFullName;
-        return true;
+        current_config_.clear();
+        if ( data_ && !data_->configurations().isEmpty() )
+            current_config_ = fullName( data_->configurations().first() );
     }
-    return false;
+    clearCaches();
+}
+
+std::shared_ptr<const MsvcProjectData> MsvcProjectItem::projectData() const
+{
+    QMutexLocker lock( &cache_mutex_ );
+    return data_;
 }
 
 MsvcProjectConfig MsvcProjectItem::getCurrentConfig() const
 {
-    return configurations_.value( current_config_ );
+    QMutexLocker lock( &cache_mutex_ );
+    const MsvcProjectConfig * config = findConfiguration( current_config_ );
+    return config ? *config : MsvcProjectConfig();
+}
+
+QStringList MsvcProjectItem::configurationNames() const
+{
+    QMutexLocker lock( &cache_mutex_ );
+
+    QStringList result;
+    if ( data_ )
+    {
+        for ( const MsvcProjectConfig & config : data_->configurations() )
+            result << fullName( config );
+    }
+    return result;
+}
+
+QString MsvcProjectItem::fullName( MsvcProjectConfig const & config )
+{
+    return config.configurationName + "|" + config.targetArchitecture;
+}
+
+const MsvcProjectConfig * MsvcProjectItem::findConfiguration( QString const & fullname ) const
+{
+    if ( !data_ || fullname.isEmpty() )
+        return nullptr;
+
+    for ( const MsvcProjectConfig & config : data_->configurations() )
+    {
+        if ( fullName( config ) == fullname )
+            return &config;
+    }
+    return nullptr;
+}
+
+KDevelop::Path::List MsvcProjectItem::includeDirectories() const
+{
+    KDevelop::Path::List result;
+    const bool hit = updateFlagsCache( &result, nullptr );
+    MsvcStatistics::self().cacheAccess( MsvcStatistics::IncludeCache, hit );
+    return result;
+}
+
+QHash<QString,QString> MsvcProjectItem::defines() const
+{
+    QHash<QString,QString> result;
+    const bool hit = updateFlagsCache( nullptr, &result );
+    MsvcStatistics::self().cacheAccess( MsvcStatistics::DefineCache, hit );
+    return result;
+}
+
+QString MsvcProjectItem::extraArguments( KDevelop::Path const & source ) const
+{
+    updateFlagsCache( nullptr, nullptr );
+
+    bool c;
+    quint64 stamp;
+    {
+        QMutexLocker lock( &cache_mutex_ );
+        c = MsvcCompileFlags::isC( source, compile_as_ );
+        auto it = extra_cache_.constFind( c );
+        if ( it != extra_cache_.constEnd() )
+            return *it;
+        stamp = cache_stamp_;
+    }
+
+    const QString arguments = KShell::joinArgs( MsvcCompileFlags( this ).parserArguments( source ) );
+
+    // Computed from a configuration that was replaced meanwhile, do not keep it
+    QMutexLocker lock( &cache_mutex_ );
+    if ( stamp == cache_stamp_ )
+        extra_cache_.insert( c, arguments );
+    return arguments;
+}
+
+bool MsvcProjectItem::updateFlagsCache( KDevelop::Path::List * includes, QHash<QString,QString> * defines ) const
+{
+    const int generation = MsvcToolchain::self().generation();
+    quint64 stamp;
+    {
+        QMutexLocker lock( &cache_mutex_ );
+        if ( flags_generation_ == generation )
+        {
+            if ( includes )
+                *includes = include_cache_;
+            if ( defines )
+                *defines = define_cache_;
+            return true;
+        }
+        stamp = cache_stamp_;
+    }
+
+    // Not under the lock, the replacer uses the expansion cache
+    const MsvcCompileFlags flags( this );
+    const KDevelop::Path::List includeDirs = flags.includeDirectories();
+    const QHash<QString,QString> defs = flags.defines();
+
+    if ( includes )
+        *includes = includeDirs;
+    if ( defines )
+        *defines = defs;
+
+    // clearCaches() ran meanwhile, the result may be from the old configuration
+    QMutexLocker lock( &cache_mutex_ );
+    if ( stamp == cache_stamp_ )
+    {
+        include_cache_ = includeDirs;
+        define_cache_ = defs;
+        compile_as_ = flags.config().compileAs;
+        extra_cache_.clear();
+        flags_generation_ = generation;
+    }
+    return false;
+}
+
+bool MsvcProjectItem::cachedExpansion( QString const & s, QString & result, quint64 & stamp ) const
+{
+    const int generation = MsvcToolchain::self().generation();
+
+    QMutexLocker lock( &cache_mutex_ );
+
+    // The toolchain changed, so did $(VCInstallDir) and friends
+    if ( expansion_generation_ != generation )
+    {
+        expansion_cache_.clear();
+        expansion_generation_ = generation;
+    }
+
+    auto it = expansion_cache_.constFind( s );
+    const bool hit = it != expansion_cache_.constEnd();
+    MsvcStatistics::self().cacheAccess( MsvcStatistics::VariableCache, hit );
+
+    if ( hit )
+        result = *it;
+    stamp = cache_stamp_;
+    return hit;
+}
+
+void MsvcProjectItem::cacheExpansion( QString const & s, QString const & result, quint64 stamp ) const
+{
+    QMutexLocker lock( &cache_mutex_ );
+    if ( stamp == cache_stamp_ && expansion_generation_ == MsvcToolchain::self().generation() )
+        expansion_cache_.insert( s, result );
+}
+
+void MsvcProjectItem::clearCaches()
+{
+    ++cache_stamp_;
+    flags_generation_ = -1;
+    include_cache_.clear();
+    define_cache_.clear();
+    extra_cache_.clear();
+    expansion_cache_.clear();
+}
+
+KDevelop::Path MsvcProjectItem::resolvePath( QString filePath ) const
+{
+    filePath.replace('\\', '/');
+
+    if ( QDir::isAbsolutePath(filePath) )
+        return KDevelop::Path( filePath );
+
+    return KDevelop::Path( path().parent(), filePath );
+}
+
+KDevelop::Path MsvcProjectItem::targetPath() const
+{
+    const QString outputFile = getCurrentConfig().outputFile;
+
+    if ( outputFile.isEmpty() )
+        return KDevelop::Path();
+
+    MsvcVariableReplacer replacer;
+    return resolvePath( replacer.replace( outputFile, this ) );
+}
+
+KDevelop::Path MsvcProjectItem::intermediatePath() const
+{
+    const QString intDir = getCurrentConfig().intermediateDirectory;
+
+    if ( intDir.isEmpty() )
+        return KDevelop::Path();
+
+    MsvcVariableReplacer replacer;
+    return resolvePath( replacer.replace( intDir, this ) );
 }
 
 MsvcSolutionItem::MsvcSolutionItem(KDevelop::IProject* project,
                                    const KDevelop::Path& path,
                                    KDevelop::ProjectBaseItem* parent ) :
-    KDevelop::ProjectBuildFolderItem( project, path, parent )
+    KDevelop::ProjectBuildFolderItem( project, path, parent ),
+    files_( std::make_shared<MsvcFileRegistry>() ),
+    directories_( std::make_shared<MsvcDirectoryCache>() ),
+    parses_( MsvcParseCache::instance() )
 {
 }
 
+MsvcSolutionItem::~MsvcSolutionItem()
+{
+    // The projects go away with us, no need to unregister them one by one
+    files_->clear();
+}
+
 bool MsvcSolutionItem::lessThan(const KDevelop::ProjectBaseItem* item) const
 {
     if ( item->type() > CustomProjectItemType )
@@ -141,6 +461,71 @@ void MsvcSolutionItem::setCurrentConfig(const QString & config)
     }
 }
 
+MsvcFilterItem * MsvcProjectItem::pendingFilterFor( KDevelop::Path const & path ) const
+{
+    QList<KDevelop::ProjectBaseItem*> items = children();
+    while ( !items.isEmpty() )
+    {
+        MsvcFilterItem * filter = dynamic_cast<MsvcFilterItem*>( items.takeLast() );
+        if ( !filter )
+            continue;
+
+        if ( filter->hasPendingFile( path ) )
+            return filter;
+        items << filter->children();
+    }
+    return nullptr;
+}
+
+QList<MsvcProjectItem*> MsvcSolutionItem::projects() const
+{
+    QList<MsvcProjectItem*> result;
+    for (const auto & x : children() )
+    {
+        if ( auto * proj = dynamic_cast<MsvcProjectItem*>(x) )
+            result << proj;
+    }
+    return result;
+}
+
+KDevelop::ProjectBuildFolderItem * MsvcSolutionItem::findBuildItem( KDevelop::IProject * project, KDevelop::Path const & path )
+{
+    MsvcSolutionItem * solItem = project ? dynamic_cast<MsvcSolutionItem*>( project->projectItem() ) : nullptr;
+    if ( !solItem )
+        return nullptr;
+
+    if ( solItem->path() == path )
+        return solItem;
+
+    for ( MsvcProjectItem * projItem : solItem->projects() )
+    {
+        if ( projItem->path() == path )
+            return projItem;
+    }
+    return nullptr;
+}
+
+KDevelop::Path::List MsvcSolutionItem::solutionFiles() const
+{
+    if ( solutions_.isEmpty() )
+        return { path() };
+    return solutions_;
+}
+
+void MsvcSolutionItem::setProjectDependencies( QHash< QUuid, QList<QUuid> > const & dependencies )
+{
+    dependencies_ = dependencies;
+    graph_.reset();
+}
+
+std::shared_ptr<const MsvcProjectGraph> MsvcSolutionItem::dependencyGraph() const
+{
+    const QList<MsvcProjectItem*> current = projects();
+    if ( !graph_ || !graph_->isBuiltFrom( current ) )
+        graph_ = std::make_shared<MsvcProjectGraph>( current, dependencies_ );
+    return graph_;
+}
+
 MsvcProjectItem* MsvcSolutionItem::findProjectByUuid(const QUuid & uuid) const
 {
     for (const auto & x : children() )
@@ -157,6 +542,19 @@ MsvcProjectItem* MsvcSolutionItem::findProjectByUuid(const QUuid & uuid) const
 QString MsvcVariableReplacer::replace( QString s, KDevelop::ProjectBaseItem const * item )
 {
     static QRegularExpression regex(R"(\$\(([a-zA-Z0-9]+)\))");
+
+    // Too small and too frequent for a span, the span would cost more than the expansion
+    MsvcTrace::count( "variable expansions" );
+
+    const MsvcProjectItem * projItem = depth_ == 0 ? dynamic_cast<const MsvcProjectItem*>(item) : nullptr;
+
+    QString cached;
+    quint64 stamp = 0;
+    if ( projItem && projItem->cachedExpansion( s, cached, stamp ) )
+        return cached;
+
+    const QString original = s;
+    ++depth_;
     
     //FIXME this is not very efficient
     QRegularExpressionMatchIterator i;
@@ -167,6 +565,11 @@ QString MsvcVariableReplacer::replace( QString s, KDevelop::ProjectBaseItem cons
                    m.capturedLength(),
                    getReplacement(m.captured(1), item) );
     }
+
+    --depth_;
+
+    if ( projItem )
+        projItem->cacheExpansion( original, s, stamp );
     
     return s;
 }
@@ -248,6 +651,34 @@ QString MsvcVariableReplacer::visit( QString const & key, MsvcProjectItem const
     {
         return visit( "InputExt", static_cast<KDevelop::ProjectBaseItem const *>(item) );
     }
+    else if ( key.compare("ConfigurationName", Qt::CaseInsensitive) == 0 ||
+              key.compare("Configuration", Qt::CaseInsensitive) == 0 )
+    {
+        return item->getCurrentConfig().configurationName;
+    }
+    else if ( key.compare("PlatformName", Qt::CaseInsensitive) == 0 ||
+              key.compare("Platform", Qt::CaseInsensitive) == 0 )
+    {
+        return item->getCurrentConfig().targetArchitecture;
+    }
+    else if ( key.compare("OutDir", Qt::CaseInsensitive) == 0 )
+    {
+        recursionChecker checker( replace_out_dir_guard_ );
+        
+        if ( checker.stop() )
+            return QString();
+
+        return replace( item->getCurrentConfig().outputDirectory, item );
+    }
+    else if ( key.compare("IntDir", Qt::CaseInsensitive) == 0 )
+    {
+        recursionChecker checker( replace_int_dir_guard_ );
+        
+        if ( checker.stop() )
+            return QString();
+
+        return replace( item->getCurrentConfig().intermediateDirectory, item );
+    }
     else if ( key.compare("TargetDir", Qt::CaseInsensitive) == 0 )
     {
         recursionChecker checker( replace_target_dir_guard_ );
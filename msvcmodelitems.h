@@ -21,13 +21,25 @@
 #ifndef MSVCMODELITEMS_H
 #define MSVCMODELITEMS_H
 
+#include <QHash>
+#include <QMutex>
 #include <QUuid>
+#include <QVector>
 
 #include <project/projectmodel.h>
 #include <kdevplatform/util/path.h>
 
+#include <memory>
+
 #include "msvcprojectconfig.h"
 
+class MsvcDirectoryCache;
+class MsvcFileRegistry;
+class MsvcParseCache;
+class MsvcProjectGraph;
+class MsvcPendingFilesItem;
+class MsvcProjectData;
+
 class MsvcFilterItem : public KDevelop::ProjectBaseItem
 {
 public:
@@ -43,6 +55,62 @@ public:
     {
         return ProjectManagerRenameFailed;
     }
+
+    /**
+     * @brief Keep @p files of @p data as unloaded children.
+     * Crowded filters hold their files like this, the items are only
+     * created by loadFiles(). A placeholder item shows how many there are.
+     * Replaces the files pending before, if any.
+     *
+     * Having no item, unloaded files are not in Quick Open and not
+     * IProject::inProject(), only the plugin itself (file registry,
+     * builders, statistics) knows them.
+     */
+    void setPendingFiles( std::shared_ptr<const MsvcProjectData> data, QVector<int> const & files );
+
+    bool hasPendingFiles() const { return !pending_files_.isEmpty(); }
+    int pendingFileCount() const { return pending_files_.size(); }
+
+    KDevelop::Path::List pendingFilePaths() const;
+
+    /**
+     * @brief Whether @p path is among the unloaded files, compared case insensitively like Windows does.
+     */
+    bool hasPendingFile( KDevelop::Path const & path ) const;
+
+    /**
+     * @brief Create the items of the pending files, must run in the main thread
+     * once the filter is in the model.
+     */
+    void loadFiles();
+
+private:
+    struct PendingFile
+    {
+        QStringRef name;  // sort key, the file name in the data's string pool,
+                          // ordered like the file items are in the model
+        int file;
+    };
+
+    std::shared_ptr<const MsvcProjectData> data_;
+    QVector<PendingFile> pending_files_;  // sorted by name
+    MsvcPendingFilesItem * placeholder_ = nullptr;
+};
+
+/**
+ * @brief Stands for the files of a filter that are not loaded yet.
+ */
+class MsvcPendingFilesItem : public KDevelop::ProjectBaseItem
+{
+public:
+    MsvcPendingFilesItem( KDevelop::IProject * project, int count, MsvcFilterItem * parent );
+
+    QString iconName() const override;
+
+    RenameStatus rename(const QString &) override
+    {
+        return ProjectManagerRenameFailed;
+    }
 };
 
 class MsvcExecutableTargetItem : public KDevelop::ProjectExecutableTargetItem
@@ -62,6 +130,7 @@ public:
     MsvcProjectItem( KDevelop::IProject* , 
                      const KDevelop::Path& path,
                      ProjectBaseItem* parent = nullptr );
+    ~MsvcProjectItem() override;
     
     bool lessThan( const KDevelop::ProjectBaseItem* item ) const override;
     
@@ -70,10 +139,14 @@ public:
         return KDevelop::ProjectBaseItem::rename(newName);
     }
     
-    void addConfiguration( MsvcProjectConfig const & );
     bool setCurrentConfiguration( QString const & fullname);
-    
+
+    /**
+     * @brief The current configuration, read from the project data.
+     */
     MsvcProjectConfig getCurrentConfig() const;
+
+    QStringList configurationNames() const;
     
     void setUuid(QUuid uuid)
     {
@@ -88,11 +161,97 @@ public:
     QUuid uuid() const { return uuid_; }
     QString rootNamespace() const { return root_namespace_; }
 
+    /**
+     * @brief The parsed project this item was built from.
+     *
+     * The configurations are only kept there. Setting new data keeps the
+     * current configuration if it still exists and clears the caches.
+     */
+    std::shared_ptr<const MsvcProjectData> projectData() const;
+    void setProjectData( std::shared_ptr<const MsvcProjectData> data );
+
+    /**
+     * @brief The registry of the solution the files of this project are in.
+     */
+    std::shared_ptr<MsvcFileRegistry> fileRegistry() const { return files_; }
+    void setFileRegistry( std::shared_ptr<MsvcFileRegistry> files ) { files_ = std::move( files ); }
+
+    /**
+     * @brief The filter holding @p path among its unloaded files, if any.
+     */
+    MsvcFilterItem * pendingFilterFor( KDevelop::Path const & path ) const;
+
+    /**
+     * @brief Resolve a path found in the project file.
+     * Backslashes are converted and relative paths are resolved against the project directory.
+     */
+    KDevelop::Path resolvePath( QString filePath ) const;
+
+    /**
+     * @brief The expanded path of the file produced by the current configuration.
+     * Returns an invalid path if the output can not be determined.
+     */
+    KDevelop::Path targetPath() const;
+
+    /**
+     * @brief The expanded intermediate directory of the current configuration.
+     */
+    KDevelop::Path intermediatePath() const;
+
+    /**
+     * @brief Include directories of the current configuration.
+     * Computed once and kept until the configuration or the toolchain changes.
+     */
+    KDevelop::Path::List includeDirectories() const;
+
+    /**
+     * @brief Defines of the current configuration, cached like includeDirectories().
+     */
+    QHash<QString,QString> defines() const;
+
+    /**
+     * @brief What the parser of @p source needs besides the includes and the
+     * defines, see MsvcCompileFlags::parserArguments(). Cached like defines().
+     */
+    QString extraArguments( KDevelop::Path const & source ) const;
+
+    /**
+     * @brief Expansions done by MsvcVariableReplacer for this project.
+     * On a miss @p stamp is set, pass it back to cacheExpansion(): the result
+     * is dropped if the configuration was replaced in between.
+     */
+    bool cachedExpansion( QString const & s, QString & result, quint64 & stamp ) const;
+    void cacheExpansion( QString const & s, QString const & result, quint64 stamp ) const;
+
 private:
+    static QString fullName( MsvcProjectConfig const & config );
+
+    // With cache_mutex_ held
+    const MsvcProjectConfig * findConfiguration( QString const & fullname ) const;
+
+    // Fills in the requested flags, returns true when the cache was up to date
+    bool updateFlagsCache( KDevelop::Path::List * includes, QHash<QString,QString> * defines ) const;
+
+    // With cache_mutex_ held
+    void clearCaches();
+
     QString current_config_;
     QString root_namespace_;
-    QHash< QString, MsvcProjectConfig > configurations_;
     QUuid uuid_;
+    std::shared_ptr<const MsvcProjectData> data_;
+    std::shared_ptr<MsvcFileRegistry> files_;
+
+    // Asked for from the parser threads, hence the mutex. It guards data_
+    // and current_config_ too, the data is replaced when the project is reloaded.
+    mutable QMutex cache_mutex_;
+    quint64 cache_stamp_ = 0;       // bumped by clearCaches()
+    mutable int flags_generation_ = -1;
+    mutable int expansion_generation_ = -1;
+    mutable KDevelop::Path::List include_cache_;
+    mutable QHash<QString,QString> define_cache_;
+    mutable MsvcProjectConfig::CompileAs compile_as_ = MsvcProjectConfig::CompileAsDefault;
+    mutable QHash<bool,QString> extra_cache_;   // by MsvcCompileFlags::isC()
+    mutable QHash<QString,QString> expansion_cache_;
 };
 
 class MsvcSolutionItem : public KDevelop::ProjectBuildFolderItem
@@ -101,6 +260,7 @@ public:
     MsvcSolutionItem( KDevelop::IProject* , 
                       const KDevelop::Path& path,
                       ProjectBaseItem* parent = nullptr );
+    ~MsvcSolutionItem() override;
     
     bool lessThan( const KDevelop::ProjectBaseItem* item ) const override;
     
@@ -129,10 +289,55 @@ public:
 
     QList<QString> getConfigurations() const { return config_map_.keys(); }
 
+    QList<MsvcProjectItem*> projects() const;
+
+    /**
+     * @brief The solution of @p project or its project at @p path, null if
+     * there is none (any more).
+     */
+    static KDevelop::ProjectBuildFolderItem * findBuildItem( KDevelop::IProject * project, KDevelop::Path const & path );
+
+    /**
+     * @brief The files of every project in the solution.
+     */
+    std::shared_ptr<MsvcFileRegistry> fileRegistry() const { return files_; }
+
+    /**
+     * @brief Directory listings for the wildcard items, shared by all the projects.
+     */
+    std::shared_ptr<MsvcDirectoryCache> directoryCache() const { return directories_; }
+
+    /**
+     * @brief The parsed project files, so a project listed by several open solutions is parsed once.
+     */
+    std::shared_ptr<MsvcParseCache> parseCache() const { return parses_; }
+
+    /**
+     * @brief The solution files imported into this item, path() first.
+     */
+    KDevelop::Path::List solutionFiles() const;
+    void setSolutionFiles( KDevelop::Path::List const & files ) { solutions_ = files; }
+
+    /**
+     * @brief The ProjectDependencies of the solutions, from project uuid to the uuids it depends on.
+     */
+    void setProjectDependencies( QHash< QUuid, QList<QUuid> > const & dependencies );
+
+    /**
+     * @brief The dependencies between the projects, built again when they changed.
+     */
+    std::shared_ptr<const MsvcProjectGraph> dependencyGraph() const;
+
 private:
     MsvcProjectItem* findProjectByUuid(const QUuid &) const;
 
     QHash< QString, QHash<QUuid, QString> > config_map_;
+    std::shared_ptr<MsvcFileRegistry> files_;
+    std::shared_ptr<MsvcDirectoryCache> directories_;
+    std::shared_ptr<MsvcParseCache> parses_;
+    KDevelop::Path::List solutions_;
+    QHash< QUuid, QList<QUuid> > dependencies_;
+    mutable std::shared_ptr<const MsvcProjectGraph> graph_;
 };
 
 class MsvcVariableReplacer
@@ -171,11 +376,16 @@ private:
         bool stop_;
     };
     
-    bool replace_target_dir_guard_ = false,
+    bool replace_out_dir_guard_ = false,
+         replace_int_dir_guard_ = false,
+         replace_target_dir_guard_ = false,
          replace_target_path_guard_ = false,
          replace_target_name_guard_ = false,
          replace_target_file_name_guard_ = false,
          replace_target_ext_guard_ = false;
+
+    // Only complete expansions are cached, not the nested ones
+    int depth_ = 0;
 };
 
 #endif //MSVCMODELITEMS_H
@@ -0,0 +1,260 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "msvcninjagenerator.h"
+#include "msvcbuildplan.h"
+#include "msvccompileflags.h"
+#include "msvcconfig.h"
+#include "msvcmodelitems.h"
+#include "msvcprojectgraph.h"
+#include "debug.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QRegularExpression>
+#include <QSaveFile>
+
+#include <interfaces/iproject.h>
+
+namespace
+{
+
+// Paths in build statements
+QByteArray escapePath( QString const & path )
+{
+    QString result = path;
+    result.replace( '$', "$$" );
+    result.replace( ' ', "$ " );
+    result.replace( ':', "$:" );
+    return result.toUtf8();
+}
+
+QByteArray escapePath( KDevelop::Path const & path )
+{
+    return escapePath( path.toLocalFile() );
+}
+
+// Command line arguments, they end up in a shell (or CreateProcess on windows)
+QByteArray escapeArgument( QString const & arg )
+{
+    QString result = arg;
+    result.replace( '$', "$$" );
+
+    if ( result.contains( ' ' ) || result.contains( '"' ) )
+    {
+        result.replace( '"', "\\\"" );
+        result = '"' + result + '"';
+    }
+
+    return result.toUtf8();
+}
+
+QByteArray escapeArguments( QStringList const & args )
+{
+    QByteArray result;
+    for ( const QString & arg : args )
+    {
+        if ( !result.isEmpty() )
+            result += ' ';
+        result += escapeArgument( arg );
+    }
+    return result;
+}
+
+}
+
+MsvcNinjaGenerator::MsvcNinjaGenerator( KDevelop::IProject * project, QList<MsvcProjectItem*> const & projects ) :
+    m_project(project),
+    m_projects(projects),
+    m_toolchain(MsvcToolchain::self().profile( project ))
+{
+}
+
+KDevelop::Path MsvcNinjaGenerator::buildDirectory( KDevelop::IProject * project )
+{
+    const MsvcToolchain::Profile toolchain = MsvcToolchain::self().profile( project );
+
+    KDevelop::Path result( MsvcConfig::dataDirectory( project ), QStringLiteral("ninja") );
+    result.addPath( toolchain.configuration.isEmpty() ? QStringLiteral("Default") : toolchain.configuration );
+    return result;
+}
+
+QString MsvcNinjaGenerator::targetName( MsvcProjectItem * proj )
+{
+    QString name = proj->text();
+    static const QRegularExpression invalidChars( "[^A-Za-z0-9_.-]" );
+    name.replace( invalidChars, "_" );
+
+    // Keep apart from "all" and from the output files
+    QString result = QStringLiteral("project/") + name;
+
+    if ( MsvcSolutionItem * solItem = dynamic_cast<MsvcSolutionItem*>( proj->parent() ) )
+    {
+        for ( MsvcProjectItem * other : solItem->projects() )
+        {
+            if ( other != proj && other->text().compare( proj->text(), Qt::CaseInsensitive ) == 0 )
+            {
+                const QByteArray path = proj->path().toLocalFile().toUtf8();
+                result += '-' + QString::fromLatin1( QCryptographicHash::hash( path, QCryptographicHash::Md5 ).toHex().left( 8 ) );
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+bool MsvcNinjaGenerator::generate()
+{
+    const KDevelop::Path buildDir = buildDirectory( m_project );
+
+    if ( !QDir().mkpath( buildDir.toLocalFile() ) )
+    {
+        qCWarning(KDEV_MSVC) << "Cannot create" << buildDir;
+        return false;
+    }
+
+    QSaveFile out( KDevelop::Path( buildDir, QStringLiteral("build.ninja") ).toLocalFile() );
+    if ( !out.open( QIODevice::WriteOnly ) )
+    {
+        qCWarning(KDEV_MSVC) << "Cannot write" << out.fileName();
+        return false;
+    }
+
+    out.write( "# Generated by the KDevelop MSVC plugin, changes will be lost.\n\n" );
+    out.write( "ninja_required_version = 1.7\n" );
+    out.write( "msvc_deps_prefix = Note: including file:\n\n" );
+
+    out.write( "cc = " + escapeArgument( m_toolchain.clangCl ) + "\n" );
+    out.write( "link = " + escapeArgument( m_toolchain.lldLink ) + "\n" );
+    out.write( "lib = " + escapeArgument( m_toolchain.llvmLib ) + "\n\n" );
+
+    out.write( "rule cc\n"
+               "  command = $cc /showIncludes $flags /c $in /Fo$out\n"
+               "  deps = msvc\n"
+               "  description = CC $out\n\n" );
+
+    out.write( "rule link\n"
+               "  command = $link /nologo $ldflags /out:$out @$out.rsp\n"
+               "  rspfile = $out.rsp\n"
+               "  rspfile_content = $in_newline\n"
+               "  description = LINK $out\n\n" );
+
+    out.write( "rule lib\n"
+               "  command = $lib /nologo /out:$out @$out.rsp\n"
+               "  rspfile = $out.rsp\n"
+               "  rspfile_content = $in_newline\n"
+               "  description = LIB $out\n\n" );
+
+    QByteArray all;
+    for ( MsvcProjectItem * proj : m_projects )
+    {
+        writeProject( out, proj );
+        all += ' ' + escapePath( targetName( proj ) );
+    }
+
+    out.write( "build all: phony" + all + "\n" );
+    out.write( "default all\n" );
+
+    return out.commit();
+}
+
+void MsvcNinjaGenerator::writeProject( QIODevice & out, MsvcProjectItem * proj ) const
+{
+    MsvcBuildPlan plan = MsvcBuildPlan::forProject( proj );
+
+    out.write( "# " + plan.name.toUtf8() + "\n" );
+
+    if ( !plan.isValid() || !plan.writeSources() )
+    {
+        qCWarning(KDEV_MSVC) << "Cannot generate a ninja target for" << plan.name;
+        out.write( "build " + escapePath( targetName( proj ) ) + ": phony\n\n" );
+        return;
+    }
+
+    // The libraries of the dependencies are linked in, anything else is order only
+    QByteArray libraries;
+    for ( const KDevelop::Path & library : plan.libraries )
+        libraries += ' ' + escapePath( library );
+
+    QByteArray dependencies;
+    if ( m_graph )
+    {
+        for ( MsvcProjectItem * dependency : m_graph->dependencies( proj ) )
+            dependencies += ' ' + escapePath( targetName( dependency ) );
+        if ( !dependencies.isEmpty() )
+            dependencies.prepend( " ||" );
+    }
+
+    QByteArray objects;
+    QByteArray pchDependency;
+    if ( plan.hasPch() )
+    {
+        out.write( "build " + escapePath( plan.pch.object ) + " | " + escapePath( plan.pchFile ) +
+                   ": cc " + escapePath( plan.pch.source ) + "\n" );
+        out.write( "  flags = " + escapeArguments( plan.pch.arguments ) + "\n" );
+        objects += ' ' + escapePath( plan.pch.object );
+        pchDependency = " | " + escapePath( plan.pchFile );
+    }
+
+    for ( const MsvcBuildPlan::CompileUnit & unit : plan.units )
+    {
+        const bool usesPch = plan.hasPch() && unit.arguments.contains( "/Yu" + plan.pchHeader.toLocalFile() );
+
+        out.write( "build " + escapePath( unit.object ) + ": cc " + escapePath( unit.source ) +
+                   ( usesPch ? pchDependency : QByteArray() ) + "\n" );
+        out.write( "  flags = " + escapeArguments( unit.arguments ) + "\n" );
+        objects += ' ' + escapePath( unit.object );
+    }
+
+    switch ( plan.type )
+    {
+    case MsvcProjectConfig::Application:
+    case MsvcProjectConfig::DynamicLibrary:
+    {
+        // The import library is an output too, the dependents link against it
+        QStringList ldflags;
+        QByteArray implicitOutputs;
+        if ( plan.type == MsvcProjectConfig::DynamicLibrary )
+        {
+            ldflags << "/dll" << "/implib:" + plan.importLibrary.toLocalFile();
+            implicitOutputs = " | " + escapePath( plan.importLibrary );
+        }
+        if ( plan.subSystem == MsvcProjectConfig::SubSystemConsole )
+            ldflags << "/subsystem:console";
+        else if ( plan.subSystem == MsvcProjectConfig::SubSystemWindows )
+            ldflags << "/subsystem:windows";
+
+        out.write( "build " + escapePath( plan.output ) + implicitOutputs + ": link" + objects + libraries + dependencies + "\n" );
+        out.write( "  ldflags = " + escapeArguments( ldflags ) + "\n" );
+        break;
+    }
+    case MsvcProjectConfig::StaticLibrary:
+        out.write( "build " + escapePath( plan.output ) + ": lib" + objects + dependencies + "\n" );
+        break;
+    default:
+        // Nothing to link, just compile
+        out.write( "build " + escapePath( targetName( proj ) ) + ": phony" + objects + dependencies + "\n\n" );
+        return;
+    }
+
+    out.write( "build " + escapePath( targetName( proj ) ) + ": phony " + escapePath( plan.output ) + "\n\n" );
+}
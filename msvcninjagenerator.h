@@ -0,0 +1,86 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCNINJAGENERATOR_H
+#define MSVCNINJAGENERATOR_H
+
+#include <QList>
+#include <QString>
+
+#include <kdevplatform/util/path.h>
+
+#include <memory>
+
+#include "msvctoolchain.h"
+
+class QIODevice;
+
+class MsvcProjectGraph;
+class MsvcProjectItem;
+
+namespace KDevelop
+{
+class IProject;
+}
+
+/**
+ * @brief Writes a build.ninja for the current configuration of some projects.
+ *
+ * Sources are compiled with a cl compatible compiler (clang-cl by default),
+ * header dependencies come from /showIncludes. Every project gets a phony
+ * target named after it in the project/ namespace.
+ */
+class MsvcNinjaGenerator
+{
+public:
+    MsvcNinjaGenerator( KDevelop::IProject * project, QList<MsvcProjectItem*> const & projects );
+
+    /**
+     * @brief Write build.ninja in buildDirectory(). Returns false on error.
+     */
+    bool generate();
+
+    /**
+     * @brief Link each project after the projects it depends on.
+     */
+    void setDependencyGraph( std::shared_ptr<const MsvcProjectGraph> graph ) { m_graph = std::move( graph ); }
+
+    /**
+     * @brief Where the ninja file for the current configuration of @p project lives.
+     */
+    static KDevelop::Path buildDirectory( KDevelop::IProject * project );
+
+    /**
+     * @brief The name of the phony target of @p proj, "project/<name>".
+     *
+     * Projects of the solution sharing a name get a short hash of their path.
+     */
+    static QString targetName( MsvcProjectItem * proj );
+
+private:
+    void writeProject( QIODevice & out, MsvcProjectItem * proj ) const;
+
+    KDevelop::IProject * m_project;
+    QList<MsvcProjectItem*> m_projects;
+    MsvcToolchain::Profile m_toolchain;
+    std::shared_ptr<const MsvcProjectGraph> m_graph;
+};
+
+#endif //MSVCNINJAGENERATOR_H
@@ -0,0 +1,225 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "msvcobjectcache.h"
+#include "debug.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QPair>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVector>
+
+#include <algorithm>
+
+namespace
+{
+// Bump when the on disk format changes
+const quint32 INDEX_VERSION = 1;
+}
+
+MsvcObjectCache & MsvcObjectCache::self()
+{
+    static MsvcObjectCache instance;
+    return instance;
+}
+
+MsvcObjectCache::MsvcObjectCache() :
+    m_directory( QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/kdevmsvc-objects") ),
+    m_maximumSize( qint64(5) * 1024 * 1024 * 1024 )
+{
+}
+
+QString MsvcObjectCache::entryPath( QByteArray const & key, char const * suffix ) const
+{
+    // Two levels, so no directory gets too big
+    return m_directory + '/' + QString::fromLatin1( key.left(2) ) + '/' + QString::fromLatin1( key ) + suffix;
+}
+
+bool MsvcObjectCache::lookup( QByteArray const & key, KDevelop::Path const & object, QString & diagnostics )
+{
+    QMutexLocker lock( &m_mutex );
+    load();
+
+    auto it = m_entries.find( key );
+    if ( it == m_entries.end() )
+    {
+        ++m_stats.misses;
+        return false;
+    }
+
+    const QString target = object.toLocalFile();
+    QFile::remove( target );
+
+    if ( !QFile::copy( entryPath( key, ".obj" ), target ) )
+    {
+        // Someone cleaned the directory behind our back
+        m_stats.size -= it->size;
+        m_entries.erase( it );
+        m_dirty = true;
+        ++m_stats.misses;
+        return false;
+    }
+
+    QFile log( entryPath( key, ".log" ) );
+    if ( log.open( QIODevice::ReadOnly ) )
+        diagnostics = QString::fromUtf8( log.readAll() );
+
+    it->lastUse = QDateTime::currentMSecsSinceEpoch();
+    m_dirty = true;
+    ++m_stats.hits;
+    return true;
+}
+
+void MsvcObjectCache::store( QByteArray const & key, KDevelop::Path const & object, QString const & diagnostics )
+{
+    QMutexLocker lock( &m_mutex );
+    load();
+
+    if ( m_entries.contains( key ) )
+        return;
+
+    const QString objectPath = entryPath( key, ".obj" );
+    QDir().mkpath( QFileInfo( objectPath ).path() );
+
+    // Copy to a temporary name first, concurrent lookups never see half written objects
+    const QString temporary = objectPath + ".tmp";
+    QFile::remove( temporary );
+    if ( !QFile::copy( object.toLocalFile(), temporary ) || !QFile::rename( temporary, objectPath ) )
+    {
+        QFile::remove( temporary );
+        qCWarning(KDEV_MSVC) << "Cannot store" << object << "in the object cache";
+        return;
+    }
+
+    QFile log( entryPath( key, ".log" ) );
+    if ( log.open( QIODevice::WriteOnly ) )
+        log.write( diagnostics.toUtf8() );
+
+    const qint64 size = QFileInfo( objectPath ).size() + log.size();
+    m_entries.insert( key, Entry{ size, QDateTime::currentMSecsSinceEpoch() } );
+    m_stats.size += size;
+    m_dirty = true;
+
+    if ( m_stats.size > m_maximumSize )
+        evict();
+}
+
+void MsvcObjectCache::setMaximumSize( qint64 bytes )
+{
+    QMutexLocker lock( &m_mutex );
+    m_maximumSize = bytes;
+}
+
+MsvcObjectCache::Statistics MsvcObjectCache::statistics()
+{
+    QMutexLocker lock( &m_mutex );
+    load();
+
+    Statistics result = m_stats;
+    result.entries = m_entries.size();
+    return result;
+}
+
+void MsvcObjectCache::sync()
+{
+    QMutexLocker lock( &m_mutex );
+
+    if ( !m_dirty )
+        return;
+
+    QDir().mkpath( m_directory );
+
+    QSaveFile file( m_directory + QStringLiteral("/index") );
+    if ( !file.open( QIODevice::WriteOnly ) )
+        return;
+
+    QDataStream out( &file );
+    out << INDEX_VERSION << m_stats.hits << m_stats.misses << m_stats.evictions;
+    out << quint32( m_entries.size() );
+    for ( auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it )
+        out << it.key() << it->size << it->lastUse;
+
+    if ( file.commit() )
+        m_dirty = false;
+}
+
+void MsvcObjectCache::load()
+{
+    if ( m_loaded )
+        return;
+    m_loaded = true;
+
+    QFile file( m_directory + QStringLiteral("/index") );
+    if ( !file.open( QIODevice::ReadOnly ) )
+        return;
+
+    QDataStream in( &file );
+
+    quint32 version = 0;
+    in >> version;
+    if ( version != INDEX_VERSION )
+        return;
+
+    quint32 count = 0;
+    in >> m_stats.hits >> m_stats.misses >> m_stats.evictions >> count;
+
+    m_entries.reserve( count );
+    for ( quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i )
+    {
+        QByteArray key;
+        Entry entry;
+        in >> key >> entry.size >> entry.lastUse;
+        m_entries.insert( key, entry );
+        m_stats.size += entry.size;
+    }
+}
+
+void MsvcObjectCache::evict()
+{
+    // Least recently used first, down to 90% of the limit so we do not evict on every store
+    QVector< QPair<qint64, QByteArray> > byAge;
+    byAge.reserve( m_entries.size() );
+    for ( auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it )
+        byAge << qMakePair( it->lastUse, it.key() );
+
+    std::sort( byAge.begin(), byAge.end() );
+
+    const qint64 target = m_maximumSize / 10 * 9;
+    for ( const auto & p : byAge )
+    {
+        if ( m_stats.size <= target )
+            break;
+
+        QFile::remove( entryPath( p.second, ".obj" ) );
+        QFile::remove( entryPath( p.second, ".log" ) );
+
+        m_stats.size -= m_entries.take( p.second ).size;
+        ++m_stats.evictions;
+    }
+
+    qCDebug(KDEV_MSVC) << "Object cache evicted down to" << m_stats.size << "bytes";
+}
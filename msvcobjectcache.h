@@ -0,0 +1,96 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCOBJECTCACHE_H
+#define MSVCOBJECTCACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include <kdevplatform/util/path.h>
+
+/**
+ * @brief Local content addressed cache of object files.
+ *
+ * The key is computed by the caller (preprocessed source, command line and
+ * compiler identity), the value is the object file and the compiler output.
+ * The cache lives in the user cache directory, so it is shared between
+ * workspaces, and old entries are evicted when it grows over its size limit.
+ */
+class MsvcObjectCache
+{
+public:
+    struct Statistics
+    {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;
+        qint64 size = 0;
+        int entries = 0;
+    };
+
+    static MsvcObjectCache & self();
+
+    /**
+     * @brief If @p key is in the cache, copy its object to @p object and
+     * return the compiler output in @p diagnostics.
+     */
+    bool lookup( QByteArray const & key, KDevelop::Path const & object, QString & diagnostics );
+
+    /**
+     * @brief Add the freshly compiled @p object to the cache.
+     */
+    void store( QByteArray const & key, KDevelop::Path const & object, QString const & diagnostics );
+
+    void setMaximumSize( qint64 bytes );
+
+    Statistics statistics();
+
+    /**
+     * @brief Write the index to disk.
+     */
+    void sync();
+
+private:
+    MsvcObjectCache();
+
+    struct Entry
+    {
+        qint64 size;
+        qint64 lastUse;
+    };
+
+    void load();
+    void evict();
+    QString entryPath( QByteArray const & key, char const * suffix ) const;
+
+    QMutex m_mutex;
+    QString m_directory;
+    qint64 m_maximumSize;
+    bool m_loaded = false;
+    bool m_dirty = false;
+
+    QHash<QByteArray, Entry> m_entries;
+    Statistics m_stats;
+};
+
+#endif //MSVCOBJECTCACHE_H
@@ -0,0 +1,77 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "msvcparsecache.h"
+#include "msvcprojectdata.h"
+#include "msvctrace.h"
+
+#include <QFileInfo>
+
+std::shared_ptr<MsvcParseCache> MsvcParseCache::instance()
+{
+    static const std::shared_ptr<MsvcParseCache> cache = std::make_shared<MsvcParseCache>();
+    return cache;
+}
+
+QDateTime MsvcParseCache::lastModified( KDevelop::Path const & projectPath )
+{
+    const QString fileName = projectPath.toLocalFile();
+    const QDateTime project = QFileInfo( fileName ).lastModified();
+    const QDateTime filters = QFileInfo( fileName + QStringLiteral(".filters") ).lastModified();
+
+    return filters.isValid() && filters > project ? filters : project;
+}
+
+std::shared_ptr<MsvcProjectData> MsvcParseCache::find( KDevelop::Path const & projectPath, QDateTime const & modified )
+{
+    QMutexLocker lock( &m_mutex );
+
+    auto it = m_entries.constFind( projectPath );
+    if ( it == m_entries.constEnd() || !modified.isValid() || it->modified != modified )
+        return nullptr;
+
+    std::shared_ptr<MsvcProjectData> data = it->data.lock();
+    if ( data )
+        MsvcTrace::count( "parse cache hits" );
+    return data;
+}
+
+void MsvcParseCache::insert( KDevelop::Path const & projectPath, QDateTime const & modified,
+                             std::shared_ptr<MsvcProjectData> data )
+{
+    QMutexLocker lock( &m_mutex );
+
+    // Drop the projects no solution shows any more
+    for ( auto it = m_entries.begin(); it != m_entries.end(); )
+    {
+        if ( it->data.expired() )
+            it = m_entries.erase( it );
+        else
+            ++it;
+    }
+
+    m_entries.insert( projectPath, { modified, data } );
+}
+
+int MsvcParseCache::size() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_entries.size();
+}
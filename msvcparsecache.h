@@ -0,0 +1,79 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCPARSECACHE_H
+#define MSVCPARSECACHE_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+
+#include <kdevplatform/util/path.h>
+
+#include <memory>
+
+class MsvcProjectData;
+
+/**
+ * @brief The parsed project files of the open solutions, by path.
+ *
+ * Solutions opened together usually list the same projects; each one is
+ * parsed once and its data handed to every solution asking for it. An entry
+ * is used as long as the project file and its .filters did not change, so
+ * projects with wildcard items, whose files depend on the directories, are
+ * not cached. Entries only refer to the data, which lives as long as a
+ * project item uses it. The data is never modified once cached. Used from
+ * the parser threads.
+ */
+class MsvcParseCache
+{
+public:
+    /**
+     * @brief The cache shared by every solution.
+     */
+    static std::shared_ptr<MsvcParseCache> instance();
+
+    /**
+     * @brief Modification time of @p projectPath or of its .filters, whichever is newer.
+     */
+    static QDateTime lastModified( KDevelop::Path const & projectPath );
+
+    /**
+     * @brief The data parsed from @p projectPath when it was last modified at @p modified, or null.
+     */
+    std::shared_ptr<MsvcProjectData> find( KDevelop::Path const & projectPath, QDateTime const & modified );
+
+    void insert( KDevelop::Path const & projectPath, QDateTime const & modified,
+                 std::shared_ptr<MsvcProjectData> data );
+
+    int size() const;
+
+private:
+    struct Entry
+    {
+        QDateTime modified;
+        std::weak_ptr<MsvcProjectData> data;
+    };
+
+    mutable QMutex m_mutex;
+    QHash< KDevelop::Path, Entry > m_entries;
+};
+
+#endif //MSVCPARSECACHE_H
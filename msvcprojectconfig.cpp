@@ -20,9 +20,14 @@
 
 
 #include "msvcprojectconfig.h"
+#include "msvctrace.h"
 
+#include <QPair>
+#include <QRegularExpression>
 #include <QXmlStreamReader>
 
+#include <algorithm>
+
 namespace
 {
 
@@ -43,6 +48,134 @@ QString getDefaultOutputExtension( MsvcProjectConfig::TargetType type )
     }
 }
 
+// Someone at MS decided that everything should be in quotes
+// Also the MSVC debugger hides the quotes from you.
+// (Spent 2 hours to figure out this)
+QStringList splitList( QStringRef const & value )
+{
+    QStringList result;
+    bool insideQuotedString = false;
+    QString current;
+    for ( auto c : value )
+    {
+        if ( c.unicode() == '"' )
+            insideQuotedString = !insideQuotedString;
+        else
+        {
+            if ( insideQuotedString || c.unicode() != ';' )
+                current += c;
+            else
+            {
+                if (!current.isEmpty() )
+                    result << current;
+                current.clear();
+            }
+        }
+    }
+
+    if ( !current.isEmpty()  )
+        result << current;
+
+    // MSBuild inherited values, e.g. %(PreprocessorDefinitions)
+    result.erase( std::remove_if( result.begin(), result.end(),
+                                  [](const QString & s) { return s.startsWith("%("); } ),
+                  result.end() );
+    return result;
+}
+
+void parseDefines( MsvcProjectConfig & result, QStringRef const & value )
+{
+    for ( const QString & s : splitList( value ) )
+    {
+        QStringList nameAndValue = s.split('=');
+        result.preprocessorDefines.insert( nameAndValue.value(0).trimmed(), nameAndValue.value(1) );
+    }
+}
+
+void addConformanceFlag( MsvcProjectConfig & result, QString const & flag )
+{
+    if ( !result.conformanceFlags.contains( flag ) )
+        result.conformanceFlags << flag;
+}
+
+// AdditionalOptions split like the command line: quotes group and are dropped
+QStringList splitOptions( QString const & value )
+{
+    QStringList result;
+    QString option;
+    bool quoted = false;
+    bool inOption = false;
+    for ( const QChar c : value )
+    {
+        if ( c == '"' )
+        {
+            quoted = !quoted;
+            inOption = true;
+        }
+        else if ( c.isSpace() && !quoted )
+        {
+            if ( inOption )
+                result << option;
+            option.clear();
+            inOption = false;
+        }
+        else
+        {
+            option += c;
+            inOption = true;
+        }
+    }
+    if ( inOption )
+        result << option;
+    return result;
+}
+
+// The switches we care about hidden in AdditionalOptions
+void parseAdditionalOptions( MsvcProjectConfig & result, QString const & value )
+{
+    const QStringList options = splitOptions( value );
+    for ( int i = 0; i < options.size(); ++i )
+    {
+        QString option = options.at( i );
+        if ( option.startsWith( '-' ) )
+            option[0] = '/';
+
+        if ( option.startsWith( "/Zc:" ) || option == "/permissive-" )
+        {
+            addConformanceFlag( result, option );
+        }
+        else if ( option.startsWith( "/std:" ) )
+        {
+            const QString standard = option.mid( 5 );
+            if ( standard.startsWith( "c++" ) )
+                result.languageStandard = standard;
+            else
+                result.cLanguageStandard = standard;
+        }
+        else if ( option == "/TC" )
+        {
+            result.compileAs = MsvcProjectConfig::CompileAsC;
+        }
+        else if ( option == "/TP" )
+        {
+            result.compileAs = MsvcProjectConfig::CompileAsCpp;
+        }
+        // cl takes the argument of both glued or as the next option
+        else if ( option.startsWith( "/FI" ) )
+        {
+            const QString header = option.size() > 3 ? option.mid( 3 ) : options.value( ++i );
+            if ( !header.isEmpty() )
+                result.forcedIncludeFiles << header;
+        }
+        else if ( option.startsWith( "/U" ) )
+        {
+            const QString name = option.size() > 2 ? option.mid( 2 ) : options.value( ++i );
+            if ( !name.isEmpty() )
+                result.undefines << name;
+        }
+    }
+}
+
 void parseConfigGeneric(MsvcProjectConfig & result, QXmlStreamReader & reader)
 {
     QStringList nameAndArch = reader.attributes().value("Name").toString().split('|');
@@ -52,13 +185,32 @@ void parseConfigGeneric(MsvcProjectConfig & result, QXmlStreamReader & reader)
     result.configurationName = nameAndArch.value(0);
     result.targetArchitecture = nameAndArch.value(1);
         
-    int configurationType = reader.attributes().value("ConfigurationType").toInt();
-    
-    result.configurationType = (configurationType > 0 && configurationType <= 4) ? 
-                                MsvcProjectConfig::TargetType(configurationType) :
-                                MsvcProjectConfig::Unknown;
+    // Values of the ConfigurationTypes enumeration of the VCProjectEngine
+    switch ( reader.attributes().value("ConfigurationType").toInt() )
+    {
+    case 1:
+        result.configurationType = MsvcProjectConfig::Application;
+        break;
+    case 2:
+        result.configurationType = MsvcProjectConfig::DynamicLibrary;
+        break;
+    case 4:
+        result.configurationType = MsvcProjectConfig::StaticLibrary;
+        break;
+    case 10:
+        result.configurationType = MsvcProjectConfig::Generic;
+        break;
+    default:
+        result.configurationType = MsvcProjectConfig::Unknown;
+        break;
+    }
                                 
-    result.outputDirectory  = reader.attributes().value("OutputDirectory").toString();
+    result.outputDirectory  = reader.attributes().hasAttribute("OutputDirectory") ?
+                              reader.attributes().value("OutputDirectory").toString() :
+                              "$(SolutionDir)$(ConfigurationName)";
+    result.intermediateDirectory  = reader.attributes().hasAttribute("IntermediateDirectory") ?
+                                    reader.attributes().value("IntermediateDirectory").toString() :
+                                    "$(ConfigurationName)";
                                
     int characterSet = reader.attributes().value("CharacterSet").toInt();
     
@@ -78,46 +230,47 @@ void parseConfigCompilerTool(MsvcProjectConfig & result, QXmlStreamReader & read
     result.intrinsicInstructions = 
         reader.attributes().value("EnableIntrinsicFunctions").compare("true", Qt::CaseInsensitive) == 0;
     
-    QStringList preprocessorDef = reader.attributes().value("PreprocessorDefinitions").toString().split(';');
-    
-    for ( const QString & s : preprocessorDef )
-    {
-        QStringList nameAndValue = s.split('=');
-        result.preprocessorDefines.insert( nameAndValue.value(0), nameAndValue.value(1) );
-    }
+    parseDefines( result, reader.attributes().value("PreprocessorDefinitions") );
     
-    // Someone at MS decided that everything should be in quotes
-    // Also the MSVC debugger hides the quotes from you.
-    // (Spent 2 hours to figure out this)
-    bool insideQuotedString = false;
-    QString current;
-    for ( auto c : reader.attributes().value("AdditionalIncludeDirectories") )
-    {
-        if ( c.unicode() == '"' )
-            insideQuotedString = !insideQuotedString;
-        else
-        {
-            if ( insideQuotedString || c.unicode() != ';' )
-                current += c;
-            else
-            {
-                if (!current.isEmpty() )
-                    result.additionalIncludeDirectories << current;
-                current.clear();
-            }
-        }
-    }
-
-    if ( !current.isEmpty()  )
-        result.additionalIncludeDirectories << current;
+    result.additionalIncludeDirectories << splitList( reader.attributes().value("AdditionalIncludeDirectories") );
     
     int runtimeLibrary = reader.attributes().value("RuntimeLibrary").toInt();
     result.rtLibrary = ( runtimeLibrary >= 0 && runtimeLibrary < 4) ?
                         MsvcProjectConfig::RuntimeLibrary( runtimeLibrary ) :
                         MsvcProjectConfig::MultiThreaded;
     
-    result.usepch = reader.attributes().value("UsePrecompiledHeader").toInt() != 0;
+    // 1 is /Yc, 2 is /Yu since VS2005 (VS2003 used 2 for /YX and 3 for /Yu)
+    const int usePch = reader.attributes().value("UsePrecompiledHeader").toInt();
+    result.pchUsage = usePch == 1 ? MsvcProjectConfig::PchCreate :
+                      usePch >= 2 ? MsvcProjectConfig::PchUse :
+                                    MsvcProjectConfig::PchNotUsing;
+
+    result.pchThrough = reader.attributes().hasAttribute("PrecompiledHeaderThrough") ?
+                        reader.attributes().value("PrecompiledHeaderThrough").toString() :
+                        "stdafx.h";
+
+    // The documented default is $(IntDir)\$(TargetName).pch, TargetName defaults to the project name
+    result.pchOutputFile = reader.attributes().hasAttribute("PrecompiledHeaderFile") ?
+                           reader.attributes().value("PrecompiledHeaderFile").toString() :
+                           "$(IntDir)\\$(ProjectName).pch";
     result.warningLevel = reader.attributes().value("WarningLevel").toInt();
+
+    // Values of the CompileAsOptions enumeration of the VCProjectEngine
+    const int compileAs = reader.attributes().value("CompileAs").toInt();
+    result.compileAs = ( compileAs > 0 && compileAs <= 2 ) ?
+                       MsvcProjectConfig::CompileAs( compileAs ) :
+                       MsvcProjectConfig::CompileAsDefault;
+
+    result.forcedIncludeFiles << splitList( reader.attributes().value("ForcedIncludeFiles") );
+    result.undefines << splitList( reader.attributes().value("UndefinePreprocessorDefinitions") );
+
+    // Both default to true
+    if ( reader.attributes().value("TreatWChar_tAsBuiltInType").compare("false", Qt::CaseInsensitive) == 0 )
+        addConformanceFlag( result, "/Zc:wchar_t-" );
+    if ( reader.attributes().value("ForceConformanceInForLoopScope").compare("false", Qt::CaseInsensitive) == 0 )
+        addConformanceFlag( result, "/Zc:forScope-" );
+
+    parseAdditionalOptions( result, reader.attributes().value("AdditionalOptions").toString() );
 }
 
 void parseConfigLinkerTool(MsvcProjectConfig & result, QXmlStreamReader & reader)
@@ -140,6 +293,8 @@ void parseConfigLinkerTool(MsvcProjectConfig & result, QXmlStreamReader & reader
 MsvcProjectConfig parseConfig(QXmlStreamReader& reader)
 {
     Q_ASSERT( reader.name() == "Configuration" );
+
+    MSVC_TRACE_SPAN( "config parse" );
    
     MsvcProjectConfig result = {};
     
@@ -166,3 +321,381 @@ MsvcProjectConfig parseConfig(QXmlStreamReader& reader)
    
     return result;
 }
+
+namespace
+{
+
+// Maps MSBuild enumeration names to our values, returns fallback if not found.
+template<class T, std::size_t N>
+T lookup( const QPair<const char *, T> (&table)[N], QString const & value, T fallback )
+{
+    for ( const auto & entry : table )
+    {
+        if ( value.compare( entry.first, Qt::CaseInsensitive ) == 0 )
+            return entry.second;
+    }
+    return fallback;
+}
+
+bool isTrue( QString const & value )
+{
+    return value.compare( "true", Qt::CaseInsensitive ) == 0;
+}
+
+void parseVcxCompilerTool( MsvcProjectConfig & result, QXmlStreamReader & reader )
+{
+    while ( reader.readNextStartElement() )
+    {
+        const QString name = reader.name().toString();
+        applyVcxCompilerSetting( result, name, reader.readElementText( QXmlStreamReader::SkipChildElements ) );
+    }
+}
+
+void parseVcxLinkerTool( MsvcProjectConfig & result, QXmlStreamReader & reader )
+{
+    static const QPair<const char *, MsvcProjectConfig::SubSystem> subSystem[] =
+    {
+        { "Console", MsvcProjectConfig::SubSystemConsole },
+        { "Windows", MsvcProjectConfig::SubSystemWindows },
+        { "Native", MsvcProjectConfig::SubSystemNative }
+    };
+
+    while ( reader.readNextStartElement() )
+    {
+        if ( reader.name() == "SubSystem" )
+        {
+            result.subSystem = lookup( subSystem, reader.readElementText(), MsvcProjectConfig::SubSystemNotSet );
+        }
+        else if ( reader.name() == "OutputFile" )
+        {
+            result.outputFile = reader.readElementText();
+        }
+        else
+        {
+            reader.skipCurrentElement();
+        }
+    }
+}
+
+}
+
+QString parseVcxCondition( QStringRef const & condition )
+{
+    static const QRegularExpression regex( R"('\$\(Configuration\)\|\$\(Platform\)'\s*==\s*'([^']+)')" );
+
+    QRegularExpressionMatch match = regex.match( condition.toString() );
+    return match.hasMatch() ? match.captured(1) : QString();
+}
+
+bool applyVcxCompilerSetting( MsvcProjectConfig & result, QString const & name, QString const & value )
+{
+    static const QPair<const char *, int> optimization[] =
+    {
+        { "Disabled", 0 }, { "MinSpace", 1 }, { "MaxSpeed", 2 }, { "Full", 3 }
+    };
+    static const QPair<const char *, int> warningLevel[] =
+    {
+        { "TurnOffAllWarnings", 0 }, { "Level1", 1 }, { "Level2", 2 },
+        { "Level3", 3 }, { "Level4", 4 }, { "EnableAllWarnings", 4 }
+    };
+    static const QPair<const char *, MsvcProjectConfig::RuntimeLibrary> runtimeLibrary[] =
+    {
+        { "MultiThreaded", MsvcProjectConfig::MultiThreaded },
+        { "MultiThreadedDebug", MsvcProjectConfig::MultiThreadedDebug },
+        { "MultiThreadedDLL", MsvcProjectConfig::MultiThreadedDll },
+        { "MultiThreadedDebugDLL", MsvcProjectConfig::MultiThreadedDebugDll }
+    };
+    static const QPair<const char *, MsvcProjectConfig::PchUsage> pchUsage[] =
+    {
+        { "NotUsing", MsvcProjectConfig::PchNotUsing },
+        { "Create", MsvcProjectConfig::PchCreate },
+        { "Use", MsvcProjectConfig::PchUse }
+    };
+    static const QPair<const char *, MsvcProjectConfig::CompileAs> compileAs[] =
+    {
+        { "Default", MsvcProjectConfig::CompileAsDefault },
+        { "CompileAsC", MsvcProjectConfig::CompileAsC },
+        { "CompileAsCpp", MsvcProjectConfig::CompileAsCpp },
+        { "CompileAsCppModule", MsvcProjectConfig::CompileAsCpp }
+    };
+    static const QPair<const char *, const char *> languageStandard[] =
+    {
+        { "stdcpp14", "c++14" }, { "stdcpp17", "c++17" }, { "stdcpp20", "c++20" },
+        { "stdcpplatest", "c++latest" }, { "stdc11", "c11" }, { "stdc17", "c17" }
+    };
+
+    // A list without %(Name) replaces the inherited one
+    const bool inherits = value.contains( "%(" );
+
+    if ( name == "PreprocessorDefinitions" )
+    {
+        if ( !inherits )
+            result.preprocessorDefines.clear();
+        parseDefines( result, QStringRef(&value) );
+    }
+    else if ( name == "AdditionalIncludeDirectories" )
+    {
+        if ( !inherits )
+            result.additionalIncludeDirectories.clear();
+        result.additionalIncludeDirectories << splitList( QStringRef(&value) );
+    }
+    else if ( name == "Optimization" )
+    {
+        result.optimizationLevel = lookup( optimization, value, 0 );
+    }
+    else if ( name == "IntrinsicFunctions" )
+    {
+        result.intrinsicInstructions = isTrue( value );
+    }
+    else if ( name == "RuntimeLibrary" )
+    {
+        result.rtLibrary = lookup( runtimeLibrary, value, MsvcProjectConfig::MultiThreaded );
+    }
+    else if ( name == "PrecompiledHeader" )
+    {
+        result.pchUsage = lookup( pchUsage, value, MsvcProjectConfig::PchNotUsing );
+    }
+    else if ( name == "PrecompiledHeaderFile" )
+    {
+        result.pchThrough = value;
+    }
+    else if ( name == "PrecompiledHeaderOutputFile" )
+    {
+        result.pchOutputFile = value;
+    }
+    else if ( name == "WarningLevel" )
+    {
+        result.warningLevel = lookup( warningLevel, value, 0 );
+    }
+    else if ( name == "ForcedIncludeFiles" )
+    {
+        if ( !inherits )
+            result.forcedIncludeFiles.clear();
+        result.forcedIncludeFiles << splitList( QStringRef(&value) );
+    }
+    else if ( name == "UndefinePreprocessorDefinitions" )
+    {
+        if ( !inherits )
+            result.undefines.clear();
+        result.undefines << splitList( QStringRef(&value) );
+    }
+    else if ( name == "LanguageStandard" )
+    {
+        result.languageStandard = QString::fromLatin1( lookup( languageStandard, value, "" ) );
+    }
+    else if ( name == "LanguageStandard_C" )
+    {
+        result.cLanguageStandard = QString::fromLatin1( lookup( languageStandard, value, "" ) );
+    }
+    else if ( name == "CompileAs" )
+    {
+        result.compileAs = lookup( compileAs, value, MsvcProjectConfig::CompileAsDefault );
+    }
+    else if ( name == "ConformanceMode" )
+    {
+        if ( isTrue( value ) )
+            addConformanceFlag( result, "/permissive-" );
+        else
+            result.conformanceFlags.removeAll( "/permissive-" );
+    }
+    else if ( name == "TreatWChar_tAsBuiltInType" )
+    {
+        if ( !isTrue( value ) )
+            addConformanceFlag( result, "/Zc:wchar_t-" );
+        else
+            result.conformanceFlags.removeAll( "/Zc:wchar_t-" );
+    }
+    else if ( name == "ForceConformanceInForLoopScope" )
+    {
+        if ( !isTrue( value ) )
+            addConformanceFlag( result, "/Zc:forScope-" );
+        else
+            result.conformanceFlags.removeAll( "/Zc:forScope-" );
+    }
+    else if ( name == "AdditionalOptions" )
+    {
+        parseAdditionalOptions( result, value );
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+QVector< QPair<QString, QString> > vcCompilerToolSettings( QXmlStreamAttributes const & attributes )
+{
+    static const struct
+    {
+        const char * attribute;
+        const char * name;
+        bool list;
+    } names[] =
+    {
+        { "PreprocessorDefinitions", "PreprocessorDefinitions", true },
+        { "AdditionalIncludeDirectories", "AdditionalIncludeDirectories", true },
+        { "ForcedIncludeFiles", "ForcedIncludeFiles", true },
+        { "UndefinePreprocessorDefinitions", "UndefinePreprocessorDefinitions", true },
+        { "PrecompiledHeaderThrough", "PrecompiledHeaderFile", false },
+        { "PrecompiledHeaderFile", "PrecompiledHeaderOutputFile", false },
+        { "AdditionalOptions", "AdditionalOptions", false }
+    };
+    // Indexed by the values of the VCProjectEngine enumerations
+    static const char * const optimization[] = { "Disabled", "MinSpace", "MaxSpeed", "Full" };
+    static const char * const pchUsage[] = { "NotUsing", "Create", "Use", "Use" };
+    static const char * const compileAs[] = { "Default", "CompileAsC", "CompileAsCpp" };
+    static const char * const warningLevel[] = { "TurnOffAllWarnings", "Level1", "Level2", "Level3", "Level4" };
+    static const char * const runtimeLibrary[] = { "MultiThreaded", "MultiThreadedDebug", "MultiThreadedDLL", "MultiThreadedDebugDLL" };
+
+    QVector< QPair<QString, QString> > result;
+    for ( const auto & name : names )
+    {
+        if ( !attributes.hasAttribute( name.attribute ) )
+            continue;
+
+        QString value = attributes.value( name.attribute ).toString();
+        if ( name.list )
+        {
+            // Lists add to the project ones unless they say otherwise
+            const bool inherits = !value.contains( "$(NoInherit)" );
+            value.remove( "$(NoInherit)" ).remove( "$(Inherit)" );
+            if ( inherits )
+                value += QStringLiteral(";%(") + name.name + ')';
+        }
+        result.append( { name.name, value } );
+    }
+
+    auto addEnum = [&]( const char * attribute, const char * name, const char * const * values, int count )
+    {
+        if ( !attributes.hasAttribute( attribute ) )
+            return;
+        const int value = attributes.value( attribute ).toInt();
+        if ( value >= 0 && value < count )
+            result.append( { name, values[value] } );
+    };
+    addEnum( "Optimization", "Optimization", optimization, 4 );
+    addEnum( "UsePrecompiledHeader", "PrecompiledHeader", pchUsage, 4 );
+    addEnum( "CompileAs", "CompileAs", compileAs, 3 );
+    addEnum( "WarningLevel", "WarningLevel", warningLevel, 5 );
+    addEnum( "RuntimeLibrary", "RuntimeLibrary", runtimeLibrary, 4 );
+    return result;
+}
+
+void parseVcxPropertyGroup( MsvcProjectConfig & result, QXmlStreamReader & reader )
+{
+    MSVC_TRACE_SPAN( "config parse" );
+
+    static const QPair<const char *, MsvcProjectConfig::TargetType> configurationType[] =
+    {
+        { "Application", MsvcProjectConfig::Application },
+        { "DynamicLibrary", MsvcProjectConfig::DynamicLibrary },
+        { "StaticLibrary", MsvcProjectConfig::StaticLibrary },
+        { "Utility", MsvcProjectConfig::Generic },
+        { "Makefile", MsvcProjectConfig::Generic }
+    };
+    static const QPair<const char *, MsvcProjectConfig::CharacterSet> characterSet[] =
+    {
+        { "Unicode", MsvcProjectConfig::CharSetUnicode },
+        { "MultiByte", MsvcProjectConfig::CharSetMBCS }
+    };
+
+    while ( reader.readNextStartElement() )
+    {
+        const QStringRef name = reader.name();
+
+        if ( name == "ConfigurationType" )
+        {
+            result.configurationType = lookup( configurationType, reader.readElementText(), MsvcProjectConfig::Unknown );
+        }
+        else if ( name == "CharacterSet" )
+        {
+            result.characterSet = lookup( characterSet, reader.readElementText(), MsvcProjectConfig::CharSetNotSet );
+        }
+        else if ( name == "WholeProgramOptimization" )
+        {
+            result.wholeProgramOptimization = isTrue( reader.readElementText() );
+        }
+        else if ( name == "LinkIncremental" )
+        {
+            result.linkIncremental = isTrue( reader.readElementText() );
+        }
+        else if ( name == "OutDir" )
+        {
+            result.outputDirectory = reader.readElementText();
+        }
+        else if ( name == "IntDir" )
+        {
+            result.intermediateDirectory = reader.readElementText();
+        }
+        else if ( name == "TargetName" )
+        {
+            result.targetName = reader.readElementText();
+        }
+        else if ( name == "TargetExt" )
+        {
+            result.targetExtension = reader.readElementText();
+        }
+        else
+        {
+            reader.skipCurrentElement();
+        }
+    }
+}
+
+void parseVcxItemDefinitionGroup( MsvcProjectConfig & result, QXmlStreamReader & reader )
+{
+    MSVC_TRACE_SPAN( "config parse" );
+
+    while ( reader.readNextStartElement() )
+    {
+        if ( reader.name() == "ClCompile" )
+        {
+            parseVcxCompilerTool( result, reader );
+        }
+        else if ( reader.name() == "Link" || reader.name() == "Lib" )
+        {
+            parseVcxLinkerTool( result, reader );
+        }
+        else
+        {
+            reader.skipCurrentElement();
+        }
+    }
+}
+
+void finalizeVcxConfig( MsvcProjectConfig & config )
+{
+    // MSBuild defaults, see Microsoft.Cpp.Default.props
+    const QString platformDir = config.targetArchitecture.compare( "Win32", Qt::CaseInsensitive ) == 0 ?
+                                QString() :
+                                "$(Platform)\\";
+
+    if ( config.outputDirectory.isEmpty() )
+        config.outputDirectory = "$(SolutionDir)" + platformDir + "$(Configuration)\\";
+
+    if ( config.intermediateDirectory.isEmpty() )
+        config.intermediateDirectory = platformDir + "$(Configuration)\\";
+
+    const QString targetName = config.targetName.isEmpty() ?
+                               QStringLiteral("$(ProjectName)") :
+                               config.targetName;
+    const QString targetExt = config.targetExtension.isEmpty() ?
+                              getDefaultOutputExtension( config.configurationType ) :
+                              config.targetExtension;
+
+    if ( config.outputFile.isEmpty() )
+        config.outputFile = "$(OutDir)$(TargetName)$(TargetExt)";
+
+    if ( config.pchThrough.isEmpty() )
+        config.pchThrough = "stdafx.h";
+
+    if ( config.pchOutputFile.isEmpty() )
+        config.pchOutputFile = "$(IntDir)$(TargetName).pch";
+
+    // Those depend on the output file in vcproj, resolve them here to avoid the recursion.
+    for ( QString * value : { &config.outputFile, &config.pchOutputFile } )
+    {
+        value->replace( "$(TargetName)", targetName, Qt::CaseInsensitive );
+        value->replace( "$(TargetExt)", targetExt, Qt::CaseInsensitive );
+    }
+}
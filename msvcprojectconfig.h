@@ -22,8 +22,13 @@
 #define MSVCPROJECTCONFIG_H
 
 #include <QHash>
+#include <QPair>
 #include <QString>
+#include <QStringList>
+#include <QVector>
 
+class QStringRef;
+class QXmlStreamAttributes;
 class QXmlStreamReader;
 
 struct MsvcProjectConfig
@@ -52,6 +57,20 @@ struct MsvcProjectConfig
         MultiThreadedDebugDll,
     };
     
+    enum PchUsage
+    {
+        PchNotUsing,
+        PchCreate,
+        PchUse
+    };
+
+    enum CompileAs
+    {
+        CompileAsDefault,   // by extension
+        CompileAsC,         // /TC
+        CompileAsCpp        // /TP
+    };
+
     enum SubSystem
     {
         SubSystemNotSet,
@@ -64,6 +83,9 @@ struct MsvcProjectConfig
     QString         configurationName;
     QString         targetArchitecture;
     QString         outputDirectory;
+    QString         intermediateDirectory;
+    QString         targetName;
+    QString         targetExtension;
     TargetType      configurationType;
     CharacterSet    characterSet;
     bool            wholeProgramOptimization;
@@ -74,8 +96,16 @@ struct MsvcProjectConfig
     QStringList             additionalIncludeDirectories;
     QHash<QString,QString>  preprocessorDefines;
     RuntimeLibrary          rtLibrary;
-    bool                    usepch;
+    PchUsage                pchUsage;
+    QString                 pchThrough;     // header the PCH stops at, as written in the sources
+    QString                 pchOutputFile;  // the .pch file
     int                     warningLevel;
+    QStringList             forcedIncludeFiles;
+    QStringList             undefines;
+    QString                 languageStandard;   // cl /std: value for C++, like "c++17", empty for the default
+    QString                 cLanguageStandard;  // the same for C, like "c11"
+    QStringList             conformanceFlags;   // /Zc: and /permissive- switches, as cl takes them
+    CompileAs               compileAs;
     
     //VCLinkerTool
     bool                    linkIncremental;
@@ -83,6 +113,43 @@ struct MsvcProjectConfig
     QString                 outputFile;
 };
 
+/**
+ * @brief Parse a vcproj \<Configuration\> tag.
+ */
 MsvcProjectConfig parseConfig( QXmlStreamReader & );
 
+/**
+ * @brief Returns "Configuration|Platform" from a vcxproj Condition attribute,
+ * or an empty string if the condition is not about the configuration.
+ */
+QString parseVcxCondition( QStringRef const & condition );
+
+/**
+ * @brief Parse a vcxproj \<PropertyGroup\> into @p config.
+ */
+void parseVcxPropertyGroup( MsvcProjectConfig & config, QXmlStreamReader & );
+
+/**
+ * @brief Parse a vcxproj \<ItemDefinitionGroup\> into @p config.
+ */
+void parseVcxItemDefinitionGroup( MsvcProjectConfig & config, QXmlStreamReader & );
+
+/**
+ * @brief Apply the ClCompile metadata @p name of a vcxproj to @p config, like
+ * an item does to the settings of its project. A list without %(name) replaces
+ * the inherited one. Returns false for the metadata we do not know.
+ */
+bool applyVcxCompilerSetting( MsvcProjectConfig & config, QString const & name, QString const & value );
+
+/**
+ * @brief The attributes of a vcproj VCCLCompilerTool \<Tool\> as ClCompile metadata,
+ * for applyVcxCompilerSetting().
+ */
+QVector< QPair<QString, QString> > vcCompilerToolSettings( QXmlStreamAttributes const & attributes );
+
+/**
+ * @brief Fill in what MSBuild would default once the whole vcxproj is read.
+ */
+void finalizeVcxConfig( MsvcProjectConfig & config );
+
 #endif //MSVCPROJECTCONFIG_H
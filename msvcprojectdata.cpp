@@ -0,0 +1,280 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "msvcprojectdata.h"
+#include "msvcfileregistry.h"
+#include "msvcmodelitems.h"
+
+#include <QDir>
+
+MsvcProjectData::MsvcProjectData( KDevelop::Path const & projectPath ) :
+    m_projectPath( projectPath )
+{
+}
+
+MsvcProjectData::StringId MsvcProjectData::intern( QStringRef const & s )
+{
+    const int offset = m_pool.size();
+    m_pool.append( s );
+    return commit( offset );
+}
+
+MsvcProjectData::StringId MsvcProjectData::commit( int offset )
+{
+    // The string was appended to the pool already, take it back if we have it
+    const QStringRef added( &m_pool, offset, m_pool.size() - offset );
+
+    auto it = m_stringIndex.constFind( added );
+    if ( it != m_stringIndex.constEnd() )
+    {
+        m_pool.truncate( offset );
+        return *it;
+    }
+
+    const StringId id = m_strings.size();
+    m_strings.append( qMakePair( offset, added.size() ) );
+    m_stringIndex.insert( added, id );
+    return id;
+}
+
+QStringRef MsvcProjectData::stringRef( StringId id ) const
+{
+    const QPair<int, int> & s = m_strings.at( id );
+    return QStringRef( &m_pool, s.first, s.second );
+}
+
+int MsvcProjectData::addFilter( QStringRef const & name, int parent )
+{
+    Q_ASSERT( parent < m_filters.size() );
+
+    const Filter filter = { intern( name ), parent };
+    m_filters.append( filter );
+
+    if ( !m_filterIndex.contains( filter.name ) )
+        m_filterIndex.insert( filter.name, m_filters.size() - 1 );
+
+    return m_filters.size() - 1;
+}
+
+int MsvcProjectData::findFilter( QStringRef const & name ) const
+{
+    if ( !m_stringIndex.isEmpty() )
+    {
+        auto it = m_stringIndex.constFind( name );
+        return it == m_stringIndex.constEnd() ? int(NoParent) : m_filterIndex.value( *it, NoParent );
+    }
+
+    // Squeezed, no index left
+    for ( int i = 0; i < m_filters.size(); ++i )
+    {
+        if ( stringRef( m_filters[i].name ) == name )
+            return i;
+    }
+    return NoParent;
+}
+
+int MsvcProjectData::addFile( QStringRef const & path, int parent, ItemType type )
+{
+    Q_ASSERT( parent < m_filters.size() );
+
+    const int offset = m_pool.size();
+    m_pool.append( path );
+
+    QChar * data = m_pool.data();
+    for ( int i = offset; i < m_pool.size(); ++i )
+    {
+        if ( data[i] == '\\' )
+            data[i] = '/';
+    }
+
+    const File file = { commit( offset ), parent, type };
+    m_files.append( file );
+    return m_files.size() - 1;
+}
+
+MsvcProjectData::ItemType MsvcProjectData::itemType( QStringRef const & element )
+{
+    if ( element == "ClCompile" )
+        return CompileItem;
+    if ( element == "ClInclude" )
+        return IncludeItem;
+    if ( element == "ResourceCompile" )
+        return ResourceItem;
+    if ( element == "Text" )
+        return TextItem;
+    return OtherItem;
+}
+
+void MsvcProjectData::addFileSetting( int file, QString const & configuration, QString const & name, QString const & value )
+{
+    Q_ASSERT( file < m_files.size() );
+
+    const FileSetting setting = { file,
+                                  configuration.isEmpty() ? StringId(NoString) : intern( configuration ),
+                                  intern( name ),
+                                  intern( value ) };
+    m_fileSettings.append( setting );
+}
+
+QHash< int, QVector<MsvcProjectData::FileSetting> > MsvcProjectData::fileSettings( QString const & configuration ) const
+{
+    QHash< int, QVector<FileSetting> > result;
+    for ( const FileSetting & setting : m_fileSettings )
+    {
+        if ( setting.configuration == NoString ||
+             stringRef( setting.configuration ).compare( configuration, Qt::CaseInsensitive ) == 0 )
+        {
+            result[setting.file] << setting;
+        }
+    }
+    return result;
+}
+
+bool MsvcProjectData::isExcludedFromBuild( QVector<FileSetting> const & settings ) const
+{
+    // The last one wins, like MSBuild metadata
+    bool result = false;
+    for ( const FileSetting & setting : settings )
+    {
+        if ( stringRef( setting.name ) == QLatin1String("ExcludedFromBuild") )
+            result = stringRef( setting.value ).compare( QLatin1String("true"), Qt::CaseInsensitive ) == 0;
+    }
+    return result;
+}
+
+KDevelop::Path MsvcProjectData::filePath( int file ) const
+{
+    const QString path = string( m_files.at( file ).path );
+
+    if ( QDir::isAbsolutePath( path ) )
+        return KDevelop::Path( path );
+
+    return KDevelop::Path( m_projectPath.parent(), path );
+}
+
+QStringRef MsvcProjectData::fileName( int file ) const
+{
+    const QStringRef path = stringRef( m_files.at( file ).path );
+    return path.mid( path.lastIndexOf( '/' ) + 1 );
+}
+
+void MsvcProjectData::addProjectReference( QString const & path, QUuid const & uuid )
+{
+    QString fileName = path;
+    fileName.replace( '\\', '/' );
+
+    const KDevelop::Path resolved = QDir::isAbsolutePath( fileName ) ?
+                                    KDevelop::Path( fileName ) :
+                                    KDevelop::Path( m_projectPath.parent(), fileName );
+    m_references.append( { resolved, uuid } );
+}
+
+void MsvcProjectData::squeeze()
+{
+    m_stringIndex = {};
+    m_filterIndex = {};
+    m_pool.squeeze();
+    m_strings.squeeze();
+    m_filters.squeeze();
+    m_files.squeeze();
+    m_fileSettings.squeeze();
+    m_configurations.squeeze();
+    m_references.squeeze();
+}
+
+MsvcProjectItem * MsvcProjectData::createItem( KDevelop::IProject * project,
+                                               std::shared_ptr<MsvcFileRegistry> const & files ) const
+{
+    MsvcProjectItem * proj = new MsvcProjectItem( project, m_projectPath );
+    proj->setFileRegistry( files );
+
+    if ( !m_name.isEmpty() )
+        proj->rename( m_name );
+    proj->setUuid( m_uuid );
+    proj->setRootNamespace( m_rootNamespace );
+
+    // The configurations are read through the data, not copied into the item
+    proj->setProjectData( shared_from_this() );
+
+    // Parents always come before their children
+    QVector<KDevelop::ProjectBaseItem*> filters;
+    filters.reserve( m_filters.size() );
+    for ( const Filter & filter : m_filters )
+    {
+        KDevelop::ProjectBaseItem * parent = filter.parent == NoParent ? proj : filters[filter.parent];
+        filters.append( new MsvcFilterItem( project, string( filter.name ), parent ) );
+    }
+
+    QVector<int> fileCount( m_filters.size(), 0 );
+    for ( const File & file : m_files )
+    {
+        if ( file.parent != NoParent )
+            ++fileCount[file.parent];
+    }
+
+    QHash< int, QVector<int> > pending;
+    for ( int i = 0; i < m_files.size(); ++i )
+    {
+        const KDevelop::Path path = files ? files->add( filePath( i ), proj ) : filePath( i );
+
+        const int parent = m_files[i].parent;
+        if ( parent == NoParent )
+            new KDevelop::ProjectFileItem( project, path, proj );
+        else if ( fileCount[parent] > LazyFilterThreshold )
+            pending[parent].append( i );
+        else
+            new KDevelop::ProjectFileItem( project, path, filters[parent] );
+    }
+
+    for ( auto it = pending.constBegin(); it != pending.constEnd(); ++it )
+        static_cast<MsvcFilterItem*>( filters[it.key()] )->setPendingFiles( shared_from_this(), it.value() );
+
+    createTargetItem( proj );
+
+    return proj;
+}
+
+void MsvcProjectData::createTargetItem( MsvcProjectItem * proj )
+{
+    const QString projectName = proj->text();
+
+    MsvcProjectConfig config = proj->getCurrentConfig();
+    switch ( config.configurationType )
+    {
+        case MsvcProjectConfig::Unknown:
+        case MsvcProjectConfig::Generic:
+            new KDevelop::ProjectTargetItem( proj->project(),
+                                             projectName,
+                                             proj );
+            break;
+        default:
+        case MsvcProjectConfig::Application:
+            new MsvcExecutableTargetItem( proj->project(),
+                                          projectName,
+                                          proj );
+            break;
+        case MsvcProjectConfig::DynamicLibrary:
+        case MsvcProjectConfig::StaticLibrary:
+            new KDevelop::ProjectLibraryTargetItem( proj->project(),
+                                                    projectName,
+                                                    proj );
+            break;
+    }
+}
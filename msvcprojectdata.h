@@ -0,0 +1,224 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCPROJECTDATA_H
+#define MSVCPROJECTDATA_H
+
+#include <QHash>
+#include <QString>
+#include <QUuid>
+#include <QVector>
+
+#include <kdevplatform/util/path.h>
+
+#include <memory>
+
+#include "msvcprojectconfig.h"
+
+class MsvcFileRegistry;
+class MsvcProjectItem;
+
+namespace KDevelop
+{
+class IProject;
+}
+
+/**
+ * @brief Flat representation of a parsed project file.
+ *
+ * The parsers fill this instead of creating model items. All strings live in
+ * one pool, filters and files are index arrays with parent links, so a project
+ * is a handful of allocations that go away together. The model items are
+ * built from it with createItem(), which keeps a reference to the data, so
+ * it must be owned by a std::shared_ptr.
+ */
+class MsvcProjectData : public std::enable_shared_from_this<MsvcProjectData>
+{
+public:
+    typedef int StringId;
+
+    // Parent index of the filters and files directly below the project
+    enum { NoParent = -1 };
+
+    enum { LazyFilterThreshold = 1000 };
+
+    // The string of a per-file setting that applies to every configuration
+    enum { NoString = -1 };
+
+    // What MSBuild does with a file: the item it is listed as, or its extension in a vcproj
+    enum ItemType : quint8
+    {
+        OtherItem,
+        CompileItem,    // ClCompile
+        IncludeItem,    // ClInclude
+        ResourceItem,   // ResourceCompile
+        TextItem        // Text
+    };
+
+    struct Filter
+    {
+        StringId name;
+        int parent;
+    };
+
+    struct File
+    {
+        StringId path;  // as written in the project, with forward slashes
+        int parent;
+        ItemType type;
+    };
+
+    // A setting of one file overriding the project, like <ExcludedFromBuild> below a <ClCompile>
+    struct FileSetting
+    {
+        int file;
+        StringId configuration;  // "Debug|Win32", NoString for every configuration
+        StringId name;           // the vcxproj element name
+        StringId value;
+    };
+
+    // A project this one depends on, from <ProjectReference>
+    struct ProjectReference
+    {
+        KDevelop::Path path;
+        QUuid uuid;
+    };
+
+    explicit MsvcProjectData( KDevelop::Path const & projectPath );
+
+    KDevelop::Path projectPath() const { return m_projectPath; }
+
+    void setName( QString const & name ) { m_name = name; }
+    void setUuid( QUuid const & uuid ) { m_uuid = uuid; }
+    void setRootNamespace( QString const & ns ) { m_rootNamespace = ns; }
+
+    QString name() const { return m_name; }
+    QUuid uuid() const { return m_uuid; }
+    QString rootNamespace() const { return m_rootNamespace; }
+
+    /**
+     * @brief Add @p s to the pool, equal strings share the same id.
+     */
+    StringId intern( QStringRef const & s );
+    StringId intern( QString const & s ) { return intern( QStringRef( &s ) ); }
+
+    QStringRef stringRef( StringId id ) const;
+    QString string( StringId id ) const { return stringRef( id ).toString(); }
+
+    int addFilter( QStringRef const & name, int parent = NoParent );
+
+    /**
+     * @brief The first filter called @p name, NoParent if there is none.
+     */
+    int findFilter( QStringRef const & name ) const;
+
+    /**
+     * @brief Add a file, backslashes in @p path are converted.
+     */
+    int addFile( QStringRef const & path, int parent = NoParent, ItemType type = OtherItem );
+
+    /**
+     * @brief The type of the items called @p element in a vcxproj.
+     */
+    static ItemType itemType( QStringRef const & element );
+
+    /**
+     * @brief Add a setting of @p file, for the configuration @p configuration
+     * or for every configuration if it is empty.
+     */
+    void addFileSetting( int file, QString const & configuration, QString const & name, QString const & value );
+
+    /**
+     * @brief The settings of the files for @p configuration, by file, in the order they apply.
+     */
+    QHash< int, QVector<FileSetting> > fileSettings( QString const & configuration ) const;
+
+    /**
+     * @brief Returns true if the @p settings of a file, from fileSettings(), keep it out of the build.
+     */
+    bool isExcludedFromBuild( QVector<FileSetting> const & settings ) const;
+
+    void addConfiguration( MsvcProjectConfig const & config ) { m_configurations.append( config ); }
+
+    /**
+     * @brief Add a referenced project, @p path is resolved against the project directory.
+     */
+    void addProjectReference( QString const & path, QUuid const & uuid );
+
+    QVector<Filter> const & filters() const { return m_filters; }
+    QVector<File> const & files() const { return m_files; }
+    QVector<MsvcProjectConfig> const & configurations() const { return m_configurations; }
+    QVector<ProjectReference> const & projectReferences() const { return m_references; }
+
+    /**
+     * @brief The absolute path of a file, resolved against the project directory.
+     */
+    KDevelop::Path filePath( int file ) const;
+
+    /**
+     * @brief The last segment of the path of a file.
+     */
+    QStringRef fileName( int file ) const;
+
+    /**
+     * @brief Drop the lookup tables and the spare capacity once parsing is done.
+     */
+    void squeeze();
+
+    /**
+     * @brief Build the project item, its filters, files and target.
+     * Filters with more than LazyFilterThreshold files keep them unloaded,
+     * see MsvcFilterItem::setPendingFiles(). The files are registered in
+     * @p files when given and share their paths with the other projects.
+     * The caller takes ownership.
+     */
+    MsvcProjectItem * createItem( KDevelop::IProject * project,
+                                  std::shared_ptr<MsvcFileRegistry> const & files = nullptr ) const;
+
+    /**
+     * @brief Add the target item for the current configuration of @p proj.
+     */
+    static void createTargetItem( MsvcProjectItem * proj );
+
+private:
+    Q_DISABLE_COPY(MsvcProjectData)
+
+    // Intern the string appended to the pool at @p offset
+    StringId commit( int offset );
+
+    KDevelop::Path m_projectPath;
+    QString m_name;
+    QUuid m_uuid;
+    QString m_rootNamespace;
+
+    // The string pool: one buffer, strings are (offset, length) in it
+    QString m_pool;
+    QVector< QPair<int, int> > m_strings;
+    QHash< QStringRef, StringId > m_stringIndex;  // refers to m_pool
+
+    QVector<Filter> m_filters;
+    QHash< StringId, int > m_filterIndex;
+    QVector<File> m_files;
+    QVector<FileSetting> m_fileSettings;
+    QVector<MsvcProjectConfig> m_configurations;
+    QVector<ProjectReference> m_references;
+};
+
+#endif //MSVCPROJECTDATA_H
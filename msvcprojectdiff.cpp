@@ -0,0 +1,216 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "msvcprojectdiff.h"
+#include "msvcfileregistry.h"
+#include "msvcmodelitems.h"
+#include "msvcprojectdata.h"
+#include "msvctrace.h"
+#include "debug.h"
+
+#include <QSet>
+
+namespace
+{
+
+// Filters are keyed by their names from the project down, one per line.
+// Multi hashes: a project may list a file (or a filter) twice.
+void collectItems( KDevelop::ProjectBaseItem * item, QString const & key, KDevelop::Path const & projectFile,
+                   QMultiHash<QString, MsvcFilterItem*> & filters,
+                   QMultiHash<KDevelop::Path, KDevelop::ProjectFileItem*> & files )
+{
+    for ( KDevelop::ProjectBaseItem * child : item->children() )
+    {
+        if ( MsvcFilterItem * filter = dynamic_cast<MsvcFilterItem*>( child ) )
+        {
+            const QString childKey = key.isEmpty() ? filter->text() : key + '\n' + filter->text();
+            filters.insert( childKey, filter );
+            collectItems( filter, childKey, projectFile, filters, files );
+        }
+        else if ( KDevelop::ProjectFileItem * file = child->file() )
+        {
+            if ( file->path() != projectFile )
+                files.insert( file->path(), file );
+        }
+    }
+}
+
+void removeItem( KDevelop::ProjectBaseItem * item )
+{
+    item->parent()->removeRow( item->row() );
+}
+
+}
+
+MsvcProjectDiff::Result MsvcProjectDiff::apply( MsvcProjectItem * proj, std::shared_ptr<const MsvcProjectData> const & data )
+{
+    MSVC_TRACE_SPAN_DETAIL( "project diff", proj->text() );
+
+    Result result;
+    KDevelop::IProject * project = proj->project();
+    const std::shared_ptr<MsvcFileRegistry> registry = proj->fileRegistry();
+
+    const KDevelop::Path::List oldIncludes = proj->includeDirectories();
+    const QHash<QString,QString> oldDefines = proj->defines();
+    const QString oldArguments = proj->extraArguments( proj->path() );
+    const MsvcProjectConfig::TargetType oldType = proj->getCurrentConfig().configurationType;
+    const std::shared_ptr<const MsvcProjectData> oldData = proj->projectData();
+
+    if ( !data->name().isEmpty() && data->name() != proj->text() )
+        proj->rename( data->name() );
+    proj->setUuid( data->uuid() );
+    proj->setRootNamespace( data->rootNamespace() );
+    proj->setProjectData( data );
+
+    QMultiHash<QString, MsvcFilterItem*> oldFilters;
+    QMultiHash<KDevelop::Path, KDevelop::ProjectFileItem*> oldFiles;
+    collectItems( proj, QString(), proj->path(), oldFilters, oldFiles );
+
+    // Filters, parents come first
+    const QVector<MsvcProjectData::Filter> & newFilters = data->filters();
+    QVector<KDevelop::ProjectBaseItem*> filters;
+    QVector<QString> keys;
+    QSet<int> createdFilters;
+    filters.reserve( newFilters.size() );
+    keys.reserve( newFilters.size() );
+
+    for ( int i = 0; i < newFilters.size(); ++i )
+    {
+        const int parent = newFilters[i].parent;
+        const QString name = data->string( newFilters[i].name );
+        const QString key = parent == MsvcProjectData::NoParent ? name : keys[parent] + '\n' + name;
+
+        MsvcFilterItem * filter = oldFilters.take( key );
+        if ( !filter )
+        {
+            filter = new MsvcFilterItem( project, name, parent == MsvcProjectData::NoParent ? proj : filters[parent] );
+            createdFilters.insert( i );
+            ++result.addedFilters;
+        }
+
+        filters.append( filter );
+        keys.append( key );
+    }
+
+    // New crowded filters and the ones still unloaded keep their files pending
+    const QVector<MsvcProjectData::File> & newFiles = data->files();
+    QVector<int> fileCount( newFilters.size(), 0 );
+    for ( const MsvcProjectData::File & file : newFiles )
+    {
+        if ( file.parent != MsvcProjectData::NoParent )
+            ++fileCount[file.parent];
+    }
+
+    // Every file is looked up again, for the canonical path and the new ones
+    QHash< int, QVector<int> > pending;
+    QSet<KDevelop::Path> listed;
+    for ( int i = 0; i < newFiles.size(); ++i )
+    {
+        const int parentIndex = newFiles[i].parent;
+        KDevelop::ProjectBaseItem * parent = parentIndex == MsvcProjectData::NoParent ? proj : filters[parentIndex];
+        const KDevelop::Path path = registry ? registry->add( data->filePath( i ), proj ) : data->filePath( i );
+        listed.insert( path );
+
+        if ( parentIndex != MsvcProjectData::NoParent )
+        {
+            MsvcFilterItem * filter = static_cast<MsvcFilterItem*>( parent );
+            if ( filter->hasPendingFiles() ||
+                 ( createdFilters.contains( parentIndex ) && fileCount[parentIndex] > MsvcProjectData::LazyFilterThreshold ) )
+            {
+                pending[parentIndex].append( i );
+                continue;
+            }
+        }
+
+        KDevelop::ProjectFileItem * file = oldFiles.take( path );
+        if ( !file )
+        {
+            new KDevelop::ProjectFileItem( project, path, parent );
+            result.reparse << path;
+            ++result.addedFiles;
+        }
+        else if ( file->parent() != parent )
+        {
+            file->parent()->takeRow( file->row() );
+            parent->appendRow( file );
+            ++result.movedFiles;
+        }
+    }
+
+    for ( int i = 0; i < filters.size(); ++i )
+    {
+        MsvcFilterItem * filter = static_cast<MsvcFilterItem*>( filters[i] );
+        if ( pending.contains( i ) || filter->hasPendingFiles() )
+            filter->setPendingFiles( data, pending.value( i ) );
+    }
+
+    // What is left is gone, as an item at least: the files that became
+    // pending (or were listed twice) are still in the project
+    for ( KDevelop::ProjectFileItem * file : oldFiles )
+    {
+        if ( registry && !listed.contains( file->path() ) )
+            registry->remove( file->path(), proj );
+        removeItem( file );
+        ++result.removedFiles;
+    }
+
+    const QSet<MsvcFilterItem*> removedFilters = QSet<MsvcFilterItem*>::fromList( oldFilters.values() );
+    for ( MsvcFilterItem * filter : removedFilters )
+    {
+        // Nested ones go with their parent
+        if ( !removedFilters.contains( dynamic_cast<MsvcFilterItem*>( filter->parent() ) ) )
+            removeItem( filter );
+        ++result.removedFilters;
+    }
+
+    if ( proj->getCurrentConfig().configurationType != oldType )
+    {
+        for ( KDevelop::ProjectTargetItem * target : proj->targetList() )
+            removeItem( target );
+        MsvcProjectData::createTargetItem( proj );
+    }
+
+    // The unloaded files that are gone have no item, the old data knows them
+    if ( registry && oldData )
+    {
+        for ( int i = 0; i < oldData->files().size(); ++i )
+        {
+            const KDevelop::Path path = oldData->filePath( i );
+            if ( !listed.contains( path ) )
+                registry->remove( path, proj );
+        }
+    }
+
+    result.flagsChanged = proj->includeDirectories() != oldIncludes || proj->defines() != oldDefines ||
+                          proj->extraArguments( proj->path() ) != oldArguments;
+    if ( result.flagsChanged )
+    {
+        result.reparse.clear();
+        for ( int i = 0; i < newFiles.size(); ++i )
+            result.reparse << data->filePath( i );
+    }
+
+    qCDebug(KDEV_MSVC) << "Updated" << proj->text() << ":" << result.addedFilters << "filters added,"
+                       << result.removedFilters << "removed," << result.addedFiles << "files added,"
+                       << result.removedFiles << "removed," << result.movedFiles << "moved, flags changed:"
+                       << result.flagsChanged;
+
+    return result;
+}
@@ -0,0 +1,60 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCPROJECTDIFF_H
+#define MSVCPROJECTDIFF_H
+
+#include <kdevplatform/util/path.h>
+
+#include <memory>
+
+class MsvcProjectData;
+class MsvcProjectItem;
+
+/**
+ * @brief Brings a project item up to date with a new parse of its file.
+ *
+ * Filters are matched by their names from the project down, files by their
+ * path. Only the differences are inserted into, moved in or removed from the
+ * model, so the views keep their state and unchanged files stay as they are.
+ */
+class MsvcProjectDiff
+{
+public:
+    struct Result
+    {
+        int addedFilters = 0;
+        int removedFilters = 0;
+        int addedFiles = 0;
+        int removedFiles = 0;
+        int movedFiles = 0;
+        bool flagsChanged = false;
+
+        // Files to parse again: the new ones, or all of them when the flags changed
+        KDevelop::Path::List reparse;
+    };
+
+    /**
+     * @brief Apply @p data to @p proj, must run in the main thread.
+     */
+    static Result apply( MsvcProjectItem * proj, std::shared_ptr<const MsvcProjectData> const & data );
+};
+
+#endif //MSVCPROJECTDIFF_H
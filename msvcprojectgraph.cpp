@@ -0,0 +1,329 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "msvcprojectgraph.h"
+#include "msvcmodelitems.h"
+#include "msvcprojectdata.h"
+#include "msvctrace.h"
+
+#include <QSet>
+
+#include <algorithm>
+
+MsvcProjectGraph::MsvcProjectGraph( QList<MsvcProjectItem*> const & projects,
+                                    QHash< QUuid, QList<QUuid> > const & solutionDependencies ) :
+    m_words( ( projects.size() + 63 ) / 64 ),
+    m_projects( projects.toVector() )
+{
+    MSVC_TRACE_SPAN( "dependency graph" );
+
+    const int count = m_projects.size();
+    m_data.reserve( count );
+    m_edges.resize( count );
+
+    QHash<QUuid, int> byUuid;
+    QHash<KDevelop::Path, int> byPath;
+    for ( int i = 0; i < count; ++i )
+    {
+        MsvcProjectItem * proj = m_projects[i];
+        m_index.insert( proj, i );
+        m_data << proj->projectData();
+        byPath.insert( proj->path(), i );
+        if ( !proj->uuid().isNull() )
+            byUuid.insert( proj->uuid(), i );
+    }
+
+    auto addEdge = [this]( int from, int to )
+    {
+        if ( to >= 0 && !m_edges[from].contains( to ) )
+            m_edges[from] << to;
+    };
+
+    for ( int i = 0; i < count; ++i )
+    {
+        for ( const QUuid & dependency : solutionDependencies.value( m_projects[i]->uuid() ) )
+            addEdge( i, byUuid.value( dependency, -1 ) );
+
+        if ( !m_data[i] )
+            continue;
+
+        for ( const MsvcProjectData::ProjectReference & reference : m_data[i]->projectReferences() )
+        {
+            int to = byPath.value( reference.path, -1 );
+            if ( to < 0 && !reference.uuid.isNull() )
+                to = byUuid.value( reference.uuid, -1 );
+            addEdge( i, to );
+        }
+    }
+
+    computeOrder();
+    computeClosure();
+}
+
+bool MsvcProjectGraph::isBuiltFrom( QList<MsvcProjectItem*> const & projects ) const
+{
+    if ( projects.size() != m_projects.size() )
+        return false;
+
+    for ( int i = 0; i < projects.size(); ++i )
+    {
+        if ( projects[i] != m_projects[i] || projects[i]->projectData() != m_data[i] )
+            return false;
+    }
+    return true;
+}
+
+int MsvcProjectGraph::edgeCount() const
+{
+    int result = 0;
+    for ( const QVector<int> & edges : m_edges )
+        result += edges.size();
+    return result;
+}
+
+void MsvcProjectGraph::computeOrder()
+{
+    // Tarjan's strongly connected components, without recursion. A component
+    // is complete once everything it depends on is, so they come out
+    // dependencies first: that is the build order of the condensed graph.
+    const int count = m_projects.size();
+
+    QVector<int> index( count, -1 );
+    QVector<int> lowLink( count, 0 );
+    QVector<bool> onStack( count, false );
+    QVector<int> stack;
+    QVector< QPair<int, int> > calls;     // project, next edge to follow
+    int nextIndex = 0;
+
+    m_component.fill( -1, count );
+    m_components.clear();
+    m_order.clear();
+    m_order.reserve( count );
+
+    for ( int root = 0; root < count; ++root )
+    {
+        if ( index[root] >= 0 )
+            continue;
+
+        calls.append( qMakePair( root, 0 ) );
+        while ( !calls.isEmpty() )
+        {
+            const int current = calls.last().first;
+            int & edge = calls.last().second;
+
+            if ( edge == 0 && index[current] < 0 )
+            {
+                index[current] = lowLink[current] = nextIndex++;
+                stack << current;
+                onStack[current] = true;
+            }
+
+            if ( edge < m_edges[current].size() )
+            {
+                const int dependency = m_edges[current][edge++];
+                if ( index[dependency] < 0 )
+                    calls.append( qMakePair( dependency, 0 ) );
+                else if ( onStack[dependency] )
+                    lowLink[current] = qMin( lowLink[current], index[dependency] );
+                continue;
+            }
+
+            if ( lowLink[current] == index[current] )
+            {
+                QVector<int> component;
+                int member;
+                do
+                {
+                    member = stack.takeLast();
+                    onStack[member] = false;
+                    m_component[member] = m_components.size();
+                    component << member;
+                }
+                while ( member != current );
+
+                // Solution order inside a cycle
+                std::sort( component.begin(), component.end() );
+                m_order += component;
+                m_components << component;
+            }
+
+            calls.removeLast();
+            if ( !calls.isEmpty() )
+            {
+                const int caller = calls.last().first;
+                lowLink[caller] = qMin( lowLink[caller], lowLink[current] );
+            }
+        }
+    }
+}
+
+void MsvcProjectGraph::computeClosure()
+{
+    const int count = m_projects.size();
+    m_upstream.fill( 0, count * m_words );
+
+    // Components are in build order: what a component depends on outside of
+    // it is complete when it is reached, and all its projects share one row.
+    QVector<quint64> row( m_words );
+    for ( const QVector<int> & component : m_components )
+    {
+        row.fill( 0 );
+        for ( int member : component )
+        {
+            for ( int dependency : m_edges[member] )
+            {
+                row[ dependency / 64 ] |= quint64(1) << ( dependency % 64 );
+                if ( m_component[dependency] == m_component[member] )
+                    continue;
+
+                const quint64 * other = m_upstream.constData() + dependency * m_words;
+                for ( int w = 0; w < m_words; ++w )
+                    row[w] |= other[w];
+            }
+        }
+
+        for ( int member : component )
+            std::copy( row.constBegin(), row.constEnd(), m_upstream.begin() + member * m_words );
+    }
+
+    m_downstream.fill( 0, count * m_words );
+    for ( int i = 0; i < count; ++i )
+    {
+        for ( int w = 0; w < m_words; ++w )
+        {
+            for ( quint64 bits = m_upstream[ i * m_words + w ]; bits; bits &= bits - 1 )
+            {
+                int bit = 0;
+                while ( !( bits & ( quint64(1) << bit ) ) )
+                    ++bit;
+                set( m_downstream, w * 64 + bit, i );
+            }
+        }
+    }
+}
+
+QList<MsvcProjectItem*> MsvcProjectGraph::collect( QVector<quint64> const & rows, int row ) const
+{
+    QList<MsvcProjectItem*> result;
+    if ( row < 0 )
+        return result;
+
+    for ( int i : m_order )
+    {
+        if ( i != row && test( rows, row, i ) )
+            result << m_projects[i];
+    }
+    return result;
+}
+
+QList<MsvcProjectItem*> MsvcProjectGraph::dependencies( MsvcProjectItem const * proj ) const
+{
+    QList<MsvcProjectItem*> result;
+    const int index = indexOf( proj );
+    if ( index < 0 )
+        return result;
+
+    for ( int i : m_order )
+    {
+        if ( m_edges[index].contains( i ) )
+            result << m_projects[i];
+    }
+    return result;
+}
+
+QList<MsvcProjectItem*> MsvcProjectGraph::upstream( MsvcProjectItem const * proj ) const
+{
+    return collect( m_upstream, indexOf( proj ) );
+}
+
+QList<MsvcProjectItem*> MsvcProjectGraph::downstream( MsvcProjectItem const * proj ) const
+{
+    return collect( m_downstream, indexOf( proj ) );
+}
+
+bool MsvcProjectGraph::dependsOn( MsvcProjectItem const * proj, MsvcProjectItem const * dependency ) const
+{
+    const int from = indexOf( proj );
+    const int to = indexOf( dependency );
+    return from >= 0 && to >= 0 && test( m_upstream, from, to );
+}
+
+QList<MsvcProjectItem*> MsvcProjectGraph::affectedBy( MsvcProjectItem const * proj ) const
+{
+    QList<MsvcProjectItem*> result;
+    const int index = indexOf( proj );
+    if ( index < 0 )
+        return result;
+
+    for ( int i : m_order )
+    {
+        if ( i == index || test( m_downstream, index, i ) )
+            result << m_projects[i];
+    }
+    return result;
+}
+
+QList<MsvcProjectItem*> MsvcProjectGraph::buildOrder() const
+{
+    QList<MsvcProjectItem*> result;
+    result.reserve( m_order.size() );
+    for ( int i : m_order )
+        result << m_projects[i];
+    return result;
+}
+
+QList<MsvcProjectItem*> MsvcProjectGraph::sorted( QList<MsvcProjectItem*> const & projects ) const
+{
+    QSet<int> wanted;
+    QList<MsvcProjectItem*> unknown;
+    for ( MsvcProjectItem * proj : projects )
+    {
+        const int index = indexOf( proj );
+        if ( index < 0 )
+            unknown << proj;
+        else
+            wanted.insert( index );
+    }
+
+    QList<MsvcProjectItem*> result;
+    for ( int i : m_order )
+    {
+        if ( wanted.contains( i ) )
+            result << m_projects[i];
+    }
+    return result + unknown;
+}
+
+QList< QList<MsvcProjectItem*> > MsvcProjectGraph::cycles() const
+{
+    QList< QList<MsvcProjectItem*> > result;
+    for ( const QVector<int> & component : m_components )
+    {
+        const int first = component.front();
+        if ( component.size() == 1 && !m_edges[first].contains( first ) )
+            continue;
+
+        QList<MsvcProjectItem*> cycle;
+        for ( int member : component )
+            cycle << m_projects[member];
+        result << cycle;
+    }
+    return result;
+}
@@ -0,0 +1,137 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCPROJECTGRAPH_H
+#define MSVCPROJECTGRAPH_H
+
+#include <QHash>
+#include <QList>
+#include <QUuid>
+#include <QVector>
+
+#include <memory>
+
+class MsvcProjectData;
+class MsvcProjectItem;
+
+/**
+ * @brief The dependencies between the projects of a solution.
+ *
+ * Edges come from the ProjectDependencies sections of the solutions and from
+ * the project references of the project files. Projects get dense indices
+ * and the transitive closure is kept as one bit row per project, in both
+ * directions, so every query is a few word operations or one pass over the
+ * projects. Lists are returned in build order, dependencies first. Projects
+ * depending on each other form one strongly connected component; components
+ * are ordered after everything they depend on, and the projects of one
+ * component share their dependencies.
+ */
+class MsvcProjectGraph
+{
+public:
+    MsvcProjectGraph() = default;
+
+    /**
+     * @brief Build the graph of @p projects.
+     * @p solutionDependencies maps a project uuid to the uuids it depends on.
+     */
+    MsvcProjectGraph( QList<MsvcProjectItem*> const & projects,
+                      QHash< QUuid, QList<QUuid> > const & solutionDependencies );
+
+    /**
+     * @brief Returns true if the graph was built from these projects, as they are parsed now.
+     */
+    bool isBuiltFrom( QList<MsvcProjectItem*> const & projects ) const;
+
+    int size() const { return m_projects.size(); }
+    int edgeCount() const;
+
+    /**
+     * @brief The projects @p proj depends on directly.
+     */
+    QList<MsvcProjectItem*> dependencies( MsvcProjectItem const * proj ) const;
+
+    /**
+     * @brief Everything @p proj depends on, directly or not, without @p proj itself.
+     */
+    QList<MsvcProjectItem*> upstream( MsvcProjectItem const * proj ) const;
+
+    /**
+     * @brief Everything depending on @p proj, directly or not, without @p proj itself.
+     */
+    QList<MsvcProjectItem*> downstream( MsvcProjectItem const * proj ) const;
+
+    /**
+     * @brief Returns true if @p proj depends on @p dependency, directly or not.
+     */
+    bool dependsOn( MsvcProjectItem const * proj, MsvcProjectItem const * dependency ) const;
+
+    /**
+     * @brief What must be rebuilt when @p proj changes: itself and its downstream projects.
+     */
+    QList<MsvcProjectItem*> affectedBy( MsvcProjectItem const * proj ) const;
+
+    /**
+     * @brief All the projects, dependencies first.
+     */
+    QList<MsvcProjectItem*> buildOrder() const;
+
+    /**
+     * @brief @p projects sorted in build order, those not in the graph last.
+     */
+    QList<MsvcProjectItem*> sorted( QList<MsvcProjectItem*> const & projects ) const;
+
+    /**
+     * @brief The groups of projects depending on each other.
+     */
+    QList< QList<MsvcProjectItem*> > cycles() const;
+
+private:
+    int indexOf( MsvcProjectItem const * proj ) const { return m_index.value( proj, -1 ); }
+
+    bool test( QVector<quint64> const & rows, int row, int column ) const
+    {
+        return rows[ row * m_words + column / 64 ] & ( quint64(1) << ( column % 64 ) );
+    }
+
+    void set( QVector<quint64> & rows, int row, int column )
+    {
+        rows[ row * m_words + column / 64 ] |= quint64(1) << ( column % 64 );
+    }
+
+    // The projects whose bit is set in @p row of @p rows but @p row itself, in build order
+    QList<MsvcProjectItem*> collect( QVector<quint64> const & rows, int row ) const;
+
+    void computeOrder();
+    void computeClosure();
+
+    int m_words = 0;
+    QVector<MsvcProjectItem*> m_projects;
+    QVector< std::shared_ptr<const MsvcProjectData> > m_data;
+    QHash<MsvcProjectItem const *, int> m_index;
+    QVector< QVector<int> > m_edges;
+    QVector<int> m_order;
+    QVector<int> m_component;
+    QVector< QVector<int> > m_components;
+    QVector<quint64> m_upstream;
+    QVector<quint64> m_downstream;
+};
+
+#endif //MSVCPROJECTGRAPH_H
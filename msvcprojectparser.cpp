@@ -19,68 +19,68 @@
  */
 
 #include "msvcprojectparser.h"
+#include "msvccompileflags.h"
+#include "msvcdirectorycache.h"
+#include "msvcinputfile.h"
+#include "msvcparsecache.h"
+#include "msvctrace.h"
 #include "msvcmodelitems.h"
 #include "debug.h"
 
-#include <QFile>
 #include <QXmlStreamReader>
 
-namespace
+std::shared_ptr< MsvcProjectData > MsvcProjectParser::parseData()
 {
-    
-// Not sure if we have something like this already..
-template<class Predicate>
-KDevelop::ProjectBaseItem * findItem( KDevelop::ProjectBaseItem * root, Predicate pred )
-{
-    QList<KDevelop::ProjectBaseItem*> children = root->children();
-    
-    auto it = std::find_if( children.begin(), children.end(), pred );
-    
-    if ( it != children.end() )
-        return *it;
-    
-    for ( KDevelop::ProjectBaseItem * item : children )
+    if (! projectPath().isLocalFile() )
     {
-        if ( auto result = findItem(item, pred) )
-            return result;
+        qCWarning(KDEV_MSVC) << "Reading non-local file is not supported yet. (" << projectPath() << ")";
+        return nullptr;
     }
-    
-    return nullptr;
-}
-
-}
 
-void MsvcProjectParser::run()
-{
-    if (! projectPath().isLocalFile() )
+    // Taken before reading, a change while we parse invalidates the entry
+    const QDateTime modified = m_parses ? MsvcParseCache::lastModified( projectPath() ) : QDateTime();
+    if ( m_parses && m_reuseParse )
     {
-        qCWarning(KDEV_MSVC) << "Reading non-local file is not supported yet. (" << projectPath() << ")";
-        m_promise.reportCanceled();
-        m_promise.reportFinished();
-        return;
+        if ( std::shared_ptr< MsvcProjectData > cached = m_parses->find( projectPath(), modified ) )
+            return cached;
     }
     
-    QFile file( projectPath().toLocalFile() );
-    if (! file.open(QFile::ReadOnly) )
+    MsvcInputFile file( projectPath().toLocalFile() );
+    if (! file.open() )
     {
         qCDebug(KDEV_MSVC) << "Cannot to open " << projectPath().toLocalFile();
-        m_promise.reportCanceled();
-        m_promise.reportFinished();
-        return;
+        return nullptr;
     }
     
     qCDebug(KDEV_MSVC) << "Reading: " << file.fileName();
     
-    QXmlStreamReader reader(&file);
+    // Straight from the mapping, the reader decodes as it goes
+    QXmlStreamReader reader( file.data() );
     
-    auto result = parse(reader);
-    if (!result)
+    std::shared_ptr< MsvcProjectData > data = std::make_shared< MsvcProjectData >( projectPath() );
+    if ( !parse( reader, *data ) )
+        return nullptr;
+
+    data->squeeze();
+
+    // What the wildcards match is not in the project file
+    if ( m_parses && !m_listedDirectories )
+        m_parses->insert( projectPath(), modified, data );
+    return data;
+}
+
+void MsvcProjectParser::run()
+{
+    std::shared_ptr< MsvcProjectData > data = parseData();
+    if ( !data )
     {
         m_promise.reportCanceled();
         m_promise.reportFinished();
         return;
     }
 
+    std::unique_ptr< MsvcProjectItem > result( data->createItem( project(), m_files ) );
+
     // Add the project file itself
     new KDevelop::ProjectFileItem( result->project(), projectPath(), result.get() );
     
@@ -88,22 +88,28 @@ void MsvcProjectParser::run()
     m_promise.reportFinished();
 }
 
-std::unique_ptr< MsvcProjectItem > MsvcVcProjParser::parse(QXmlStreamReader & reader)
+std::shared_ptr<MsvcDirectoryCache> MsvcProjectParser::directoryCache()
 {
-    std::unique_ptr< MsvcProjectItem > result( new MsvcProjectItem(project(), projectPath() ) );
+    m_listedDirectories = true;
+    if ( !m_directories )
+        m_directories = std::make_shared<MsvcDirectoryCache>();
+    return m_directories;
+}
 
+bool MsvcVcProjParser::parse(QXmlStreamReader & reader, MsvcProjectData & data)
+{
     for ( ;reader.readNextStartElement(); reader.skipCurrentElement() )
     {
         if ( reader.name().compare("VisualStudioProject", Qt::CaseInsensitive) == 0 )
         {
-            parseVisualStudioProject(reader, result.get());
+            parseVisualStudioProject(reader, data);
         }
     }
     
-    return result;
+    return true;
 }
 
-void MsvcVcProjParser::parseFileList(KDevelop::ProjectBaseItem* parent, QXmlStreamReader& reader) const
+void MsvcVcProjParser::parseFileList(MsvcProjectData & data, int parent, QXmlStreamReader& reader) const
 {
     while( reader.readNextStartElement() )
     {
@@ -112,40 +118,60 @@ void MsvcVcProjParser::parseFileList(KDevelop::ProjectBaseItem* parent, QXmlStre
         
         if ( reader.name().compare("File", Qt::CaseInsensitive) == 0 )
         {
-            QString relativePath = reader.attributes().value("RelativePath").toString().replace('\\', '/');
+            // The tool is picked by extension in a vcproj
+            const QStringRef path = reader.attributes().value("RelativePath");
+            const int file = data.addFile( path, parent,
+                                           MsvcCompileFlags::isCompilable( KDevelop::Path( path.toString() ) ) ?
+                                           MsvcProjectData::CompileItem : MsvcProjectData::OtherItem );
+
+            while ( reader.readNextStartElement() )
+            {
+                if ( reader.name() != "FileConfiguration" )
+                {
+                    reader.skipCurrentElement();
+                    continue;
+                }
 
-            const KDevelop::Path path (projectPath().parent(), relativePath );
+                const QXmlStreamAttributes attributes = reader.attributes();
+                const QString configuration = attributes.value("Name").toString();
+                if ( attributes.hasAttribute("ExcludedFromBuild") )
+                {
+                    data.addFileSetting( file, configuration, QStringLiteral("ExcludedFromBuild"),
+                                         attributes.value("ExcludedFromBuild").toString() );
+                }
 
-            new KDevelop::ProjectFileItem(parent->project(), path, parent );
-            
-            reader.skipCurrentElement();
+                // The compiler settings of the file, the other tools are not ours to run
+                while ( reader.readNextStartElement() )
+                {
+                    if ( reader.name() == "Tool" && reader.attributes().value("Name") == "VCCLCompilerTool" )
+                    {
+                        for ( const auto & setting : vcCompilerToolSettings( reader.attributes() ) )
+                            data.addFileSetting( file, configuration, setting.first, setting.second );
+                    }
+                    reader.skipCurrentElement();
+                }
+            }
         }
         else if ( reader.name().compare("Filter", Qt::CaseInsensitive) == 0 )
         {
-            MsvcFilterItem * filter = new MsvcFilterItem( parent->project(),
-                                                          reader.attributes().value("Name").toString(),
-                                                          parent );
+            const int filter = data.addFilter( reader.attributes().value("Name"), parent );
             
-            parseFileList( filter, reader );
+            parseFileList( data, filter, reader );
         }
     }
 }
 
-void MsvcVcProjParser::parseVisualStudioProject(QXmlStreamReader& reader, MsvcProjectItem * proj)
+void MsvcVcProjParser::parseVisualStudioProject(QXmlStreamReader& reader, MsvcProjectData & data)
 {
-    QString projectName = reader.attributes().value("Name").toString();
-    QUuid projectUuid = reader.attributes().value("ProjectGUID").toString();
-    QString rootNameSpace = reader.attributes().value("RootNamespace").toString();
-    
-    proj->rename( projectName );
-    proj->setUuid( projectUuid );
-    proj->setRootNamespace( rootNameSpace );
+    data.setName( reader.attributes().value("Name").toString() );
+    data.setUuid( QUuid( reader.attributes().value("ProjectGUID").toString() ) );
+    data.setRootNamespace( reader.attributes().value("RootNamespace").toString() );
    
     while ( reader.readNextStartElement() )
     {
         if ( reader.name().compare("Files", Qt::CaseInsensitive) == 0 )
         {
-            parseFileList( proj, reader );
+            parseFileList( data, MsvcProjectData::NoParent, reader );
         }
         else if ( reader.name() == "Configurations" )
         {
@@ -153,7 +179,7 @@ void MsvcVcProjParser::parseVisualStudioProject(QXmlStreamReader& reader, MsvcPr
             {
                 if ( reader.name() == "Configuration" )
                 {
-                    proj->addConfiguration( parseConfig( reader ) );
+                    data.addConfiguration( parseConfig( reader ) );
                 }
                 else
                 {
@@ -161,64 +187,265 @@ void MsvcVcProjParser::parseVisualStudioProject(QXmlStreamReader& reader, MsvcPr
                 }
             }
         }
+        else if ( reader.name() == "References" )
+        {
+            for ( ; reader.readNextStartElement(); reader.skipCurrentElement() )
+            {
+                if ( reader.name() == "ProjectReference" )
+                {
+                    const QXmlStreamAttributes attributes = reader.attributes();
+                    data.addProjectReference( attributes.value("RelativePathToProject").toString(),
+                                              QUuid( attributes.value("ReferencedProjectIdentifier").toString() ) );
+                }
+            }
+        }
         else
         {
             reader.skipCurrentElement();
         }
     }
-    
-    MsvcProjectConfig config = proj->getCurrentConfig();
-    switch ( config.configurationType )
-    {
-        case MsvcProjectConfig::Unknown:
-        case MsvcProjectConfig::Generic:
-            new KDevelop::ProjectTargetItem( proj->project(),
-                                             projectName,
-                                             proj );
-        default:
-        case MsvcProjectConfig::Application:
-            new MsvcExecutableTargetItem( proj->project(),
-                                          projectName,
-                                          proj );
-            break;
-        case MsvcProjectConfig::DynamicLibrary:
-        case MsvcProjectConfig::StaticLibrary:
-            new KDevelop::ProjectLibraryTargetItem( proj->project(),
-                                                    projectName,
-                                                    proj );
-            break;
-    }
 }
 
-std::unique_ptr< MsvcProjectItem > MsvcVcxProjParser::parse( QXmlStreamReader & )
+bool MsvcVcxProjParser::parse( QXmlStreamReader & reader, MsvcProjectData & data )
 {
-    std::unique_ptr< MsvcProjectItem > result( new MsvcProjectItem(project(), projectPath() ) );
+    QStringList items;
+    m_items.clear();
+    while ( reader.readNextStartElement() )
+    {
+        if ( reader.name() == "Project" )
+        {
+            parseProjectFile( reader, data, items );
+        }
+        else
+        {
+            reader.skipCurrentElement();
+        }
+    }
 
-    // For now, completely ignore the vcxproj, focus on the filter file
+    // The filter file has the tree structure we want to show
     KDevelop::Path filterFileName = projectPath();
     filterFileName.setLastPathSegment( filterFileName.lastPathSegment() + ".filters" );
     
     if ( !filterFileName.isLocalFile() )
     {
         qCWarning(KDEV_MSVC) << "Cannot parse non-local file: (" << filterFileName << ")";
-        return {};
+        return false;
     }
     
-    QFile filterFile( filterFileName.toLocalFile() );
-    if ( !filterFile.open(QFile::ReadOnly) )
+    MsvcInputFile filterFile( filterFileName.toLocalFile() );
+    if ( !filterFile.open() )
     {
-        qCWarning(KDEV_MSVC) << "Cannot open: " << filterFile.fileName();
-        return {};
+        qCDebug(KDEV_MSVC) << "No filter file for" << projectPath() << ", using a flat file list";
+        
+        for ( const QString & relativePath : items )
+        {
+            addItemFile( data, relativePath, MsvcProjectData::NoParent, MsvcProjectData::OtherItem );
+        }
+        return true;
     }
     
     qCDebug(KDEV_MSVC) << "Parsing filter file: " << filterFile.fileName();
-    QXmlStreamReader filterReader( &filterFile );
-    parseFilterFile( filterReader, result.get() );
+    QXmlStreamReader filterReader( filterFile.data() );
+    parseFilterFile( filterReader, data );
     
+    return true;
+}
+
+void MsvcVcxProjParser::parseProjectFile( QXmlStreamReader & reader, MsvcProjectData & data, QStringList & items )
+{
+    QHash< QString, MsvcProjectConfig > configs;
+    QStringList configNames;
+
+    auto configFor = [&configs, &configNames]( QString const & nameAndArch ) -> MsvcProjectConfig &
+    {
+        if ( !configs.contains( nameAndArch ) )
+        {
+            MsvcProjectConfig config = {};
+            config.configurationName = nameAndArch.section('|', 0, 0);
+            config.targetArchitecture = nameAndArch.section('|', 1);
+            configs.insert( nameAndArch, config );
+            configNames << nameAndArch;
+        }
+        return configs[ nameAndArch ];
+    };
+
+    while ( reader.readNextStartElement() )
+    {
+        const QString condition = parseVcxCondition( reader.attributes().value("Condition") );
+
+        if ( reader.name() == "PropertyGroup" )
+        {
+            if ( reader.attributes().value("Label") == "Globals" )
+            {
+                parseGlobals( reader, data );
+            }
+            else if ( !condition.isEmpty() )
+            {
+                parseVcxPropertyGroup( configFor(condition), reader );
+            }
+            else
+            {
+                reader.skipCurrentElement();
+            }
+        }
+        else if ( reader.name() == "ItemDefinitionGroup" && !condition.isEmpty() )
+        {
+            parseVcxItemDefinitionGroup( configFor(condition), reader );
+        }
+        else if ( reader.name() == "ItemGroup" )
+        {
+            while ( reader.readNextStartElement() )
+            {
+                const QStringRef name = reader.name();
+
+                if ( name == "ProjectConfiguration" )
+                {
+                    configFor( reader.attributes().value("Include").toString() );
+                }
+                else if ( name == "ClInclude" || 
+                          name == "ClCompile" || 
+                          name == "ResourceCompile" || 
+                          name == "Text" )
+                {
+                    const QXmlStreamAttributes attributes = reader.attributes();
+                    const QStringList files = expandItem( attributes.value("Include").toString(),
+                                                          attributes.value("Exclude").toString(), false );
+                    items << files;
+                    parseItemMetadata( reader, MsvcProjectData::itemType( name ), files );
+                    continue;
+                }
+                else if ( name == "ProjectReference" )
+                {
+                    parseProjectReference( reader, data );
+                    continue;
+                }
+                reader.skipCurrentElement();
+            }
+        }
+        else
+        {
+            reader.skipCurrentElement();
+        }
+    }
+
+    for ( const QString & name : configNames )
+    {
+        MsvcProjectConfig & config = configs[ name ];
+        finalizeVcxConfig( config );
+        data.addConfiguration( config );
+    }
+}
+
+QStringList MsvcVcxProjParser::expandItem( QString const & include, QString const & exclude, bool inFilterFile )
+{
+    if ( !MsvcDirectoryCache::hasWildcards( include ) && exclude.isEmpty() && !include.contains( ';' ) )
+        return { include };
+
+    const QPair<QString, QString> key( include, exclude );
+    auto it = m_expanded.constFind( key );
+    if ( it != m_expanded.constEnd() )
+        return *it;
+
+    // The filter file repeats the item of the project, usually without its Exclude
+    if ( inFilterFile && exclude.isEmpty() )
+    {
+        auto projectItem = m_projectItems.constFind( include );
+        if ( projectItem != m_projectItems.constEnd() )
+            return m_expanded.value( *projectItem );
+    }
+
+    const QStringList result = directoryCache()->expand( projectPath().parent().toLocalFile(), include, exclude );
+    m_expanded.insert( key, result );
+    if ( !inFilterFile )
+        m_projectItems.insert( include, key );
     return result;
 }
 
-void MsvcVcxProjParser::parseFilterFile(QXmlStreamReader & reader, MsvcProjectItem * result)
+QString MsvcVcxProjParser::itemKey( QString const & relativePath )
+{
+    return QString( relativePath ).replace( '\\', '/' ).toLower();
+}
+
+void MsvcVcxProjParser::parseItemMetadata( QXmlStreamReader & reader, MsvcProjectData::ItemType type,
+                                           QStringList const & files )
+{
+    // Only what the compiler is run with matters, as ClCompile metadata
+    QVector<ItemSetting> settings;
+    while ( reader.readNextStartElement() )
+    {
+        if ( type != MsvcProjectData::CompileItem )
+        {
+            reader.skipCurrentElement();
+            continue;
+        }
+
+        const QString configuration = parseVcxCondition( reader.attributes().value("Condition") );
+        const QString name = reader.name().toString();
+        settings.append( { configuration, name, reader.readElementText( QXmlStreamReader::SkipChildElements ) } );
+    }
+
+    for ( const QString & file : files )
+    {
+        Item & item = m_items[ itemKey( file ) ];
+        item.type = type;
+        item.settings << settings;
+    }
+}
+
+void MsvcVcxProjParser::addItemFile( MsvcProjectData & data, QString const & relativePath,
+                                     int parent, MsvcProjectData::ItemType type ) const
+{
+    // The filter file knows where a file goes, the project file what it is
+    auto it = m_items.constFind( itemKey( relativePath ) );
+    const int file = data.addFile( QStringRef( &relativePath ), parent, it == m_items.constEnd() ? type : it->type );
+
+    if ( it != m_items.constEnd() )
+    {
+        for ( const ItemSetting & setting : it->settings )
+            data.addFileSetting( file, setting.configuration, setting.name, setting.value );
+    }
+}
+
+void MsvcVcxProjParser::parseProjectReference( QXmlStreamReader & reader, MsvcProjectData & data )
+{
+    const QString include = reader.attributes().value("Include").toString();
+    QUuid uuid;
+
+    while ( reader.readNextStartElement() )
+    {
+        if ( reader.name() == "Project" )
+            uuid = QUuid( reader.readElementText() );
+        else
+            reader.skipCurrentElement();
+    }
+
+    data.addProjectReference( include, uuid );
+}
+
+void MsvcVcxProjParser::parseGlobals( QXmlStreamReader & reader, MsvcProjectData & data )
+{
+    while ( reader.readNextStartElement() )
+    {
+        if ( reader.name() == "ProjectGuid" )
+        {
+            data.setUuid( QUuid( reader.readElementText() ) );
+        }
+        else if ( reader.name() == "RootNamespace" )
+        {
+            data.setRootNamespace( reader.readElementText() );
+        }
+        else if ( reader.name() == "ProjectName" )
+        {
+            data.setName( reader.readElementText() );
+        }
+        else
+        {
+            reader.skipCurrentElement();
+        }
+    }
+}
+
+void MsvcVcxProjParser::parseFilterFile(QXmlStreamReader & reader, MsvcProjectData & data)
 {
     while ( reader.readNextStartElement() )
     {
@@ -228,7 +455,7 @@ void MsvcVcxProjParser::parseFilterFile(QXmlStreamReader & reader, MsvcProjectIt
             {
                 if ( reader.name() == "ItemGroup" )
                 {
-                    parseItemGroup( reader, result );
+                    parseItemGroup( reader, data );
                 }
             }
         }
@@ -239,15 +466,16 @@ void MsvcVcxProjParser::parseFilterFile(QXmlStreamReader & reader, MsvcProjectIt
     }
 }
 
-void MsvcVcxProjParser::parseItemGroup(QXmlStreamReader & reader, MsvcProjectItem * proj)
+void MsvcVcxProjParser::parseItemGroup(QXmlStreamReader & reader, MsvcProjectData & data)
 {
     while ( reader.readNextStartElement() )
     {
         if ( reader.name() == "Filter" )
         {
-            new MsvcFilterItem( proj->project(),
-                                reader.attributes().value("Include").toString(),
-                                proj );
+            const QXmlStreamAttributes attributes = reader.attributes();
+            const QStringRef name = attributes.value("Include");
+            if ( data.findFilter( name ) == MsvcProjectData::NoParent )
+                data.addFilter( name );
             
             reader.skipCurrentElement();
         }
@@ -256,31 +484,26 @@ void MsvcVcxProjParser::parseItemGroup(QXmlStreamReader & reader, MsvcProjectIte
                   reader.name() == "ResourceCompile" || 
                   reader.name() == "Text" )
         {
-            QString relativePath = reader.attributes().value("Include").toString().replace('\\', '/');
+            const MsvcProjectData::ItemType type = MsvcProjectData::itemType( reader.name() );
+            const QXmlStreamAttributes attributes = reader.attributes();
+            const QStringList relativePaths = expandItem( attributes.value("Include").toString(),
+                                                          attributes.value("Exclude").toString(), true );
             
-            KDevelop::ProjectBaseItem * parent = proj;
+            int parent = MsvcProjectData::NoParent;
             
             // Try to see if it has an associated filter
             while ( reader.readNextStartElement() )
             {
                 if ( reader.name() == "Filter" )
                 {
-                    QString filterName = reader.readElementText(QXmlStreamReader::SkipChildElements);
+                    const QString filterName = reader.readElementText(QXmlStreamReader::SkipChildElements);
                     
-                    qCDebug(KDEV_MSVC) << "Filter for item: " << relativePath << filterName;
+                    MsvcTrace::count( "filter lookups" );
 
-                    auto findFiltPred = [&filterName](KDevelop::ProjectBaseItem * item)
-                                        {
-                                            return dynamic_cast<MsvcFilterItem*>(item) &&
-                                                    item->baseName() == filterName;
-                                        };
-                    
-                    if ( KDevelop::ProjectBaseItem * filterItem = findItem( proj, findFiltPred ) )
-                    {                                                                       
-                        qCDebug(KDEV_MSVC) << "Found filter: " << filterItem->baseName() << "for" << relativePath;
-                 
-                        parent = filterItem;
-                    }
+                    // Filters are usually declared first, VS creates the missing ones too
+                    parent = data.findFilter( QStringRef( &filterName ) );
+                    if ( parent == MsvcProjectData::NoParent )
+                        parent = data.addFilter( QStringRef( &filterName ) );
                 }
                 else
                 {
@@ -288,9 +511,8 @@ void MsvcVcxProjParser::parseItemGroup(QXmlStreamReader & reader, MsvcProjectIte
                 }
             }
 
-            const KDevelop::Path path (projectPath().parent(), relativePath );
-
-            new KDevelop::ProjectFileItem(proj->project(), path, parent );
+            for ( const QString & relativePath : relativePaths )
+                addItemFile( data, relativePath, parent, type );
         }
         else
         {
@@ -298,4 +520,3 @@ void MsvcVcxProjParser::parseItemGroup(QXmlStreamReader & reader, MsvcProjectIte
         }
     }
 }
-
@@ -28,7 +28,10 @@
 #include <memory>
 
 #include "msvcmodelitems.h"
+#include "msvcprojectdata.h"
 
+class MsvcDirectoryCache;
+class MsvcParseCache;
 class QXmlStreamReader;
 
 /**
@@ -43,23 +46,62 @@ public:
     {
     }
 
+    /**
+     * @brief Register the parsed files in the registry of the solution.
+     */
+    void setFileRegistry( std::shared_ptr<MsvcFileRegistry> files ) { m_files = std::move( files ); }
+
+    /**
+     * @brief Share the directory listings used by wildcard items with the solution.
+     */
+    void setDirectoryCache( std::shared_ptr<MsvcDirectoryCache> directories ) { m_directories = std::move( directories ); }
+
+    /**
+     * @brief Reuse the data of an unchanged project file parsed for another solution.
+     *
+     * With @p reuse false the project is parsed anyway and only refreshes the cache.
+     */
+    void setParseCache( std::shared_ptr<MsvcParseCache> parses, bool reuse = true )
+    {
+        m_parses = std::move( parses );
+        m_reuseParse = reuse;
+    }
+
     virtual void run() override final;
+
+    /**
+     * @brief Parse the project file without building the model, null on failure.
+     */
+    std::shared_ptr< MsvcProjectData > parseData();
     
     // Must take ownership of the returned object!
     QFuture< MsvcProjectItem * > getFuture() { return m_promise.future(); }
 
 protected:
-    virtual std::unique_ptr< MsvcProjectItem > parse( QXmlStreamReader & ) = 0;
+    /**
+     * @brief Fill @p data from the project file, false on failure.
+     */
+    virtual bool parse( QXmlStreamReader &, MsvcProjectData & data ) = 0;
 
     bool isCanceled() const { return m_promise.isCanceled(); }
-    
+
     KDevelop::Path projectPath() const { return m_projectPath; }
+
+    /**
+     * @brief The directories listed for the wildcard items, the result cannot be cached.
+     */
+    std::shared_ptr<MsvcDirectoryCache> directoryCache();
     KDevelop::IProject* project() const { return m_project; }
 
 private:
     KDevelop::Path m_projectPath;
     QFutureInterface< MsvcProjectItem * > m_promise;
     KDevelop::IProject * m_project;
+    std::shared_ptr<MsvcFileRegistry> m_files;
+    std::shared_ptr<MsvcDirectoryCache> m_directories;
+    std::shared_ptr<MsvcParseCache> m_parses;
+    bool m_reuseParse = true;
+    bool m_listedDirectories = false;
 };
 
 /**
@@ -74,18 +116,18 @@ public:
     }
 
 private:
-    virtual std::unique_ptr< MsvcProjectItem > parse( QXmlStreamReader & ) override;
+    virtual bool parse( QXmlStreamReader &, MsvcProjectData & ) override;
 
     /**
      * @brief parse a \<Files\> tag.
      */
-    void parseFileList(KDevelop::ProjectBaseItem * parent,
+    void parseFileList(MsvcProjectData & data, int parent,
                        QXmlStreamReader & reader) const;
 
     /**
      * @brief parse a \<VisualStudioProject\> tag
      */
-    void parseVisualStudioProject(QXmlStreamReader& reader, MsvcProjectItem * proj);
+    void parseVisualStudioProject(QXmlStreamReader& reader, MsvcProjectData & data);
 };
 
 /**
@@ -100,10 +142,63 @@ public:
     }
 
 private:
-    virtual std::unique_ptr< MsvcProjectItem > parse( QXmlStreamReader & ) override;
+    virtual bool parse( QXmlStreamReader &, MsvcProjectData & ) override;
     
-    void parseFilterFile( QXmlStreamReader &, MsvcProjectItem * );
-    void parseItemGroup( QXmlStreamReader &, MsvcProjectItem * );
+    /**
+     * @brief parse the \<Project\> tag of the vcxproj itself.
+     * The file items are collected in @p items, they are only used when there is no filter file.
+     */
+    void parseProjectFile( QXmlStreamReader &, MsvcProjectData &, QStringList & items );
+    void parseProjectReference( QXmlStreamReader &, MsvcProjectData & );
+    void parseGlobals( QXmlStreamReader &, MsvcProjectData & );
+
+    void parseFilterFile( QXmlStreamReader &, MsvcProjectData & );
+    void parseItemGroup( QXmlStreamReader &, MsvcProjectData & );
+
+    /**
+     * @brief Read the metadata of an item of the project file, whose files are @p files:
+     * the ClCompile settings of its own a file is compiled with.
+     */
+    void parseItemMetadata( QXmlStreamReader &, MsvcProjectData::ItemType type, QStringList const & files );
+
+    /**
+     * @brief Add a file with the type and the settings the project file gave it,
+     * @p type is used for files the project file does not list.
+     */
+    void addItemFile( MsvcProjectData & data, QString const & relativePath,
+                      int parent, MsvcProjectData::ItemType type ) const;
+
+    // Files are listed by the project and by the filter file, not always spelled the same
+    static QString itemKey( QString const & relativePath );
+
+    /**
+     * @brief The files of an item, its wildcards expanded.
+     * An item of the filter file without Exclude gets the files of the
+     * project item with the same Include, with its Exclude applied.
+     */
+    QStringList expandItem( QString const & include, QString const & exclude, bool inFilterFile );
+
+    // By (Include, Exclude)
+    QHash< QPair<QString, QString>, QStringList > m_expanded;
+
+    // The (Include, Exclude) last expanded for an Include of the project file
+    QHash< QString, QPair<QString, QString> > m_projectItems;
+
+    struct ItemSetting
+    {
+        QString configuration;  // empty for every configuration
+        QString name;
+        QString value;
+    };
+
+    struct Item
+    {
+        MsvcProjectData::ItemType type = MsvcProjectData::OtherItem;
+        QVector<ItemSetting> settings;
+    };
+
+    // What the project file says about each file, by itemKey()
+    QHash< QString, Item > m_items;
     
 };
 
@@ -0,0 +1,180 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "msvcstatistics.h"
+#include "msvcfileregistry.h"
+#include "msvcmodelitems.h"
+#include "msvcobjectcache.h"
+#include "msvcprojectgraph.h"
+
+#include <QMutexLocker>
+#include <QPair>
+
+#include <KLocalizedString>
+
+#include <algorithm>
+
+namespace
+{
+
+// How many of the slowest projects are listed
+const int SLOWEST_PROJECTS = 10;
+
+struct ItemCounts
+{
+    int filters = 0;
+    int files = 0;
+    int items = 0;
+    qint64 bytes = 0;
+};
+
+// Rough size of an item: the object itself and the strings it owns
+qint64 itemBytes( KDevelop::ProjectBaseItem * item, size_t objectSize )
+{
+    return qint64( objectSize ) +
+           qint64( item->text().size() + item->path().lastPathSegment().size() ) * qint64( sizeof(QChar) );
+}
+
+void countItems( KDevelop::ProjectBaseItem * item, ItemCounts & counts )
+{
+    for ( KDevelop::ProjectBaseItem * child : item->children() )
+    {
+        ++counts.items;
+
+        if ( child->file() )
+        {
+            ++counts.files;
+            counts.bytes += itemBytes( child, sizeof(KDevelop::ProjectFileItem) );
+        }
+        else if ( MsvcFilterItem * filter = dynamic_cast<MsvcFilterItem*>(child) )
+        {
+            ++counts.filters;
+            counts.bytes += itemBytes( child, sizeof(MsvcFilterItem) );
+
+            // Unloaded files only cost their entry in the filter
+            counts.files += filter->pendingFileCount();
+            counts.bytes += filter->pendingFileCount() * qint64( sizeof(QStringRef) + sizeof(int) );
+        }
+        else
+        {
+            counts.bytes += itemBytes( child, sizeof(KDevelop::ProjectBaseItem) );
+        }
+
+        countItems( child, counts );
+    }
+}
+
+QString ratio( int hits, int misses )
+{
+    const int total = hits + misses;
+    return i18n("%1 hits, %2 misses (%3% hit rate)", hits, misses,
+                total ? QString::number( 100.0 * hits / total, 'f', 1 ) : QStringLiteral("-") );
+}
+
+}
+
+MsvcStatistics & MsvcStatistics::self()
+{
+    static MsvcStatistics instance;
+    return instance;
+}
+
+void MsvcStatistics::setParseTime( KDevelop::Path const & projectFile, qint64 msecs )
+{
+    QMutexLocker lock( &m_mutex );
+    m_parseTimes.insert( projectFile, msecs );
+}
+
+QStringList MsvcStatistics::report( QList<MsvcSolutionItem*> const & solutions )
+{
+    QHash<KDevelop::Path, qint64> parseTimes;
+    {
+        QMutexLocker lock( &m_mutex );
+        parseTimes = m_parseTimes;
+    }
+
+    QStringList result;
+
+    for ( MsvcSolutionItem * solution : solutions )
+    {
+        const QList<MsvcProjectItem*> projects = solution->projects();
+
+        ItemCounts total;
+        QList< QPair<qint64, QString> > slowest;
+        QStringList perProject;
+
+        for ( MsvcProjectItem * proj : projects )
+        {
+            ItemCounts counts;
+            counts.items = 1;
+            counts.bytes = itemBytes( proj, sizeof(MsvcProjectItem) ) +
+                           qint64( proj->configurationNames().size() ) * qint64( sizeof(MsvcProjectConfig) );
+            countItems( proj, counts );
+
+            const qint64 parseTime = parseTimes.value( proj->path(), -1 );
+            if ( parseTime >= 0 )
+                slowest << qMakePair( parseTime, proj->text() );
+
+            perProject << i18n("  %1: %2 configurations, %3 filters, %4 files, parsed in %5 ms",
+                               proj->text(), proj->configurationNames().size(),
+                               counts.filters, counts.files,
+                               parseTime >= 0 ? QString::number( parseTime ) : QStringLiteral("?") );
+
+            total.filters += counts.filters;
+            total.files += counts.files;
+            total.items += counts.items;
+            total.bytes += counts.bytes;
+        }
+
+        result << i18n("Solution %1", solution->path().pathOrUrl());
+        result << i18n("  %1 projects, %2 filters, %3 files, %4 configurations",
+                       projects.size(), total.filters, total.files, solution->getConfigurations().size());
+        result << i18n("  %1 distinct files referenced %2 times",
+                       solution->fileRegistry()->fileCount(), solution->fileRegistry()->referenceCount());
+        const std::shared_ptr<const MsvcProjectGraph> graph = solution->dependencyGraph();
+        result << i18n("  %1 project dependencies, %2 cycles",
+                       graph->edgeCount(), graph->cycles().size());
+        result << i18n("  About %1 bytes per item (%2 items)",
+                       total.items ? total.bytes / total.items : 0, total.items);
+        result << perProject;
+
+        std::sort( slowest.begin(), slowest.end(),
+                   []( QPair<qint64, QString> const & a, QPair<qint64, QString> const & b ) { return a.first > b.first; } );
+
+        result << i18n("  Slowest projects to parse:");
+        for ( int i = 0; i < slowest.size() && i < SLOWEST_PROJECTS; ++i )
+            result << i18n("    %1 ms %2", slowest.at(i).first, slowest.at(i).second);
+    }
+
+    static const char * names[CacheCount] =
+    {
+        I18N_NOOP("Include directories"), I18N_NOOP("Defines"), I18N_NOOP("Variable expansion")
+    };
+    result << i18n("Caches");
+    for ( int i = 0; i < CacheCount; ++i )
+        result << QStringLiteral("  %1: %2").arg( i18n(names[i]), ratio( m_hits[i].load(), m_misses[i].load() ) );
+
+    const MsvcObjectCache::Statistics objects = MsvcObjectCache::self().statistics();
+    result << i18n("  Object cache: %1, %2 entries, %3 MB",
+                   ratio( int( objects.hits ), int( objects.misses ) ), objects.entries,
+                   objects.size / ( 1024 * 1024 ));
+
+    return result;
+}
@@ -0,0 +1,74 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCSTATISTICS_H
+#define MSVCSTATISTICS_H
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+
+#include <kdevplatform/util/path.h>
+
+class MsvcSolutionItem;
+
+/**
+ * @brief Numbers about the loaded solutions, to see what a big solution costs.
+ *
+ * Cache counters and parse times are collected while the plugin runs, the
+ * model is walked when the report is asked for.
+ */
+class MsvcStatistics
+{
+public:
+    enum Cache
+    {
+        IncludeCache,
+        DefineCache,
+        VariableCache,
+        CacheCount
+    };
+
+    static MsvcStatistics & self();
+
+    void cacheAccess( Cache cache, bool hit )
+    {
+        ( hit ? m_hits : m_misses )[cache].ref();
+    }
+
+    void setParseTime( KDevelop::Path const & projectFile, qint64 msecs );
+
+    /**
+     * @brief A human readable report, one line per entry.
+     */
+    QStringList report( QList<MsvcSolutionItem*> const & solutions );
+
+private:
+    MsvcStatistics() = default;
+
+    QAtomicInt m_hits[CacheCount];
+    QAtomicInt m_misses[CacheCount];
+
+    QMutex m_mutex;
+    QHash<KDevelop::Path, qint64> m_parseTimes;
+};
+
+#endif //MSVCSTATISTICS_H
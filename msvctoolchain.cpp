@@ -0,0 +1,266 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "msvctoolchain.h"
+#include "debug.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QStandardPaths>
+
+#include <KConfigGroup>
+
+#include <interfaces/iproject.h>
+
+namespace
+{
+
+const char * INSTALLATIONS_GROUP = "Installations";
+const char * BINARIES_GROUP = "Binaries";
+const char * WINSDK_GROUP = "WindowsSdk";
+
+// Changes whenever a VSxxxCOMNTOOLS variable changes
+QString environmentFingerprint()
+{
+    static const char * vars[] =
+    {
+        "VS140COMNTOOLS", "VS130COMNTOOLS", "VS120COMNTOOLS",
+        "VS110COMNTOOLS", "VS100COMNTOOLS", "VS90COMNTOOLS"
+    };
+
+    QStringList values;
+    for ( const char * v : vars )
+        values << QString::fromLocal8Bit( qgetenv(v) );
+
+    return values.join(';');
+}
+
+qint64 modificationTime( const KDevelop::Path & path )
+{
+    QFileInfo info( path.toLocalFile() );
+    return info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+}
+
+}
+
+MsvcToolchain & MsvcToolchain::self()
+{
+    static MsvcToolchain instance;
+    return instance;
+}
+
+MsvcToolchain::MsvcToolchain() :
+    m_cache( KSharedConfig::openConfig( QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+                                        QStringLiteral("/kdevmsvctoolchainrc"),
+                                        KConfig::SimpleConfig ) )
+{
+}
+
+MsvcToolchain::Profile MsvcToolchain::profile( const KDevelop::IProject * project )
+{
+    QMutexLocker lock( &m_mutex );
+
+    auto it = m_profiles.constFind( project->path() );
+    if ( it != m_profiles.constEnd() )
+    {
+        if ( !it->valid || modificationTime( it->devenv ) == it->devenvModified )
+            return *it;
+
+        // Visual Studio was updated under us, what depends on the profile must go too
+        qCDebug(KDEV_MSVC) << it->devenv << "changed, resolving the toolchain again";
+        m_generation.ref();
+    }
+
+    Profile result = resolve( project );
+    m_profiles.insert( project->path(), result );
+    return result;
+}
+
+void MsvcToolchain::invalidate( const KDevelop::IProject * project )
+{
+    QMutexLocker lock( &m_mutex );
+    m_profiles.remove( project->path() );
+    m_generation.ref();
+}
+
+QList< MsvcConfig::CompilerPath > MsvcToolchain::installedCompilers()
+{
+    QMutexLocker lock( &m_mutex );
+
+    if ( m_compilersScanned )
+        return m_compilers;
+
+    m_compilersScanned = true;
+
+    KConfigGroup cg( m_cache, INSTALLATIONS_GROUP );
+    const QString fingerprint = environmentFingerprint();
+
+    if ( cg.readEntry("Fingerprint", QString()) == fingerprint )
+    {
+        // Trust the cache as long as all the binaries are still there, untouched.
+        QList< MsvcConfig::CompilerPath > cached;
+        bool stale = false;
+
+        const int count = cg.readEntry("Count", 0);
+        for ( int i = 0; i < count && !stale; ++i )
+        {
+            KConfigGroup entry = cg.group( QString::number(i) );
+
+            MsvcConfig::CompilerPath compiler{ entry.readEntry("Version", 0),
+                                               KDevelop::Path( entry.readEntry("Path", QString()) ),
+                                               entry.readEntry("Name", QString()) };
+
+            stale = modificationTime( compiler.path ) != entry.readEntry("Modified", qint64(-1));
+            cached << compiler;
+        }
+
+        if ( !stale )
+        {
+            m_compilers = cached;
+            return m_compilers;
+        }
+    }
+
+    qCDebug(KDEV_MSVC) << "Looking for Visual Studio installations";
+    m_compilers = MsvcConfig::findMSVC();
+
+    cg.deleteGroup();
+    cg.writeEntry( "Fingerprint", fingerprint );
+    cg.writeEntry( "Count", m_compilers.size() );
+    for ( int i = 0; i < m_compilers.size(); ++i )
+    {
+        KConfigGroup entry = cg.group( QString::number(i) );
+        entry.writeEntry( "Version", m_compilers[i].version );
+        entry.writeEntry( "Path", m_compilers[i].path.toLocalFile() );
+        entry.writeEntry( "Name", m_compilers[i].fullName );
+        entry.writeEntry( "Modified", modificationTime(m_compilers[i].path) );
+    }
+    m_cache->sync();
+
+    return m_compilers;
+}
+
+KDevelop::Path MsvcToolchain::winSdk()
+{
+    QMutexLocker lock( &m_mutex );
+
+    if ( m_winSdkScanned )
+        return m_winSdk;
+
+    m_winSdkScanned = true;
+
+    KConfigGroup cg( m_cache, WINSDK_GROUP );
+    const QString fingerprint = environmentFingerprint();
+
+    if ( cg.readEntry("Fingerprint", QString()) == fingerprint )
+    {
+        const KDevelop::Path cached( cg.readEntry("Path", QString()) );
+        if ( cached.isValid() && modificationTime( cached ) == cg.readEntry("Modified", qint64(-1)) )
+        {
+            m_winSdk = cached;
+            return m_winSdk;
+        }
+    }
+
+    qCDebug(KDEV_MSVC) << "Looking for the Windows SDK";
+    m_winSdk = MsvcConfig::findWinSdk();
+
+    cg.writeEntry( "Fingerprint", fingerprint );
+    cg.writeEntry( "Path", m_winSdk.toLocalFile() );
+    cg.writeEntry( "Modified", modificationTime( m_winSdk ) );
+    m_cache->sync();
+
+    return m_winSdk;
+}
+
+MsvcToolchain::Profile MsvcToolchain::resolve( const KDevelop::IProject * project )
+{
+    KConfigGroup cg( project->projectConfiguration(), MsvcConfig::CONFIG_GROUP );
+
+    Profile result;
+    result.devenv = KDevelop::Path( cg.readEntry( MsvcConfig::DEVENV_BINARY, QString() ) );
+    result.msvcInclude = KDevelop::Path( cg.readEntry( MsvcConfig::MSVC_INCLUDE, QString() ) );
+    result.winSdkInclude = KDevelop::Path( cg.readEntry( MsvcConfig::WINSDK_INCLUDE, QString() ) );
+    result.configuration = cg.readEntry( MsvcConfig::ACTIVE_CONFIGURATION, "Debug" );
+    result.architecture = cg.readEntry( MsvcConfig::ACTIVE_ARCHITECTURE, QString() );
+    result.backend = cg.readEntry( MsvcConfig::BUILD_BACKEND, MsvcConfig::BACKEND_DEVENV );
+    result.ninja = cg.readEntry( MsvcConfig::NINJA_BINARY, "ninja" );
+    result.clangCl = cg.readEntry( MsvcConfig::CLANG_CL_BINARY, "clang-cl" );
+    result.lldLink = cg.readEntry( MsvcConfig::LLD_LINK_BINARY, "lld-link" );
+    result.llvmLib = cg.readEntry( MsvcConfig::LLVM_LIB_BINARY, "llvm-lib" );
+    result.objectCache = cg.readEntry( MsvcConfig::OBJECT_CACHE, false );
+    result.objectCacheSize = cg.readEntry( MsvcConfig::OBJECT_CACHE_SIZE, 5120 ) * qint64(1024 * 1024);
+    if ( cg.readEntry( MsvcConfig::UNITY_BUILD, false ) )
+        result.unityBatchSize = cg.readEntry( MsvcConfig::UNITY_BATCH_SIZE, 8 );
+
+    QFileInfo fi( result.devenv.toLocalFile() );
+    result.devenvModified = modificationTime( result.devenv );
+    result.valid = result.devenv.isValid() && fi.exists() && fi.isExecutable();
+
+    if ( !result.valid )
+    {
+        qCWarning(KDEV_MSVC) << "Badly configured devenv.exe:" << result.devenv;
+        return result;
+    }
+
+    // devenv lives in Common7/IDE, the compiler in VC/bin
+    const KDevelop::Path vsRoot = result.devenv.parent().parent().parent();
+    result.compiler = KDevelop::Path( vsRoot, QStringLiteral("VC/bin/cl.exe") );
+
+    result.toolsetVersion = toolsetVersion( result.devenv );
+    return result;
+}
+
+int MsvcToolchain::toolsetVersion( const KDevelop::Path & devenv )
+{
+    KConfigGroup cg( m_cache, BINARIES_GROUP );
+    KConfigGroup entry = cg.group( devenv.toLocalFile() );
+
+    const qint64 modified = modificationTime( devenv );
+    if ( entry.exists() && entry.readEntry("Modified", qint64(-1)) == modified )
+    {
+        return entry.readEntry("Version", 0);
+    }
+
+    // Binary is new or has been updated: find out which installation it belongs to.
+    int version = 0;
+    for ( const MsvcConfig::CompilerPath & c : m_compilers )
+    {
+        if ( c.path == devenv )
+            version = c.version;
+    }
+
+    if ( version == 0 )
+    {
+        static const QRegularExpression versionRegex( R"(Visual Studio (\d+))", QRegularExpression::CaseInsensitiveOption );
+        QRegularExpressionMatch match = versionRegex.match( devenv.toLocalFile() );
+        if ( match.hasMatch() )
+            version = match.captured(1).toInt();
+    }
+
+    entry.writeEntry( "Modified", modified );
+    entry.writeEntry( "Version", version );
+    m_cache->sync();
+
+    return version;
+}
@@ -0,0 +1,122 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCTOOLCHAIN_H
+#define MSVCTOOLCHAIN_H
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+
+#include <KSharedConfig>
+
+#include <kdevplatform/util/path.h>
+
+#include "msvcconfig.h"
+
+namespace KDevelop {
+class IProject;
+}
+
+/**
+ * @brief Session wide registry of the resolved MSVC toolchains.
+ *
+ * Everything that needs the file system (looking for installations, checking the
+ * devenv binary, the windows SDK) is done once and remembered, both in memory
+ * and in a small cache file so the next session does not have to scan again.
+ */
+class MsvcToolchain
+{
+public:
+    struct Profile
+    {
+        bool            valid = false;
+        KDevelop::Path  devenv;
+        qint64          devenvModified = -1;    // the profile is resolved again when devenv changes
+        KDevelop::Path  compiler;
+        KDevelop::Path  msvcInclude;
+        KDevelop::Path  winSdkInclude;
+        int             toolsetVersion = 0;
+        QString         configuration;
+        QString         architecture;
+
+        // Tools used when devenv is not
+        QString         backend;
+        QString         ninja;
+        QString         clangCl;
+        QString         lldLink;
+        QString         llvmLib;
+
+        // Object cache used by the clang-cl backend
+        bool            objectCache = false;
+        qint64          objectCacheSize = 0;
+
+        // Files per unity batch for the clang-cl backend, 0 when unity builds are off
+        int             unityBatchSize = 0;
+    };
+
+    static MsvcToolchain & self();
+
+    /**
+     * @brief The toolchain configured for @p project.
+     * Only the first call (or the first after invalidate()) resolves it, later
+     * calls only check that devenv was not updated since.
+     */
+    Profile profile( const KDevelop::IProject * project );
+
+    /**
+     * @brief Visual Studio installations found on this machine.
+     */
+    QList< MsvcConfig::CompilerPath > installedCompilers();
+
+    /**
+     * @brief The Windows SDK, remembered in the cache file until the environment or the SDK changes.
+     */
+    KDevelop::Path winSdk();
+
+    /**
+     * @brief Forget the profile of @p project, must be called when its configuration changes.
+     */
+    void invalidate( const KDevelop::IProject * project );
+
+    /**
+     * @brief Changes on every invalidate(), for the caches depending on a profile.
+     */
+    int generation() const { return m_generation.load(); }
+
+private:
+    MsvcToolchain();
+
+    Profile resolve( const KDevelop::IProject * project );
+    int toolsetVersion( const KDevelop::Path & devenv );
+
+    KSharedConfigPtr m_cache;
+    QMutex m_mutex;
+    QAtomicInt m_generation;
+
+    QHash< KDevelop::Path, Profile > m_profiles;
+    QList< MsvcConfig::CompilerPath > m_compilers;
+    KDevelop::Path m_winSdk;
+    bool m_compilersScanned = false;
+    bool m_winSdkScanned = false;
+};
+
+#endif //MSVCTOOLCHAIN_H
@@ -0,0 +1,178 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "msvctrace.h"
+#include "debug.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QVector>
+
+namespace
+{
+
+struct Event
+{
+    const char * name;
+    QString detail;
+    char phase;         // 'X' complete span, 'C' counter
+    qint64 timestamp;   // microseconds
+    qint64 value;       // duration for spans, total for counters
+    quintptr thread;
+};
+
+struct TraceData
+{
+    TraceData()
+    {
+        timer.start();
+        fileName = QString::fromLocal8Bit( qgetenv("KDEV_MSVC_TRACE") );
+    }
+
+    QMutex mutex;
+    QElapsedTimer timer;
+    QString fileName;
+    QVector<Event> events;
+    QHash<QByteArray, qint64> counters;
+
+    // Opened by the first flush, events are appended to it
+    QFile file;
+    QHash<quintptr, int> threads;
+};
+
+TraceData & data()
+{
+    static TraceData instance;
+    return instance;
+}
+
+quintptr currentThread()
+{
+    return reinterpret_cast<quintptr>( QThread::currentThreadId() );
+}
+
+}
+
+QAtomicInt MsvcTrace::s_enabled( qEnvironmentVariableIsEmpty("KDEV_MSVC_TRACE") ? 0 : 1 );
+
+void MsvcTrace::setOutputFile( QString const & fileName )
+{
+    TraceData & d = data();
+    QMutexLocker lock( &d.mutex );
+    if ( d.fileName != fileName )
+    {
+        d.file.close();
+        d.threads.clear();
+    }
+    d.fileName = fileName;
+    s_enabled.store( fileName.isEmpty() ? 0 : 1 );
+}
+
+void MsvcTrace::count( const char * name, qint64 delta )
+{
+    if ( !enabled() )
+        return;
+
+    TraceData & d = data();
+    const qint64 timestamp = now();
+
+    QMutexLocker lock( &d.mutex );
+    qint64 & total = d.counters[ QByteArray::fromRawData( name, qstrlen(name) ) ];
+    total += delta;
+    d.events.append( Event{ name, QString(), 'C', timestamp, total, currentThread() } );
+}
+
+qint64 MsvcTrace::now()
+{
+    return data().timer.nsecsElapsed() / 1000;
+}
+
+void MsvcTrace::record( const char * name, QString const & detail, qint64 start, qint64 duration )
+{
+    TraceData & d = data();
+    QMutexLocker lock( &d.mutex );
+    d.events.append( Event{ name, detail, 'X', start, duration, currentThread() } );
+}
+
+void MsvcTrace::flush()
+{
+    if ( !enabled() )
+        return;
+
+    TraceData & d = data();
+    QMutexLocker lock( &d.mutex );
+
+    if ( !d.file.isOpen() )
+    {
+        d.file.setFileName( d.fileName );
+        if ( !d.file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+        {
+            qCWarning(KDEV_MSVC) << "Cannot write the trace to" << d.fileName;
+            return;
+        }
+        d.file.write( "[\n" );
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QByteArray buffer;
+    for ( const Event & e : d.events )
+    {
+        // Chrome wants small thread ids, number them in order of appearance
+        auto tid = d.threads.find( e.thread );
+        if ( tid == d.threads.end() )
+            tid = d.threads.insert( e.thread, d.threads.size() + 1 );
+
+        QJsonObject event;
+        event["name"] = QString::fromLatin1( e.name );
+        event["cat"] = QStringLiteral("msvc");
+        event["ph"] = QString( QLatin1Char( e.phase ) );
+        event["ts"] = double( e.timestamp );
+        event["pid"] = double( pid );
+        event["tid"] = *tid;
+
+        if ( e.phase == 'X' )
+        {
+            event["dur"] = double( e.value );
+            if ( !e.detail.isEmpty() )
+                event["args"] = QJsonObject{ { "detail", e.detail } };
+        }
+        else
+        {
+            event["args"] = QJsonObject{ { "value", double( e.value ) } };
+        }
+
+        buffer += QJsonDocument( event ).toJson( QJsonDocument::Compact ) + ",\n";
+    }
+
+    if ( d.file.write( buffer ) == buffer.size() && d.file.flush() )
+        qCDebug(KDEV_MSVC) << "Wrote" << d.events.size() << "trace events to" << d.fileName;
+    else
+        qCWarning(KDEV_MSVC) << "Cannot write the trace to" << d.fileName;
+
+    d.events.clear();
+}
@@ -0,0 +1,115 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef MSVCTRACE_H
+#define MSVCTRACE_H
+
+#include <QAtomicInt>
+#include <QString>
+
+/**
+ * @brief Timed spans and counters, exported as Chrome trace events.
+ *
+ * Tracing is off unless the KDEV_MSVC_TRACE environment variable names the
+ * file to write (or setOutputFile() is called). When off, a span costs one
+ * atomic load; details are only computed when tracing is on, see
+ * MSVC_TRACE_SPAN_DETAIL.
+ *
+ * The file can be opened in chrome://tracing or https://ui.perfetto.dev.
+ */
+class MsvcTrace
+{
+public:
+    static bool enabled() { return s_enabled.load() != 0; }
+
+    /**
+     * @brief Turns tracing on and sets the file flush() writes, an empty name turns it off.
+     */
+    static void setOutputFile( QString const & fileName );
+
+    /**
+     * @brief Adds @p delta to the counter @p name.
+     */
+    static void count( const char * name, qint64 delta = 1 );
+
+    /**
+     * @brief Appends the events recorded since the last flush to the output file.
+     *
+     * The file is a Chrome trace in the JSON array format, left open so that
+     * later flushes only append; the viewers accept the missing closing bracket.
+     */
+    static void flush();
+
+    /**
+     * @brief For spans that do not fit a scope: the start time to pass to
+     * complete(), or -1 when tracing is off.
+     */
+    static qint64 timestamp() { return enabled() ? now() : -1; }
+
+    static void complete( const char * name, QString const & detail, qint64 start )
+    {
+        if ( start >= 0 )
+            record( name, detail, start, now() - start );
+    }
+
+    class Span
+    {
+    public:
+        explicit Span( const char * name, QString const & detail = QString() ) :
+            m_name( name ),
+            m_detail( detail ),
+            m_start( timestamp() )
+        {
+        }
+
+        ~Span()
+        {
+            complete( m_name, m_detail, m_start );
+        }
+
+        bool active() const { return m_start >= 0; }
+        void setDetail( QString const & detail ) { m_detail = detail; }
+
+    private:
+        Q_DISABLE_COPY(Span)
+
+        const char * m_name;
+        QString m_detail;
+        qint64 m_start;
+    };
+
+private:
+    static qint64 now();
+    static void record( const char * name, QString const & detail, qint64 start, qint64 duration );
+
+    static QAtomicInt s_enabled;
+};
+
+#define MSVC_TRACE_CONCAT_(a, b) a##b
+#define MSVC_TRACE_CONCAT(a, b) MSVC_TRACE_CONCAT_(a, b)
+
+#define MSVC_TRACE_SPAN(name) \
+    MsvcTrace::Span MSVC_TRACE_CONCAT(msvcTraceSpan, __LINE__)( name )
+
+// detail is only evaluated when tracing is on
+#define MSVC_TRACE_SPAN_DETAIL(name, detail) \
+    MsvcTrace::Span MSVC_TRACE_CONCAT(msvcTraceSpan, __LINE__)( name, MsvcTrace::enabled() ? QString( detail ) : QString() )
+
+#endif //MSVCTRACE_H
@@ -0,0 +1,104 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "ninjajob.h"
+#include "msvcmodelitems.h"
+#include "msvcninjagenerator.h"
+#include "msvcprojectgraph.h"
+#include "msvctoolchain.h"
+#include "debug.h"
+
+#include <KLocalizedString>
+
+#include <interfaces/iproject.h>
+#include <outputview/ioutputview.h>
+#include <outputview/outputmodel.h>
+
+NinjaJob::NinjaJob( QObject* parent, KDevelop::ProjectBuildFolderItem* item, DevEnvJob::CommandType command ) :
+    KDevelop::OutputExecuteJob(parent),
+    m_item(item),
+    m_command(command)
+{
+    setCapabilities( Killable );
+    setFilteringStrategy( KDevelop::OutputModel::CompilerFilter );
+    setProperties( PortableMessages | DisplayStderr | IsBuilderHint );
+    setToolTitle( i18n("Ninja") );
+    setStandardToolView( KDevelop::IOutputView::BuildView );
+    setBehaviours(KDevelop::IOutputView::AllowUserClose | KDevelop::IOutputView::AutoScroll );
+
+    setJobName( command == DevEnvJob::CleanCommand ?
+                i18n("Clean (%1)", item->text()) :
+                i18n("Build (%1)", item->text()) );
+}
+
+void NinjaJob::start()
+{
+    KDevelop::IProject * project = m_item->project();
+
+    // Regenerate every time, it is cheap compared to the build and keeps up with the model.
+    QList<MsvcProjectItem*> projects;
+    std::shared_ptr<const MsvcProjectGraph> graph;
+    for ( KDevelop::ProjectBaseItem * p = m_item; p; p = p->parent() )
+    {
+        if ( MsvcSolutionItem * solItem = dynamic_cast<MsvcSolutionItem*>(p) )
+        {
+            graph = solItem->dependencyGraph();
+            projects = graph->buildOrder();
+            break;
+        }
+    }
+
+    if ( projects.isEmpty() )
+    {
+        if ( MsvcProjectItem * projItem = dynamic_cast<MsvcProjectItem*>(m_item) )
+            projects << projItem;
+    }
+
+    MsvcNinjaGenerator generator( project, projects );
+    generator.setDependencyGraph( graph );
+    if ( !generator.generate() )
+    {
+        setError( FailedShownError );
+        setErrorText( i18n("Could not generate the ninja build file") );
+        emitResult();
+        return;
+    }
+
+    setWorkingDirectory( MsvcNinjaGenerator::buildDirectory( project ).toUrl() );
+
+    OutputExecuteJob::start();
+}
+
+QStringList NinjaJob::commandLine() const
+{
+    const MsvcToolchain::Profile toolchain = MsvcToolchain::self().profile( m_item->project() );
+
+    QStringList result;
+    result << toolchain.ninja;
+
+    if ( m_command == DevEnvJob::CleanCommand )
+        result << "-t" << "clean";
+
+    if ( MsvcProjectItem * projItem = dynamic_cast<MsvcProjectItem*>(m_item) )
+        result << MsvcNinjaGenerator::targetName( projItem );
+
+    return result;
+}
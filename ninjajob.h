@@ -0,0 +1,47 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef NINJAJOB_H
+#define NINJAJOB_H
+
+#include <outputview/outputexecutejob.h>
+
+#include "devenvjob.h"
+
+/**
+ * @brief Builds with ninja from a build.ninja generated out of the solution.
+ */
+class NinjaJob : public KDevelop::OutputExecuteJob
+{
+    Q_OBJECT
+
+public:
+    NinjaJob( QObject* parent, KDevelop::ProjectBuildFolderItem* item, DevEnvJob::CommandType command );
+
+    void start() override;
+
+    QStringList commandLine() const override;
+
+private:
+    KDevelop::ProjectBuildFolderItem * m_item;
+    DevEnvJob::CommandType m_command;
+};
+
+#endif //NINJAJOB_H
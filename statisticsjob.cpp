@@ -0,0 +1,51 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "statisticsjob.h"
+
+#include <QTimer>
+
+#include <KLocalizedString>
+
+#include <outputview/ioutputview.h>
+#include <outputview/outputmodel.h>
+
+StatisticsJob::StatisticsJob( QObject* parent, QStringList const & report ) :
+    KDevelop::OutputJob(parent),
+    m_report(report)
+{
+    setToolTitle( i18n("MSVC") );
+    setStandardToolView( KDevelop::IOutputView::BuildView );
+    setBehaviours( KDevelop::IOutputView::AllowUserClose );
+
+    setObjectName( i18n("MSVC Statistics") );
+}
+
+void StatisticsJob::start()
+{
+    KDevelop::OutputModel * model = new KDevelop::OutputModel;
+    setModel( model );
+    startOutput();
+
+    model->appendLines( m_report );
+
+    // Do not emit the result from within start()
+    QTimer::singleShot( 0, this, [this]() { emitResult(); } );
+}
@@ -0,0 +1,150 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "test_msvcdirectorycache.h"
+
+#include "msvcdirectorycache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTest>
+
+QTEST_GUILESS_MAIN(TestMsvcDirectoryCache)
+
+void TestMsvcDirectoryCache::initTestCase()
+{
+    QVERIFY( m_dir.isValid() );
+
+    const QStringList files =
+    {
+        "src/a.cpp", "src/b.CPP", "src/ab.h", "src/x1.c", "src/x22.c",
+        "src/sub/c.cpp", "src/sub/deep/d.cpp", "src/gen/g.cpp"
+    };
+    for ( const QString & file : files )
+    {
+        const QString path = m_dir.path() + '/' + file;
+        QVERIFY( QDir().mkpath( QFileInfo( path ).path() ) );
+
+        QFile f( path );
+        QVERIFY( f.open( QIODevice::WriteOnly ) );
+    }
+}
+
+void TestMsvcDirectoryCache::matchSegment_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<bool>("matches");
+
+    QTest::newRow("star") << "*.cpp" << "a.cpp" << true;
+    QTest::newRow("star, other extension") << "*.cpp" << "a.h" << false;
+    QTest::newRow("case") << "*.cpp" << "A.CPP" << true;
+    QTest::newRow("star matches nothing") << "a*.cpp" << "a.cpp" << true;
+    QTest::newRow("question") << "a?.h" << "ab.h" << true;
+    QTest::newRow("question needs a character") << "a?.h" << "a.h" << false;
+    QTest::newRow("question is one character") << "x?.c" << "x22.c" << false;
+    QTest::newRow("backtracking") << "a*b*c" << "axbxbyc" << true;
+    QTest::newRow("backtracking, no match") << "a*b*c" << "axbxby" << false;
+    QTest::newRow("double star in a segment") << "**" << "anything" << true;
+    QTest::newRow("empty name") << "*" << "" << true;
+    QTest::newRow("plain") << "a.cpp" << "a.cpp" << true;
+    QTest::newRow("plain, longer name") << "a.cpp" << "a.cppx" << false;
+}
+
+void TestMsvcDirectoryCache::matchSegment()
+{
+    QFETCH(QString, pattern);
+    QFETCH(QString, name);
+    QFETCH(bool, matches);
+
+    QCOMPARE( MsvcDirectoryCache::matchSegment( pattern, name ), matches );
+}
+
+void TestMsvcDirectoryCache::matchSegments_data()
+{
+    QTest::addColumn<QStringList>("pattern");
+    QTest::addColumn<QStringList>("path");
+    QTest::addColumn<bool>("matches");
+
+    QTest::newRow("recursive, no directory") << QStringList{ "**", "*.cpp" } << QStringList{ "a.cpp" } << true;
+    QTest::newRow("recursive, nested") << QStringList{ "**", "*.cpp" } << QStringList{ "x", "y", "a.cpp" } << true;
+    QTest::newRow("recursive, wrong file") << QStringList{ "**", "*.cpp" } << QStringList{ "x", "a.h" } << false;
+    QTest::newRow("trailing recursive") << QStringList{ "src", "**" } << QStringList{ "src" } << true;
+    QTest::newRow("recursive in the middle") << QStringList{ "**", "gen", "**" } << QStringList{ "src", "gen", "g.cpp" } << true;
+    QTest::newRow("recursive in the middle, no match") << QStringList{ "**", "gen", "**" } << QStringList{ "src", "sub", "c.cpp" } << false;
+    QTest::newRow("star is one segment") << QStringList{ "src", "*" } << QStringList{ "src", "a", "b" } << false;
+    QTest::newRow("too short") << QStringList{ "src", "*" } << QStringList{ "src" } << false;
+    QTest::newRow("case") << QStringList{ "SRC", "*.CPP" } << QStringList{ "src", "a.cpp" } << true;
+}
+
+void TestMsvcDirectoryCache::matchSegments()
+{
+    QFETCH(QStringList, pattern);
+    QFETCH(QStringList, path);
+    QFETCH(bool, matches);
+
+    QCOMPARE( MsvcDirectoryCache::matchSegments( pattern, path ), matches );
+}
+
+void TestMsvcDirectoryCache::expand_data()
+{
+    QTest::addColumn<QString>("include");
+    QTest::addColumn<QString>("exclude");
+    QTest::addColumn<QStringList>("expected");
+
+    QTest::newRow("one directory") << "src/*.cpp" << ""
+        << QStringList{ "src/a.cpp", "src/b.CPP" };
+    QTest::newRow("backslashes") << "src\\*.cpp" << ""
+        << QStringList{ "src/a.cpp", "src/b.CPP" };
+    QTest::newRow("question") << "src/x?.c" << ""
+        << QStringList{ "src/x1.c" };
+    QTest::newRow("recursive") << "src/**/*.cpp" << ""
+        << QStringList{ "src/a.cpp", "src/b.CPP", "src/gen/g.cpp", "src/sub/c.cpp", "src/sub/deep/d.cpp" };
+    QTest::newRow("every file below") << "src/sub/**" << ""
+        << QStringList{ "src/sub/c.cpp", "src/sub/deep/d.cpp" };
+    QTest::newRow("wildcard directory") << "src/*/*.cpp" << ""
+        << QStringList{ "src/gen/g.cpp", "src/sub/c.cpp" };
+    QTest::newRow("exclude pattern") << "src/**/*.cpp" << "src\\gen\\**"
+        << QStringList{ "src/a.cpp", "src/b.CPP", "src/sub/c.cpp", "src/sub/deep/d.cpp" };
+    QTest::newRow("exclude recursive pattern") << "src/**/*.cpp" << "**/deep/*.cpp;src/b.*"
+        << QStringList{ "src/a.cpp", "src/gen/g.cpp", "src/sub/c.cpp" };
+    QTest::newRow("exclude path, ignoring the case") << "src/*.cpp" << "SRC/A.cpp"
+        << QStringList{ "src/b.CPP" };
+    QTest::newRow("no wildcards") << "missing.cpp;src\\a.cpp" << ""
+        << QStringList{ "missing.cpp", "src/a.cpp" };
+    QTest::newRow("no wildcards, excluded") << "src/a.cpp;src/ab.h" << "src/*.h"
+        << QStringList{ "src/a.cpp" };
+    QTest::newRow("missing directory") << "nowhere/**/*.cpp" << ""
+        << QStringList();
+}
+
+void TestMsvcDirectoryCache::expand()
+{
+    QFETCH(QString, include);
+    QFETCH(QString, exclude);
+    QFETCH(QStringList, expected);
+
+    MsvcDirectoryCache cache;
+    QCOMPARE( cache.expand( m_dir.path(), include, exclude ), expected );
+
+    // The second time comes from the listings of the first one
+    QCOMPARE( cache.expand( m_dir.path(), include, exclude ), expected );
+}
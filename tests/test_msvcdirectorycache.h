@@ -0,0 +1,45 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef TEST_MSVCDIRECTORYCACHE_H
+#define TEST_MSVCDIRECTORYCACHE_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+class TestMsvcDirectoryCache : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void matchSegment_data();
+    void matchSegment();
+    void matchSegments_data();
+    void matchSegments();
+    void expand_data();
+    void expand();
+
+private:
+    QTemporaryDir m_dir;
+};
+
+#endif //TEST_MSVCDIRECTORYCACHE_H
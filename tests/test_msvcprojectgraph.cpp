@@ -0,0 +1,155 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "test_msvcprojectgraph.h"
+
+#include "msvcmodelitems.h"
+#include "msvcprojectgraph.h"
+
+#include <QTest>
+
+QTEST_GUILESS_MAIN(TestMsvcProjectGraph)
+
+typedef QList<MsvcProjectItem*> Projects;
+
+void TestMsvcProjectGraph::cleanup()
+{
+    qDeleteAll( m_projects );
+    m_projects.clear();
+    m_dependencies.clear();
+}
+
+QList<MsvcProjectItem*> TestMsvcProjectGraph::createProjects( int count )
+{
+    for ( int i = 0; i < count; ++i )
+    {
+        MsvcProjectItem * proj = new MsvcProjectItem( nullptr, KDevelop::Path( QStringLiteral("/solution/p%1.vcxproj").arg( i ) ) );
+        proj->setUuid( QUuid::createUuid() );
+        m_projects << proj;
+    }
+    return m_projects;
+}
+
+void TestMsvcProjectGraph::addDependency( MsvcProjectItem * proj, MsvcProjectItem * dependency )
+{
+    m_dependencies[ proj->uuid() ] << dependency->uuid();
+}
+
+MsvcProjectGraph TestMsvcProjectGraph::graph() const
+{
+    return MsvcProjectGraph( m_projects, m_dependencies );
+}
+
+void TestMsvcProjectGraph::selfLoop()
+{
+    const Projects p = createProjects( 2 );
+    addDependency( p[0], p[0] );
+    addDependency( p[1], p[0] );
+
+    const MsvcProjectGraph g = graph();
+
+    QCOMPARE( g.edgeCount(), 2 );
+    QCOMPARE( g.buildOrder(), Projects({ p[0], p[1] }) );
+    QCOMPARE( g.cycles(), QList<Projects>({ Projects({ p[0] }) }) );
+
+    // Reported as a cycle, but a project is never its own upstream
+    QVERIFY( g.dependsOn( p[0], p[0] ) );
+    QCOMPARE( g.upstream( p[0] ), Projects() );
+    QCOMPARE( g.downstream( p[0] ), Projects({ p[1] }) );
+    QCOMPARE( g.upstream( p[1] ), Projects({ p[0] }) );
+    QCOMPARE( g.affectedBy( p[0] ), Projects({ p[0], p[1] }) );
+}
+
+void TestMsvcProjectGraph::cycle()
+{
+    // 0 -> 1 -> 2 -> 0, 3 -> 0, 4 on its own
+    const Projects p = createProjects( 5 );
+    addDependency( p[0], p[1] );
+    addDependency( p[1], p[2] );
+    addDependency( p[2], p[0] );
+    addDependency( p[3], p[0] );
+
+    const MsvcProjectGraph g = graph();
+
+    QCOMPARE( g.buildOrder(), Projects({ p[0], p[1], p[2], p[3], p[4] }) );
+    QCOMPARE( g.cycles(), QList<Projects>({ Projects({ p[0], p[1], p[2] }) }) );
+
+    // The projects of a cycle share their dependencies
+    QCOMPARE( g.upstream( p[0] ), Projects({ p[1], p[2] }) );
+    QCOMPARE( g.upstream( p[1] ), Projects({ p[0], p[2] }) );
+    QCOMPARE( g.upstream( p[3] ), Projects({ p[0], p[1], p[2] }) );
+    QCOMPARE( g.downstream( p[2] ), Projects({ p[0], p[1], p[3] }) );
+    QCOMPARE( g.affectedBy( p[1] ), Projects({ p[0], p[1], p[2], p[3] }) );
+    QCOMPARE( g.dependencies( p[3] ), Projects({ p[0] }) );
+
+    QVERIFY( g.dependsOn( p[0], p[2] ) );
+    QVERIFY( g.dependsOn( p[2], p[1] ) );
+    QVERIFY( g.dependsOn( p[3], p[1] ) );
+    QVERIFY( !g.dependsOn( p[0], p[3] ) );
+    QVERIFY( !g.dependsOn( p[3], p[4] ) );
+    QCOMPARE( g.upstream( p[4] ), Projects() );
+    QCOMPARE( g.downstream( p[4] ), Projects() );
+}
+
+void TestMsvcProjectGraph::closureAcrossWords()
+{
+    // A chain longer than two words of the bit rows: i depends on i + 1
+    const int count = 130;
+    const Projects p = createProjects( count );
+    for ( int i = 0; i + 1 < count; ++i )
+        addDependency( p[i], p[i + 1] );
+
+    const MsvcProjectGraph g = graph();
+
+    Projects reversed;
+    for ( int i = count - 1; i >= 0; --i )
+        reversed << p[i];
+    QCOMPARE( g.buildOrder(), reversed );
+    QVERIFY( g.cycles().isEmpty() );
+
+    QCOMPARE( g.upstream( p[0] ), reversed.mid( 0, count - 1 ) );
+    QCOMPARE( g.downstream( p[count - 1] ), reversed.mid( 1 ) );
+    QCOMPARE( g.upstream( p[64] ).size(), count - 65 );
+    QCOMPARE( g.downstream( p[64] ).size(), 64 );
+
+    QVERIFY( g.dependsOn( p[0], p[count - 1] ) );
+    QVERIFY( g.dependsOn( p[63], p[64] ) );
+    QVERIFY( g.dependsOn( p[1], p[128] ) );
+    QVERIFY( !g.dependsOn( p[64], p[63] ) );
+    QVERIFY( !g.dependsOn( p[count - 1], p[0] ) );
+}
+
+void TestMsvcProjectGraph::sorted()
+{
+    const Projects p = createProjects( 3 );
+    addDependency( p[0], p[1] );
+    addDependency( p[1], p[2] );
+
+    const MsvcProjectGraph g = graph();
+
+    // Projects that are not in the graph, like one added since it was built
+    MsvcProjectItem first( nullptr, KDevelop::Path( QStringLiteral("/solution/first.vcxproj") ) );
+    MsvcProjectItem second( nullptr, KDevelop::Path( QStringLiteral("/solution/second.vcxproj") ) );
+
+    QCOMPARE( g.sorted( Projects({ p[0], p[2] }) ), Projects({ p[2], p[0] }) );
+    QCOMPARE( g.sorted( Projects({ &second, p[0], &first, p[1] }) ), Projects({ p[1], p[0], &second, &first }) );
+    QCOMPARE( g.sorted( Projects({ &first }) ), Projects({ &first }) );
+    QCOMPARE( g.sorted( Projects() ), Projects() );
+}
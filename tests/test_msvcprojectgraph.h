@@ -0,0 +1,57 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef TEST_MSVCPROJECTGRAPH_H
+#define TEST_MSVCPROJECTGRAPH_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QUuid>
+
+class MsvcProjectGraph;
+class MsvcProjectItem;
+
+class TestMsvcProjectGraph : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void cleanup();
+
+    void selfLoop();
+    void cycle();
+    void closureAcrossWords();
+    void sorted();
+
+private:
+    // Projects without a parsed file, in solution order
+    QList<MsvcProjectItem*> createProjects( int count );
+
+    // Makes @p proj depend on @p dependency, as ProjectDependencies would
+    void addDependency( MsvcProjectItem * proj, MsvcProjectItem * dependency );
+
+    MsvcProjectGraph graph() const;
+
+    QList<MsvcProjectItem*> m_projects;
+    QHash< QUuid, QList<QUuid> > m_dependencies;
+};
+
+#endif //TEST_MSVCPROJECTGRAPH_H
@@ -0,0 +1,53 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "uptodatejob.h"
+
+#include <QTimer>
+
+#include <KLocalizedString>
+
+#include <outputview/ioutputview.h>
+#include <outputview/outputmodel.h>
+#include <project/projectmodel.h>
+
+UpToDateJob::UpToDateJob( QObject* parent, KDevelop::ProjectBaseItem* item ) :
+    KDevelop::OutputJob(parent),
+    m_itemName(item->text())
+{
+    setToolTitle( i18n("DevEnv") );
+    setStandardToolView( KDevelop::IOutputView::BuildView );
+    setBehaviours( KDevelop::IOutputView::AllowUserClose | KDevelop::IOutputView::AutoScroll );
+
+    setObjectName( i18n("Build (%1)", m_itemName) );
+}
+
+void UpToDateJob::start()
+{
+    KDevelop::OutputModel * model = new KDevelop::OutputModel;
+    setModel( model );
+    startOutput();
+
+    model->appendLine( i18n("%1 is up to date, nothing to do.", m_itemName) );
+
+    // Do not emit the result from within start()
+    QTimer::singleShot( 0, this, [this]() { emitResult(); } );
+}
@@ -0,0 +1,49 @@
+/* KDevelop MSVC Support
+ *
+ * Copyright 2015 Ennio Barbaro <enniobarbaro@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef UPTODATEJOB_H
+#define UPTODATEJOB_H
+
+#include <outputview/outputjob.h>
+
+namespace KDevelop
+{
+class ProjectBaseItem;
+}
+
+/**
+ * @brief Job returned by the builder when there is nothing to build.
+ *
+ * It just reports that the item is up to date and finishes immediately.
+ */
+class UpToDateJob : public KDevelop::OutputJob
+{
+    Q_OBJECT
+
+public:
+    UpToDateJob( QObject* parent, KDevelop::ProjectBaseItem* item );
+
+    void start() override;
+
+private:
+    QString m_itemName;
+};
+
+#endif //UPTODATEJOB_H